@@ -0,0 +1,30 @@
+# Find Cisco's openh264 library, e.g. from vcpkg or the prebuilt release
+# Tries to use the environment variable OPENH264_DIR to find the necessary files (in addition to the usual paths)
+
+# early out, if this target has been created before
+if (TARGET OpenH264::OpenH264)
+	return()
+endif()
+
+find_path(OPENH264_INCLUDE_DIR wels/codec_api.h
+  PATHS
+  $ENV{OPENH264_DIR}
+  PATH_SUFFIXES include
+)
+
+find_library(OPENH264_LIBRARY NAMES openh264 libopenh264
+  PATHS
+  $ENV{OPENH264_DIR}
+  PATH_SUFFIXES lib
+)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(OpenH264 DEFAULT_MSG OPENH264_INCLUDE_DIR OPENH264_LIBRARY)
+
+if (OpenH264_FOUND)
+
+	add_library(OpenH264::OpenH264 UNKNOWN IMPORTED)
+	set_target_properties(OpenH264::OpenH264 PROPERTIES IMPORTED_LOCATION "${OPENH264_LIBRARY}")
+	set_target_properties(OpenH264::OpenH264 PROPERTIES INTERFACE_INCLUDE_DIRECTORIES "${OPENH264_INCLUDE_DIR}")
+
+endif()
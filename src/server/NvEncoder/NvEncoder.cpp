@@ -409,6 +409,58 @@ void NvEncoder::EncodeFrame(std::vector<std::vector<std::byte>> &vPacket, NV_ENC
     }
 }
 
+void NvEncoder::SubmitFrame(NV_ENC_PIC_PARAMS *pPicParams)
+{
+    if (!IsHWEncoderInitialized())
+    {
+        NVENC_THROW_ERROR("Encoder device not found", NV_ENC_ERR_NO_ENCODE_DEVICE);
+    }
+
+    int bfrIdx = m_iToSend % m_nEncoderBuffer;
+
+    MapResources(bfrIdx);
+
+    NVENCSTATUS nvStatus = DoEncode(m_vMappedInputBuffers[bfrIdx], m_vBitstreamOutputBuffer[bfrIdx], pPicParams);
+
+    if (nvStatus != NV_ENC_SUCCESS && nvStatus != NV_ENC_ERR_NEED_MORE_INPUT)
+    {
+        // The frame never reaches the hardware, so its input is released here instead of after its output
+        m_nvenc.nvEncUnmapInputResource(m_hEncoder, m_vMappedInputBuffers[bfrIdx]);
+        m_vMappedInputBuffers[bfrIdx] = nullptr;
+
+        NVENC_THROW_ERROR("nvEncEncodePicture API failed", nvStatus);
+    }
+
+    m_iToSend++;
+}
+
+void NvEncoder::GetNextEncodedPacket(std::vector<std::byte> &packet)
+{
+    packet.clear();
+
+    // Counted before anything can fail, so that a lost frame doesn't stall the ones after it
+    const int bfrIdx = m_iGot % m_nEncoderBuffer;
+    m_iGot++;
+
+    WaitForCompletionEvent(bfrIdx);
+
+    NV_ENC_LOCK_BITSTREAM lockBitstreamData = { NV_ENC_LOCK_BITSTREAM_VER };
+    lockBitstreamData.outputBitstream = m_vBitstreamOutputBuffer[bfrIdx];
+    lockBitstreamData.doNotWait = false;
+    NVENC_API_CALL(m_nvenc.nvEncLockBitstream(m_hEncoder, &lockBitstreamData));
+
+    std::byte *pData = (std::byte *)lockBitstreamData.bitstreamBufferPtr;
+    packet.insert(packet.end(), &pData[0], &pData[lockBitstreamData.bitstreamSizeInBytes]);
+
+    NVENC_API_CALL(m_nvenc.nvEncUnlockBitstream(m_hEncoder, lockBitstreamData.outputBitstream));
+
+    if (m_vMappedInputBuffers[bfrIdx])
+    {
+        NVENC_API_CALL(m_nvenc.nvEncUnmapInputResource(m_hEncoder, m_vMappedInputBuffers[bfrIdx]));
+        m_vMappedInputBuffers[bfrIdx] = nullptr;
+    }
+}
+
 void NvEncoder::RunMotionEstimation(std::vector<std::byte> &mvData)
 {
     if (!m_hEncoder)
@@ -125,6 +125,21 @@ public:
     */
     virtual void EncodeFrame(std::vector<std::vector<std::byte>> &vPacket, NV_ENC_PIC_PARAMS *pPicParams = nullptr);
 
+    /**
+    *  @brief  This function is used to submit a frame without retrieving any output.
+    *  Applications which retrieve the bitstream on a separate thread call this function
+    *  instead of EncodeFrame(), and GetNextEncodedPacket() once for every submitted frame.
+    *  No more than GetEncoderBufferCount() frames may be in flight at the same time.
+    */
+    void SubmitFrame(NV_ENC_PIC_PARAMS *pPicParams = nullptr);
+
+    /**
+    *  @brief  This function is used to retrieve the bitstream of the oldest submitted frame.
+    *  It waits until the hardware finished the frame, so it is meant to run on another thread
+    *  than SubmitFrame(). It must only be called for frames which were submitted.
+    */
+    void GetNextEncodedPacket(std::vector<std::byte> &packet);
+
     /**
     *  @brief  This function to flush the encoder queue.
     *  The encoder might be queuing frames for B picture encoding or lookahead;
@@ -0,0 +1,187 @@
+#include "bgra.h"
+#include "bgra_kernels.h"
+#include "cpu_features.h"
+#include "text_overlay.h"
+#include "video_input/video_format.h"
+
+namespace
+{
+struct Kernels
+{
+    const char* name = "C";
+
+    // Pixels the SIMD kernel processes per block, the remainder of a row is handled by the scalar kernel
+    uint32_t blockSize = 1;
+
+    ExpandRowKernel rgb24 = RGB24ToBGRARow_C;
+
+    // Mirroring only has scalar and AVX2 kernels, without the latter the scalar kernels convert the whole row
+    uint32_t mirrorBlockSize = 1;
+    ExpandRowKernel rgb24Mirror = nullptr;
+    ExpandRowKernel bgraMirror = nullptr;
+};
+
+const Kernels ReferenceKernels;
+
+Kernels SelectKernels()
+{
+    Kernels kernels;
+
+#ifdef CPU_X86_64
+    const CpuFeatures& features = GetCpuFeatures();
+
+    if (features.avx512bw)
+    {
+        kernels = {"AVX-512", 16, RGB24ToBGRARow_AVX512};
+    }
+    else if (features.avx2)
+    {
+        kernels = {"AVX2", 32, RGB24ToBGRARow_AVX2};
+    }
+    else if (features.ssse3)
+    {
+        kernels = {"SSSE3", 16, RGB24ToBGRARow_SSSE3};
+    }
+
+    if (features.avx2)
+    {
+        kernels.mirrorBlockSize = 32;
+        kernels.rgb24Mirror = RGB24ToBGRARowMirror_AVX2;
+        kernels.bgraMirror = MirrorRow32_AVX2;
+    }
+#endif
+
+    info("CONVERT", "Using %s kernels for the conversion to BGRA.", kernels.name);
+
+    return kernels;
+}
+
+const Kernels& GetKernels()
+{
+    static const Kernels kernels = ::SelectKernels();
+    return kernels;
+}
+
+// Runs the SIMD kernel on the whole blocks of a row and the scalar kernel on the rest. The mirrored kernels
+// write the blocks to the end of the destination row, so the rest goes to its start.
+void ConvertRow(ExpandRowKernel kernel, ExpandRowKernel scalarKernel, uint32_t blockSize, uint32_t bytesPerPixel, bool mirror, const uint8_t* src, uint8_t* dst,
+                uint32_t width)
+{
+    const uint32_t blockWidth = kernel ? width - width % blockSize : 0;
+    const uint32_t restWidth = width - blockWidth;
+
+    if (blockWidth > 0)
+    {
+        kernel(src, dst + (mirror ? restWidth : 0) * 4, blockWidth);
+    }
+
+    scalarKernel(src + blockWidth * bytesPerPixel, dst + (mirror ? 0 : blockWidth) * 4, restWidth);
+}
+
+void ExpandRow(const Kernels& kernels, const uint8_t* src, uint8_t* dst, uint32_t width)
+{
+    ::ConvertRow(kernels.rgb24, RGB24ToBGRARow_C, kernels.blockSize, 3, false, src, dst, width);
+}
+
+bool Convert(const Frame& frame, const Kernels& kernels, Orientation orientation, std::byte* dst, size_t dstPitch, const TextOverlay* overlay)
+{
+    const Frame::Plane& plane = frame.planes[0];
+
+    if (frame.videoFormat != IDevice::VideoFormat::BGRA && frame.videoFormat != IDevice::VideoFormat::RGB24)
+    {
+        error("CONVERT", "Can't convert video format %d to BGRA.", (int)frame.videoFormat);
+        return false;
+    }
+
+    if (frame.videoFormat == IDevice::VideoFormat::BGRA && orientation == Orientation{})
+    {
+        plane.copyTo(dst, dstPitch);
+
+        // Only touches the rows of the overlay
+        if (overlay)
+        {
+            overlay->drawBGRA(dst, dstPitch, frame.width, 0, plane.rows);
+        }
+
+        return true;
+    }
+
+    // The row conversion is picked once for the frame, BGRA rows are only copied unless they are mirrored
+    const bool mirror = orientation.mirror;
+    const bool rgb24 = frame.videoFormat == IDevice::VideoFormat::RGB24;
+    const bool copyRows = !rgb24 && !mirror;
+
+    const ExpandRowKernel kernel = rgb24 ? (mirror ? kernels.rgb24Mirror : kernels.rgb24) : kernels.bgraMirror;
+    const ExpandRowKernel scalarKernel = rgb24 ? (mirror ? RGB24ToBGRARowMirror_C : RGB24ToBGRARow_C) : MirrorRow32_C;
+    const uint32_t blockSize = mirror ? kernels.mirrorBlockSize : kernels.blockSize;
+    const uint32_t bytesPerPixel = GetVideoFormatInfo(frame.videoFormat).planes[0].bytesPerSample;
+
+    for (uint32_t y = 0; y < plane.rows; ++y)
+    {
+        const uint8_t* src = reinterpret_cast<const uint8_t*>(plane.getRow(orientation.flip ? plane.rows - 1 - y : y));
+        uint8_t* row = reinterpret_cast<uint8_t*>(dst + y * dstPitch);
+
+        if (copyRows)
+        {
+            std::memcpy(row, src, plane.rowSize);
+        }
+        else
+        {
+            ::ConvertRow(kernel, scalarKernel, blockSize, bytesPerPixel, mirror, src, row, frame.width);
+        }
+
+        if (overlay)
+        {
+            overlay->drawBGRA(dst, dstPitch, frame.width, y, y + 1);
+        }
+    }
+
+    return true;
+}
+} // namespace
+
+void RGB24ToBGRARow_C(const uint8_t* src, uint8_t* dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        dst[x * 4 + 0] = src[x * 3 + 0];
+        dst[x * 4 + 1] = src[x * 3 + 1];
+        dst[x * 4 + 2] = src[x * 3 + 2];
+        dst[x * 4 + 3] = 0xFF;
+    }
+}
+
+void RGB24ToBGRARowMirror_C(const uint8_t* src, uint8_t* dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        uint8_t* pixel = dst + (width - 1 - x) * 4;
+        pixel[0] = src[x * 3 + 0];
+        pixel[1] = src[x * 3 + 1];
+        pixel[2] = src[x * 3 + 2];
+        pixel[3] = 0xFF;
+    }
+}
+
+void MirrorRow32_C(const uint8_t* src, uint8_t* dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        std::memcpy(dst + (width - 1 - x) * 4, src + x * 4, 4);
+    }
+}
+
+void ExpandRGB24ToBGRA(const std::byte* src, std::byte* dst, uint32_t width)
+{
+    ::ExpandRow(::GetKernels(), reinterpret_cast<const uint8_t*>(src), reinterpret_cast<uint8_t*>(dst), width);
+}
+
+bool ConvertToBGRA(const Frame& frame, std::byte* dst, size_t dstPitch, Orientation orientation, const TextOverlay* overlay)
+{
+    return ::Convert(frame, ::GetKernels(), orientation, dst, dstPitch, overlay);
+}
+
+bool ConvertToBGRAReference(const Frame& frame, std::byte* dst, size_t dstPitch, Orientation orientation)
+{
+    return ::Convert(frame, ::ReferenceKernels, orientation, dst, dstPitch, nullptr);
+}
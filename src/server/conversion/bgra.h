@@ -0,0 +1,16 @@
+#pragma once
+
+#include "orientation.h"
+#include "video_input/frame.h"
+
+class TextOverlay;
+
+// Writes a BGRA or RGB24 frame as BGRA into the destination, RGB24 is expanded with the fastest kernels the CPU supports.
+// The overlay is drawn into each row right after it was written.
+bool ConvertToBGRA(const Frame& frame, std::byte* dst, size_t dstPitch, Orientation orientation = {}, const TextOverlay* overlay = nullptr);
+
+// Expands one row of RGB24 pixels to BGRA
+void ExpandRGB24ToBGRA(const std::byte* src, std::byte* dst, uint32_t width);
+
+// Same as ConvertToBGRA() but always uses the scalar kernel, as a reference for the SIMD ones
+bool ConvertToBGRAReference(const Frame& frame, std::byte* dst, size_t dstPitch, Orientation orientation = {});
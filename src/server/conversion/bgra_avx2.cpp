@@ -0,0 +1,67 @@
+#include "bgra_kernels.h"
+#include "cpu_features.h"
+
+#ifdef CPU_X86_64
+#include <immintrin.h>
+
+namespace
+{
+// Loads 8 pixels (24 bytes) so that the first 4 are at the start of the low lane and the other 4 at byte 4 of the high lane.
+// The high lane is loaded from byte 8, so nothing past the 24 bytes is read.
+__m256i LoadPixels(const uint8_t* src)
+{
+    const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 8));
+
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+}
+
+// Stores 8 pixels at the pixel offset into the row, or in reverse order at the mirrored offset
+template <bool Mirror>
+void StorePixels(uint8_t* row, uint32_t width, uint32_t x, __m256i pixels)
+{
+    if constexpr (Mirror)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + (width - x - 8) * 4), _mm256_permutevar8x32_epi32(pixels, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0)));
+    }
+    else
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + x * 4), pixels);
+    }
+}
+
+template <bool Mirror>
+void RGB24ToBGRARow(const uint8_t* src, uint8_t* dst, uint32_t width)
+{
+    const __m256i expand = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, 4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15, -1);
+    const __m256i alpha = _mm256_set1_epi32(int(0xFF000000));
+
+    for (uint32_t x = 0; x < width; x += 32)
+    {
+        for (uint32_t i = 0; i < 32; i += 8)
+        {
+            const __m256i pixels = LoadPixels(src + (x + i) * 3);
+            StorePixels<Mirror>(dst, width, x + i, _mm256_or_si256(_mm256_shuffle_epi8(pixels, expand), alpha));
+        }
+    }
+}
+} // namespace
+
+void RGB24ToBGRARow_AVX2(const uint8_t* src, uint8_t* dst, uint32_t width)
+{
+    RGB24ToBGRARow<false>(src, dst, width);
+}
+
+void RGB24ToBGRARowMirror_AVX2(const uint8_t* src, uint8_t* dst, uint32_t width)
+{
+    RGB24ToBGRARow<true>(src, dst, width);
+}
+
+void MirrorRow32_AVX2(const uint8_t* src, uint8_t* dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; x += 8)
+    {
+        StorePixels<true>(dst, width, x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4)));
+    }
+}
+#endif
@@ -0,0 +1,26 @@
+#include "bgra_kernels.h"
+#include "cpu_features.h"
+
+#ifdef CPU_X86_64
+#include <immintrin.h>
+
+void RGB24ToBGRARow_AVX512(const uint8_t* src, uint8_t* dst, uint32_t width)
+{
+    // Moves the 12 bytes of every 4 pixels to the start of their own lane, the byte shuffle then works like the SSSE3 one per lane
+    const __m512i spread = _mm512_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0, 6, 7, 8, 0, 9, 10, 11, 0);
+    const __m512i expand = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1));
+    const __m512i alpha = _mm512_set1_epi32(int(0xFF000000));
+
+    // 16 pixels are 48 bytes, the masked load doesn't touch the 16 bytes after them
+    const __mmask64 loadMask = (1ull << 48) - 1;
+
+    for (uint32_t x = 0; x < width; x += 16)
+    {
+        // Plain loads read 16 bytes past the pixels, which is only safe if at least 6 more pixels follow
+        const __m512i input = x + 22 <= width ? _mm512_loadu_si512(src + x * 3) : _mm512_maskz_loadu_epi8(loadMask, src + x * 3);
+
+        const __m512i pixels = _mm512_permutexvar_epi32(spread, input);
+        _mm512_storeu_si512(dst + x * 4, _mm512_or_si512(_mm512_shuffle_epi8(pixels, expand), alpha));
+    }
+}
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+
+// Row kernels used by ConvertToBGRA(), built like the NV12 kernels (see nv12_kernels.h)
+#include <cstdint>
+
+// Expands B G R pixels to B G R A with an opaque alpha. The SIMD variants require the width to be a multiple of their block size.
+using ExpandRowKernel = void (*)(const uint8_t* src, uint8_t* dst, uint32_t width);
+
+void RGB24ToBGRARow_C(const uint8_t* src, uint8_t* dst, uint32_t width);
+
+// The ...Mirror kernels and MirrorRow32 write the pixels in reverse order, the first source pixel ends up at the end of the destination row
+void RGB24ToBGRARowMirror_C(const uint8_t* src, uint8_t* dst, uint32_t width);
+void MirrorRow32_C(const uint8_t* src, uint8_t* dst, uint32_t width);
+
+// 16 pixels per block
+void RGB24ToBGRARow_SSSE3(const uint8_t* src, uint8_t* dst, uint32_t width);
+
+// 32 pixels per block
+void RGB24ToBGRARow_AVX2(const uint8_t* src, uint8_t* dst, uint32_t width);
+void RGB24ToBGRARowMirror_AVX2(const uint8_t* src, uint8_t* dst, uint32_t width);
+void MirrorRow32_AVX2(const uint8_t* src, uint8_t* dst, uint32_t width);
+
+// 16 pixels per block
+void RGB24ToBGRARow_AVX512(const uint8_t* src, uint8_t* dst, uint32_t width);
@@ -0,0 +1,31 @@
+#include "bgra_kernels.h"
+#include "cpu_features.h"
+
+#ifdef CPU_X86_64
+#include <tmmintrin.h>
+
+void RGB24ToBGRARow_SSSE3(const uint8_t* src, uint8_t* dst, uint32_t width)
+{
+    // Spreads the first 4 pixels of a register to 4 bytes each and leaves the alpha bytes zero
+    const __m128i expand = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32(int(0xFF000000));
+
+    for (uint32_t x = 0; x < width; x += 16)
+    {
+        // 16 pixels are exactly three registers, the pixels which straddle registers are realigned
+        const __m128i in0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 3));
+        const __m128i in1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 3 + 16));
+        const __m128i in2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 3 + 32));
+
+        const __m128i pixels0 = in0;
+        const __m128i pixels1 = _mm_alignr_epi8(in1, in0, 12);
+        const __m128i pixels2 = _mm_alignr_epi8(in2, in1, 8);
+        const __m128i pixels3 = _mm_srli_si128(in2, 4);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_or_si128(_mm_shuffle_epi8(pixels0, expand), alpha));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4 + 16), _mm_or_si128(_mm_shuffle_epi8(pixels1, expand), alpha));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4 + 32), _mm_or_si128(_mm_shuffle_epi8(pixels2, expand), alpha));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4 + 48), _mm_or_si128(_mm_shuffle_epi8(pixels3, expand), alpha));
+    }
+}
+#endif
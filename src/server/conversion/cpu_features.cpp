@@ -0,0 +1,86 @@
+#include "cpu_features.h"
+
+#ifdef CPU_X86_64
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace
+{
+#ifdef CPU_X86_64
+struct CpuIdResult
+{
+    uint32_t eax = 0;
+    uint32_t ebx = 0;
+    uint32_t ecx = 0;
+    uint32_t edx = 0;
+};
+
+CpuIdResult CpuId(uint32_t leaf, uint32_t subLeaf)
+{
+    CpuIdResult result;
+
+#ifdef _MSC_VER
+    int registers[4];
+    __cpuidex(registers, leaf, subLeaf);
+
+    result = {uint32_t(registers[0]), uint32_t(registers[1]), uint32_t(registers[2]), uint32_t(registers[3])};
+#else
+    __cpuid_count(leaf, subLeaf, result.eax, result.ebx, result.ecx, result.edx);
+#endif
+
+    return result;
+}
+
+// Returns which register states the OS saves on context switches
+uint64_t GetEnabledXStateFeatures()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t eax = 0, edx = 0;
+    __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (uint64_t(edx) << 32) | eax;
+#endif
+}
+#endif
+
+CpuFeatures DetectCpuFeatures()
+{
+    CpuFeatures features;
+
+#ifdef CPU_X86_64
+    const uint32_t maxLeaf = CpuId(0, 0).eax;
+    const CpuIdResult leaf1 = CpuId(1, 0);
+
+    features.ssse3 = leaf1.ecx & (1u << 9);
+
+    // AVX2 also needs the OS to save the YMM registers
+    const bool osxsave = leaf1.ecx & (1u << 27);
+    const bool ymmEnabled = osxsave && (GetEnabledXStateFeatures() & 0x6) == 0x6;
+
+    // AVX-512 additionally needs the opmask and ZMM registers
+    const bool zmmEnabled = ymmEnabled && (GetEnabledXStateFeatures() & 0xE0) == 0xE0;
+
+    if (maxLeaf >= 7 && ymmEnabled)
+    {
+        const CpuIdResult leaf7 = CpuId(7, 0);
+        features.avx2 = leaf7.ebx & (1u << 5);
+        features.avx512bw = zmmEnabled && (leaf7.ebx & (1u << 16)) && (leaf7.ebx & (1u << 30));
+    }
+#endif
+
+    info("CPU", "CPU features: SSSE3 %s, AVX2 %s, AVX-512 BW %s", features.ssse3 ? "yes" : "no", features.avx2 ? "yes" : "no", features.avx512bw ? "yes" : "no");
+
+    return features;
+}
+} // namespace
+
+const CpuFeatures& GetCpuFeatures()
+{
+    static const CpuFeatures features = ::DetectCpuFeatures();
+    return features;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CPU_X86_64 1
+#endif
+
+// Instruction set extensions which can be used by the conversion kernels, detected once at startup
+struct CpuFeatures
+{
+    bool ssse3 = false;
+    bool avx2 = false;
+    bool avx512bw = false; // Together with AVX-512 F
+};
+
+const CpuFeatures& GetCpuFeatures();
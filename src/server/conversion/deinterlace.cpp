@@ -0,0 +1,283 @@
+#include "deinterlace.h"
+#include "cpu_features.h"
+#include "deinterlace_kernels.h"
+#include "pipeline/thread_pool.h"
+#include "video_input/video_format.h"
+
+namespace
+{
+struct DeinterlaceKernels
+{
+    const char* name = "C";
+
+    // Bytes the SIMD kernels process per block, the remainder of a row is handled by the scalar kernels
+    uint32_t blockSize = 1;
+
+    InterpolateRowKernel interpolate = InterpolateRow_C;
+    DeinterlaceRowKernel deinterlace = DeinterlaceRow_C;
+
+    // Formats with 16 bit samples
+    InterpolateRowKernel interpolate16 = InterpolateRow16_C;
+    DeinterlaceRowKernel deinterlace16 = DeinterlaceRow16_C;
+};
+
+const DeinterlaceKernels ReferenceKernels;
+
+DeinterlaceKernels SelectKernels()
+{
+    DeinterlaceKernels kernels;
+
+#ifdef CPU_X86_64
+    if (GetCpuFeatures().avx2)
+    {
+        kernels = {"AVX2", 32, InterpolateRow_AVX2, DeinterlaceRow_AVX2, InterpolateRow16_AVX2, DeinterlaceRow16_AVX2};
+    }
+#endif
+
+    info("CONVERT", "Using %s kernels for deinterlacing.", kernels.name);
+
+    return kernels;
+}
+
+const DeinterlaceKernels& GetKernels()
+{
+    static const DeinterlaceKernels kernels = ::SelectKernels();
+    return kernels;
+}
+
+// Samples are read with memcpy, the rows of 16 bit planes needn't be aligned
+template <typename Sample>
+Sample Load(const uint8_t* row, uint32_t x)
+{
+    Sample sample;
+    std::memcpy(&sample, row + x * sizeof(Sample), sizeof(Sample));
+    return sample;
+}
+
+template <typename Sample>
+void InterpolateRow(const uint8_t* above, const uint8_t* below, uint8_t* dst, uint32_t size)
+{
+    for (uint32_t x = 0; x < size / sizeof(Sample); ++x)
+    {
+        const Sample sample = Sample((::Load<Sample>(above, x) + ::Load<Sample>(below, x) + 1) / 2);
+        std::memcpy(dst + x * sizeof(Sample), &sample, sizeof(Sample));
+    }
+}
+
+template <typename Sample>
+void DeinterlaceRow(const DeinterlaceRows& rows, uint8_t* dst, uint32_t size, uint32_t threshold)
+{
+    for (uint32_t x = 0; x < size / sizeof(Sample); ++x)
+    {
+        const int row = ::Load<Sample>(rows.row, x);
+        const int above = ::Load<Sample>(rows.above, x);
+        const int below = ::Load<Sample>(rows.below, x);
+
+        const int motion = std::max({std::abs(row - ::Load<Sample>(rows.previousRow, x)), std::abs(above - ::Load<Sample>(rows.previousAbove, x)),
+                                     std::abs(below - ::Load<Sample>(rows.previousBelow, x))});
+
+        const Sample sample = Sample(motion > int(threshold) ? (above + below + 1) / 2 : row);
+        std::memcpy(dst + x * sizeof(Sample), &sample, sizeof(Sample));
+    }
+}
+
+uint32_t AlignDown(uint32_t value, uint32_t blockSize)
+{
+    return value - value % blockSize;
+}
+
+const uint8_t* Row(const Frame::Plane& plane, uint32_t y)
+{
+    return reinterpret_cast<const uint8_t*>(plane.getRow(y));
+}
+
+DeinterlaceRows Offset(const DeinterlaceRows& rows, uint32_t offset)
+{
+    return {rows.above + offset, rows.row + offset, rows.below + offset, rows.previousAbove + offset, rows.previousRow + offset, rows.previousBelow + offset};
+}
+
+bool CheckFrames(const Frame& frame, const Frame& destination)
+{
+    if (frame.videoFormat != destination.videoFormat || frame.width != destination.width || frame.height != destination.height || frame.planeCount == 0 ||
+        frame.planeCount != destination.planeCount)
+    {
+        error("CONVERT", "Can't deinterlace a %d x %d frame of format %d into a %d x %d frame of format %d.", frame.width, frame.height, (int)frame.videoFormat,
+              destination.width, destination.height, (int)destination.videoFormat);
+        return false;
+    }
+
+    return true;
+}
+
+// Kernels for the sample size of the format, the scalar ones handle the row tails
+struct BandKernels
+{
+    uint32_t blockSize = 1;
+
+    InterpolateRowKernel interpolate = nullptr;
+    DeinterlaceRowKernel deinterlace = nullptr;
+    InterpolateRowKernel scalarInterpolate = nullptr;
+    DeinterlaceRowKernel scalarDeinterlace = nullptr;
+};
+
+BandKernels GetBandKernels(const DeinterlaceKernels& kernels, IDevice::VideoFormat videoFormat)
+{
+    if (GetVideoFormatInfo(videoFormat).bitDepth > 8)
+    {
+        return {kernels.blockSize, kernels.interpolate16, kernels.deinterlace16, InterpolateRow16_C, DeinterlaceRow16_C};
+    }
+
+    return {kernels.blockSize, kernels.interpolate, kernels.deinterlace, InterpolateRow_C, DeinterlaceRow_C};
+}
+
+// Bands of rows every plane is split into, a band of the chroma plane covers the same part of the picture as the luma band
+struct Bands
+{
+    uint32_t count = 1;
+
+    uint32_t getFirstRow(const Frame::Plane& plane, uint32_t band) const
+    {
+        return uint32_t(uint64_t(plane.rows) * band / count);
+    }
+};
+
+// Copies the rows of the kept field in [firstRow, endRow) and rebuilds the ones of the other field.
+// Without a previous plane the other field is interpolated.
+void DeinterlaceBand(const Frame::Plane& plane, const Frame::Plane* previous, const Frame::Plane& destination, const BandKernels& kernels, uint32_t keptParity,
+                     uint8_t threshold, uint32_t firstRow, uint32_t endRow)
+{
+    const uint32_t size = plane.rowSize;
+    const uint32_t blockSize = AlignDown(size, kernels.blockSize);
+    const uint32_t restSize = size - blockSize;
+
+    for (uint32_t y = firstRow; y < endRow; ++y)
+    {
+        uint8_t* dst = reinterpret_cast<uint8_t*>(const_cast<std::byte*>(destination.getRow(y)));
+
+        if ((y & 1) == keptParity || plane.rows < 2)
+        {
+            std::memcpy(dst, ::Row(plane, y), size);
+            continue;
+        }
+
+        // At the top and bottom edge the one neighbour of the kept field stands in for both
+        const uint32_t aboveRow = y > 0 ? y - 1 : y + 1;
+        const uint32_t belowRow = y + 1 < plane.rows ? y + 1 : y - 1;
+
+        const uint8_t* above = ::Row(plane, aboveRow);
+        const uint8_t* below = ::Row(plane, belowRow);
+
+        if (!previous)
+        {
+            if (blockSize > 0)
+            {
+                kernels.interpolate(above, below, dst, blockSize);
+            }
+
+            kernels.scalarInterpolate(above + blockSize, below + blockSize, dst + blockSize, restSize);
+            continue;
+        }
+
+        const DeinterlaceRows rows = {above, ::Row(plane, y), below, ::Row(*previous, aboveRow), ::Row(*previous, y), ::Row(*previous, belowRow)};
+
+        if (blockSize > 0)
+        {
+            kernels.deinterlace(rows, dst, blockSize, threshold);
+        }
+
+        kernels.scalarDeinterlace(::Offset(rows, blockSize), dst + blockSize, restSize, threshold);
+    }
+}
+
+// Runs the band of one plane, tasks are numbered band by band with all planes of a band next to each other
+void DeinterlaceTask(const Frame& frame, const Frame* previous, const Frame& destination, const DeinterlaceKernels& kernels, const Deinterlacer::Options& options,
+                     const Bands& bands, uint32_t task)
+{
+    const uint32_t planeIndex = task % frame.planeCount;
+    const uint32_t band = task / frame.planeCount;
+
+    const Frame::Plane& plane = frame.planes[planeIndex];
+
+    // The field which was captured first is kept, its rows are the even ones for top field first
+    const uint32_t keptParity = options.fieldOrder == IDevice::FieldOrder::BottomFieldFirst ? 1 : 0;
+
+    ::DeinterlaceBand(plane, previous ? &previous->planes[planeIndex] : nullptr, destination.planes[planeIndex], ::GetBandKernels(kernels, frame.videoFormat), keptParity, options.motionThreshold,
+                      bands.getFirstRow(plane, band), bands.getFirstRow(plane, band + 1));
+}
+
+// The previous frame is only compared against for motion adaptive deinterlacing of frames that match it
+const Frame* GetMotionReference(const Frame& frame, const Frame* previous, Deinterlacer::Mode mode)
+{
+    if (mode != Deinterlacer::Mode::MotionAdaptive || !previous || previous->videoFormat != frame.videoFormat || previous->width != frame.width ||
+        previous->height != frame.height || previous->planeCount != frame.planeCount)
+    {
+        return nullptr;
+    }
+
+    return previous;
+}
+} // namespace
+
+void InterpolateRow_C(const uint8_t* above, const uint8_t* below, uint8_t* dst, uint32_t size)
+{
+    ::InterpolateRow<uint8_t>(above, below, dst, size);
+}
+
+void DeinterlaceRow_C(const DeinterlaceRows& rows, uint8_t* dst, uint32_t size, uint8_t threshold)
+{
+    ::DeinterlaceRow<uint8_t>(rows, dst, size, threshold);
+}
+
+void InterpolateRow16_C(const uint8_t* above, const uint8_t* below, uint8_t* dst, uint32_t size)
+{
+    ::InterpolateRow<uint16_t>(above, below, dst, size);
+}
+
+void DeinterlaceRow16_C(const DeinterlaceRows& rows, uint8_t* dst, uint32_t size, uint8_t threshold)
+{
+    ::DeinterlaceRow<uint16_t>(rows, dst, size, threshold << 8);
+}
+
+Deinterlacer::Deinterlacer(const Options& options) : m_options(options), m_threadPool(std::make_unique<ThreadPool>(std::max(options.threadCount, 1u)))
+{
+    info("CONVERT", "Deinterlacing %s field first with %s on %d threads.", options.fieldOrder == IDevice::FieldOrder::BottomFieldFirst ? "bottom" : "top",
+         options.mode == Mode::Bob ? "bob" : "motion adaptive", m_threadPool->getThreadCount());
+}
+
+Deinterlacer::~Deinterlacer() = default;
+
+bool Deinterlacer::deinterlace(const Frame& frame, const Frame* previous, const Frame& destination)
+{
+    if (!::CheckFrames(frame, destination))
+    {
+        return false;
+    }
+
+    const DeinterlaceKernels& kernels = ::GetKernels();
+    const Frame* motionReference = ::GetMotionReference(frame, previous, m_options.mode);
+
+    // A few bands per thread balance the load if some threads get descheduled
+    const Bands bands = {std::max(1u, std::min(m_threadPool->getThreadCount() * 4, frame.height / 32))};
+
+    m_threadPool->parallelFor(bands.count * frame.planeCount,
+                              [&](uint32_t task) { ::DeinterlaceTask(frame, motionReference, destination, kernels, m_options, bands, task); });
+
+    return true;
+}
+
+bool Deinterlacer::deinterlaceReference(const Frame& frame, const Frame* previous, const Frame& destination)
+{
+    if (!::CheckFrames(frame, destination))
+    {
+        return false;
+    }
+
+    const Frame* motionReference = ::GetMotionReference(frame, previous, m_options.mode);
+
+    for (uint32_t task = 0; task < frame.planeCount; ++task)
+    {
+        ::DeinterlaceTask(frame, motionReference, destination, ::ReferenceKernels, m_options, Bands(), task);
+    }
+
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "video_input/frame.h"
+
+class ThreadPool;
+
+// Turns interlaced frames into progressive ones at the same frame rate. The field captured first is kept and the rows of
+// the other field are rebuilt, in bands of rows on several threads. The planes are handled sample by sample, so every 8 bit
+// format and P010 work without converting them first.
+class Deinterlacer
+{
+  public:
+    enum class Mode
+    {
+        // Interpolates the other field from the kept one, which halves the vertical resolution
+        Bob,
+
+        // Keeps the other field where the picture didn't change since the previous frame and interpolates it where it moves
+        MotionAdaptive
+    };
+
+    struct Options
+    {
+        Mode mode = Mode::MotionAdaptive;
+
+        // Progressive is handled like top field first
+        IDevice::FieldOrder fieldOrder = IDevice::FieldOrder::TopFieldFirst;
+
+        // Largest change of a sample since the previous frame which still counts as no motion, so that noise doesn't blur still parts.
+        // Given in 8 bit steps, also for formats with deeper samples.
+        uint8_t motionThreshold = 12;
+
+        uint32_t threadCount = 2;
+    };
+
+    explicit Deinterlacer(const Options& options);
+    ~Deinterlacer();
+
+    // Writes the progressive frame into the planes of the destination, which needs the frame's format and size.
+    // Without a previous frame of the same format and size motion adaptive deinterlacing falls back to bob.
+    bool deinterlace(const Frame& frame, const Frame* previous, const Frame& destination);
+
+    // Same as deinterlace() but on the calling thread with the scalar kernels, as a reference for the SIMD ones
+    bool deinterlaceReference(const Frame& frame, const Frame* previous, const Frame& destination);
+
+  private:
+    Options m_options;
+    std::unique_ptr<ThreadPool> m_threadPool;
+};
@@ -0,0 +1,84 @@
+#include "deinterlace_kernels.h"
+#include "cpu_features.h"
+
+#ifdef CPU_X86_64
+#include <immintrin.h>
+
+namespace
+{
+__m256i Load(const uint8_t* src, uint32_t x)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x));
+}
+
+__m256i AbsoluteDifference(__m256i a, __m256i b)
+{
+    return _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+}
+
+__m256i AbsoluteDifference16(__m256i a, __m256i b)
+{
+    return _mm256_or_si256(_mm256_subs_epu16(a, b), _mm256_subs_epu16(b, a));
+}
+} // namespace
+
+void InterpolateRow_AVX2(const uint8_t* above, const uint8_t* below, uint8_t* dst, uint32_t size)
+{
+    for (uint32_t x = 0; x < size; x += 32)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm256_avg_epu8(::Load(above, x), ::Load(below, x)));
+    }
+}
+
+void DeinterlaceRow_AVX2(const DeinterlaceRows& rows, uint8_t* dst, uint32_t size, uint8_t threshold)
+{
+    const __m256i thresholds = _mm256_set1_epi8(static_cast<char>(threshold));
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (uint32_t x = 0; x < size; x += 32)
+    {
+        const __m256i above = ::Load(rows.above, x);
+        const __m256i row = ::Load(rows.row, x);
+        const __m256i below = ::Load(rows.below, x);
+
+        __m256i motion = ::AbsoluteDifference(row, ::Load(rows.previousRow, x));
+        motion = _mm256_max_epu8(motion, ::AbsoluteDifference(above, ::Load(rows.previousAbove, x)));
+        motion = _mm256_max_epu8(motion, ::AbsoluteDifference(below, ::Load(rows.previousBelow, x)));
+
+        // Samples whose motion doesn't exceed the threshold saturate to zero and keep the woven row
+        const __m256i still = _mm256_cmpeq_epi8(_mm256_subs_epu8(motion, thresholds), zero);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm256_blendv_epi8(_mm256_avg_epu8(above, below), row, still));
+    }
+}
+
+void InterpolateRow16_AVX2(const uint8_t* above, const uint8_t* below, uint8_t* dst, uint32_t size)
+{
+    for (uint32_t x = 0; x < size; x += 32)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm256_avg_epu16(::Load(above, x), ::Load(below, x)));
+    }
+}
+
+void DeinterlaceRow16_AVX2(const DeinterlaceRows& rows, uint8_t* dst, uint32_t size, uint8_t threshold)
+{
+    const __m256i thresholds = _mm256_set1_epi16(static_cast<short>(threshold << 8));
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (uint32_t x = 0; x < size; x += 32)
+    {
+        const __m256i above = ::Load(rows.above, x);
+        const __m256i row = ::Load(rows.row, x);
+        const __m256i below = ::Load(rows.below, x);
+
+        __m256i motion = ::AbsoluteDifference16(row, ::Load(rows.previousRow, x));
+        motion = _mm256_max_epu16(motion, ::AbsoluteDifference16(above, ::Load(rows.previousAbove, x)));
+        motion = _mm256_max_epu16(motion, ::AbsoluteDifference16(below, ::Load(rows.previousBelow, x)));
+
+        // The mask covers both bytes of a sample, so the byte blend keeps samples whole
+        const __m256i still = _mm256_cmpeq_epi16(_mm256_subs_epu16(motion, thresholds), zero);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm256_blendv_epi8(_mm256_avg_epu16(above, below), row, still));
+    }
+}
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+// Row kernels used by Deinterlacer, built like the NV12 kernels (see nv12_kernels.h).
+// They work on bytes, so the same kernels handle every plane of the 8 bit formats. The 16 bit variants handle formats
+// like P010 whose samples hold the value in their upper bits, they scale the threshold by 256 to match.
+#include <cstdint>
+
+// Rows around a row of the field which is rebuilt, in the current and in the previous frame.
+// above and below belong to the field which is kept.
+struct DeinterlaceRows
+{
+    const uint8_t* above = nullptr;
+    const uint8_t* row = nullptr;
+    const uint8_t* below = nullptr;
+
+    const uint8_t* previousAbove = nullptr;
+    const uint8_t* previousRow = nullptr;
+    const uint8_t* previousBelow = nullptr;
+};
+
+// Bob: dst = (above + below + 1) / 2
+using InterpolateRowKernel = void (*)(const uint8_t* above, const uint8_t* below, uint8_t* dst, uint32_t size);
+
+// Motion adaptive: keeps the woven sample of row where none of the three rows changed by more than the threshold
+// since the previous frame, and interpolates it like bob otherwise
+using DeinterlaceRowKernel = void (*)(const DeinterlaceRows& rows, uint8_t* dst, uint32_t size, uint8_t threshold);
+
+void InterpolateRow_C(const uint8_t* above, const uint8_t* below, uint8_t* dst, uint32_t size);
+void DeinterlaceRow_C(const DeinterlaceRows& rows, uint8_t* dst, uint32_t size, uint8_t threshold);
+void InterpolateRow16_C(const uint8_t* above, const uint8_t* below, uint8_t* dst, uint32_t size);
+void DeinterlaceRow16_C(const DeinterlaceRows& rows, uint8_t* dst, uint32_t size, uint8_t threshold);
+
+// 32 bytes per block
+void InterpolateRow_AVX2(const uint8_t* above, const uint8_t* below, uint8_t* dst, uint32_t size);
+void DeinterlaceRow_AVX2(const DeinterlaceRows& rows, uint8_t* dst, uint32_t size, uint8_t threshold);
+void InterpolateRow16_AVX2(const uint8_t* above, const uint8_t* below, uint8_t* dst, uint32_t size);
+void DeinterlaceRow16_AVX2(const DeinterlaceRows& rows, uint8_t* dst, uint32_t size, uint8_t threshold);
@@ -0,0 +1,113 @@
+#include "frame_hash.h"
+#include "cpu_features.h"
+#include "frame_hash_kernels.h"
+
+namespace
+{
+struct FrameHashKernels
+{
+    const char* name = "C";
+
+    HashBlocksKernel hashBlocks = HashBlocks_C;
+};
+
+const FrameHashKernels ReferenceKernels;
+
+FrameHashKernels SelectKernels()
+{
+    FrameHashKernels kernels;
+
+#ifdef CPU_X86_64
+    if (GetCpuFeatures().avx2)
+    {
+        kernels = {"AVX2", HashBlocks_AVX2};
+    }
+#endif
+
+    info("CONVERT", "Using %s kernels for hashing frames.", kernels.name);
+
+    return kernels;
+}
+
+const FrameHashKernels& GetKernels()
+{
+    static const FrameHashKernels kernels = ::SelectKernels();
+    return kernels;
+}
+
+// Final mix of MurmurHash3, spreads every input bit over the whole value
+uint64_t Mix(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDull;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ull;
+    value ^= value >> 33;
+    return value;
+}
+
+uint64_t Hash(const Frame& frame, const FrameHashKernels& kernels, uint64_t seed)
+{
+    FrameHashState state;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        state.keys[i] = ::Mix(seed + FrameHashKeySteps[i]);
+    }
+
+    for (uint32_t i = 0; i < frame.planeCount; ++i)
+    {
+        const Frame::Plane& plane = frame.planes[i];
+
+        const uint32_t blockCount = plane.rowSize / FrameHashBlockSize;
+        const uint32_t restSize = plane.rowSize % FrameHashBlockSize;
+
+        for (uint32_t y = 0; y < plane.rows; ++y)
+        {
+            const uint8_t* row = reinterpret_cast<const uint8_t*>(plane.getRow(y));
+
+            kernels.hashBlocks(row, blockCount, state);
+
+            if (restSize > 0)
+            {
+                uint8_t rest[FrameHashBlockSize] = {};
+                std::memcpy(rest, row + blockCount * FrameHashBlockSize, restSize);
+                kernels.hashBlocks(rest, 1, state);
+            }
+        }
+    }
+
+    uint64_t hash = ::Mix(seed ^ (uint64_t(frame.width) << 32 | frame.height) ^ (uint64_t(frame.videoFormat) << 56));
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        hash = ::Mix(hash ^ state.sums[i]);
+    }
+
+    return hash;
+}
+} // namespace
+
+void HashBlocks_C(const uint8_t* src, uint32_t blockCount, FrameHashState& state)
+{
+    for (uint32_t b = 0; b < blockCount; ++b)
+    {
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            uint64_t data;
+            std::memcpy(&data, src + b * FrameHashBlockSize + i * 8, 8);
+
+            const uint64_t keyed = data ^ state.keys[i];
+            state.sums[i] += (keyed & 0xFFFFFFFF) * (keyed >> 32) + std::rotl(data, 32);
+            state.keys[i] += FrameHashKeySteps[i];
+        }
+    }
+}
+
+uint64_t HashFrame(const Frame& frame, uint64_t seed)
+{
+    return ::Hash(frame, ::GetKernels(), seed);
+}
+
+uint64_t HashFrameReference(const Frame& frame, uint64_t seed)
+{
+    return ::Hash(frame, ::ReferenceKernels, seed);
+}
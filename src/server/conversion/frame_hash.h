@@ -0,0 +1,12 @@
+#pragma once
+
+#include "video_input/frame.h"
+
+// Hashes the visible pixels of a frame, the padding at the end of its rows is skipped. Frames of different sizes or formats
+// hash differently, the seed lets the caller mix in settings which change what is made of the frame.
+// Meant to recognize repeated frames, not to withstand deliberate collisions. Uses the fastest kernel the CPU supports,
+// all kernels give the same result.
+uint64_t HashFrame(const Frame& frame, uint64_t seed = 0);
+
+// Same as HashFrame() but always uses the scalar kernel, as a reference for the SIMD one
+uint64_t HashFrameReference(const Frame& frame, uint64_t seed = 0);
@@ -0,0 +1,29 @@
+#include "frame_hash_kernels.h"
+#include "cpu_features.h"
+
+#ifdef CPU_X86_64
+#include <immintrin.h>
+
+void HashBlocks_AVX2(const uint8_t* src, uint32_t blockCount, FrameHashState& state)
+{
+    __m256i sums = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state.sums));
+    __m256i keys = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state.keys));
+    const __m256i steps = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(FrameHashKeySteps));
+
+    for (uint32_t b = 0; b < blockCount; ++b)
+    {
+        const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + b * FrameHashBlockSize));
+        const __m256i keyed = _mm256_xor_si256(data, keys);
+
+        // Multiplies the low and high 32 bits of every keyed lane, the swapped halves of the data keep its high bits in the sum
+        const __m256i product = _mm256_mul_epu32(keyed, _mm256_srli_epi64(keyed, 32));
+        const __m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(2, 3, 0, 1));
+
+        sums = _mm256_add_epi64(sums, _mm256_add_epi64(product, swapped));
+        keys = _mm256_add_epi64(keys, steps);
+    }
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(state.sums), sums);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(state.keys), keys);
+}
+#endif
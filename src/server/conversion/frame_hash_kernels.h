@@ -0,0 +1,23 @@
+#pragma once
+
+// Kernels used by HashFrame(), built like the NV12 kernels (see nv12_kernels.h)
+#include <cstdint>
+
+// Bytes hashed per block, the remainder of a row is padded with zeros to a whole block
+constexpr uint32_t FrameHashBlockSize = 32;
+
+// The key of every lane advances by its step after each block, so that the same block at another position adds something else
+constexpr uint64_t FrameHashKeySteps[4] = {0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull, 0xD6E8FEB86659FD93ull};
+
+// Each of the four 64 bit lanes of a block is mixed with its key and added to the lane's sum:
+//   keyed = data ^ key, sum += low32(keyed) * high32(keyed) + rotate(data, 32)
+struct FrameHashState
+{
+    uint64_t sums[4] = {};
+    uint64_t keys[4] = {};
+};
+
+using HashBlocksKernel = void (*)(const uint8_t* src, uint32_t blockCount, FrameHashState& state);
+
+void HashBlocks_C(const uint8_t* src, uint32_t blockCount, FrameHashState& state);
+void HashBlocks_AVX2(const uint8_t* src, uint32_t blockCount, FrameHashState& state);
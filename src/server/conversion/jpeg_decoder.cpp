@@ -0,0 +1,222 @@
+#include "jpeg_decoder.h"
+#include "scaler.h"
+
+#include <csetjmp>
+#include <cstdio>
+
+#include <jpeglib.h>
+
+namespace
+{
+// libjpeg reports fatal errors by calling error_exit, which must not return. It jumps back into decode() instead.
+struct ErrorManager
+{
+    jpeg_error_mgr base;
+    std::jmp_buf jump;
+};
+
+[[noreturn]] void ExitOnError(j_common_ptr info)
+{
+    char message[JMSG_LENGTH_MAX] = {};
+    info->err->format_message(info, message);
+    error("JPEG", "Failed to decode frame: %s", message);
+
+    std::longjmp(reinterpret_cast<ErrorManager*>(info->err)->jump, 1);
+}
+
+// Warnings like corrupt entropy data still produce an image, which is better than dropping the frame.
+// Logging them would flood the log for cameras which send them with every frame.
+void IgnoreMessage(j_common_ptr)
+{
+}
+
+// Maps full range samples to the limited range, 0..255 to 16..235 for luma and 16..240 for chroma
+constexpr std::array<uint8_t, 256> MakeRangeTable(uint32_t range)
+{
+    std::array<uint8_t, 256> table = {};
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        table[i] = uint8_t(16 + (i * range + 127) / 255);
+    }
+
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> LumaRange = MakeRangeTable(219);
+constexpr std::array<uint8_t, 256> ChromaRange = MakeRangeTable(224);
+
+void CopyLumaRow(const uint8_t* src, uint8_t* dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        dst[x] = LumaRange[src[x]];
+    }
+}
+
+// Interleaves one row of 4:2:0 chroma from the Cb and Cr rows, averaging StepX x StepY samples of the source for every output sample.
+// The rows of the decoded planes are padded to whole blocks, so the second sample of odd sizes is always there.
+template <uint32_t StepX, uint32_t StepY>
+void InterleaveChromaRow(const uint8_t* const* cb, const uint8_t* const* cr, uint8_t* dst, uint32_t chromaWidth)
+{
+    constexpr uint32_t Count = StepX * StepY;
+
+    for (uint32_t x = 0; x < chromaWidth; ++x)
+    {
+        uint32_t sumCb = Count / 2;
+        uint32_t sumCr = Count / 2;
+
+        for (uint32_t y = 0; y < StepY; ++y)
+        {
+            for (uint32_t i = 0; i < StepX; ++i)
+            {
+                sumCb += cb[y][x * StepX + i];
+                sumCr += cr[y][x * StepX + i];
+            }
+        }
+
+        dst[x * 2] = ChromaRange[sumCb / Count];
+        dst[x * 2 + 1] = ChromaRange[sumCr / Count];
+    }
+}
+
+using InterleaveChromaRowKernel = void (*)(const uint8_t* const* cb, const uint8_t* const* cr, uint8_t* dst, uint32_t chromaWidth);
+
+// Indexed by the chroma samples per output sample minus one, horizontally then vertically
+constexpr InterleaveChromaRowKernel InterleaveChromaRowKernels[2][2] = {{InterleaveChromaRow<1, 1>, InterleaveChromaRow<1, 2>},
+                                                                        {InterleaveChromaRow<2, 1>, InterleaveChromaRow<2, 2>}};
+} // namespace
+
+struct JpegDecoder::Context
+{
+    jpeg_decompress_struct decompress = {};
+    ErrorManager errorManager = {};
+
+    // One MCU row of every component and the row pointers into it, as jpeg_read_raw_data() wants them
+    std::array<std::vector<uint8_t>, 3> samples;
+    std::array<std::vector<JSAMPROW>, 3> rows;
+
+    Context()
+    {
+        decompress.err = jpeg_std_error(&errorManager.base);
+        errorManager.base.error_exit = ::ExitOnError;
+        errorManager.base.output_message = ::IgnoreMessage;
+
+        jpeg_create_decompress(&decompress);
+    }
+
+    ~Context()
+    {
+        jpeg_destroy_decompress(&decompress);
+    }
+};
+
+JpegDecoder::JpegDecoder() : m_context(std::make_unique<Context>())
+{
+}
+
+JpegDecoder::~JpegDecoder() = default;
+
+// Only trivial locals live across the setjmp(), so that jumping back from a libjpeg error skips no destructors
+bool JpegDecoder::decode(const std::byte* data, size_t size, uint32_t width, uint32_t height, const NV12Planes& dst)
+{
+    Context& context = *m_context;
+    jpeg_decompress_struct& decompress = context.decompress;
+
+    if (setjmp(context.errorManager.jump))
+    {
+        jpeg_abort_decompress(&decompress);
+        return false;
+    }
+
+    // MJPEG frames usually leave out the Huffman tables, libjpeg-turbo falls back to the standard ones like the format expects
+    jpeg_mem_src(&decompress, reinterpret_cast<const unsigned char*>(data), static_cast<unsigned long>(size));
+    jpeg_read_header(&decompress, TRUE);
+
+    const bool gray = decompress.jpeg_color_space == JCS_GRAYSCALE && decompress.num_components == 1;
+    const bool color = decompress.jpeg_color_space == JCS_YCbCr && decompress.num_components == 3;
+
+    // Luma may be sampled up to twice as often as chroma in each direction, chroma needs to be sampled once per MCU
+    const jpeg_component_info* components = decompress.comp_info;
+    const bool supportedSampling = gray || (color && components[0].h_samp_factor <= 2 && components[0].v_samp_factor <= 2 && components[1].h_samp_factor == 1 &&
+                                            components[1].v_samp_factor == 1 && components[2].h_samp_factor == 1 && components[2].v_samp_factor == 1);
+
+    if (!supportedSampling || decompress.image_width != width || decompress.image_height != height)
+    {
+        error("JPEG", "Unsupported %u x %u frame with %d components in color space %d, expected %u x %u YCbCr or grayscale.", decompress.image_width, decompress.image_height,
+              decompress.num_components, (int)decompress.jpeg_color_space, width, height);
+        jpeg_abort_decompress(&decompress);
+        return false;
+    }
+
+    decompress.out_color_space = decompress.jpeg_color_space;
+    decompress.raw_data_out = TRUE;
+    decompress.do_fancy_upsampling = FALSE;
+
+    jpeg_start_decompress(&decompress);
+
+    const uint32_t mcuRows = uint32_t(decompress.max_v_samp_factor) * DCTSIZE;
+    const uint32_t mcuColumns = uint32_t(decompress.max_h_samp_factor) * DCTSIZE;
+    const uint32_t mcusPerRow = (width + mcuColumns - 1) / mcuColumns;
+
+    JSAMPARRAY planes[3] = {};
+
+    for (int c = 0; c < decompress.num_components; ++c)
+    {
+        const size_t componentWidth = size_t(mcusPerRow) * components[c].h_samp_factor * DCTSIZE;
+        const size_t componentRows = size_t(components[c].v_samp_factor) * DCTSIZE;
+
+        context.samples[c].resize(componentWidth * componentRows);
+        context.rows[c].resize(componentRows);
+
+        for (size_t row = 0; row < componentRows; ++row)
+        {
+            context.rows[c][row] = context.samples[c].data() + row * componentWidth;
+        }
+
+        planes[c] = context.rows[c].data();
+    }
+
+    const uint32_t chromaWidth = (width + 1) / 2;
+    const InterleaveChromaRowKernel interleaveChromaRow =
+        color ? InterleaveChromaRowKernels[2 / decompress.max_h_samp_factor - 1][2 / decompress.max_v_samp_factor - 1] : nullptr;
+
+    while (decompress.output_scanline < decompress.output_height)
+    {
+        // MCU rows start at even rows, so they own the chroma rows of their row pairs
+        const uint32_t firstRow = decompress.output_scanline;
+        const uint32_t endRow = std::min(firstRow + mcuRows, height);
+
+        // Only a suspending data source returns no rows, the memory source pads truncated images instead
+        if (jpeg_read_raw_data(&decompress, planes, mcuRows) == 0)
+        {
+            jpeg_abort_decompress(&decompress);
+            return false;
+        }
+
+        for (uint32_t y = firstRow; y < endRow; ++y)
+        {
+            ::CopyLumaRow(planes[0][y - firstRow], reinterpret_cast<uint8_t*>(dst.y + y * dst.yPitch), width);
+        }
+
+        for (uint32_t y = firstRow / 2; y < (endRow + 1) / 2; ++y)
+        {
+            uint8_t* dstRow = reinterpret_cast<uint8_t*>(dst.uv + y * dst.uvPitch);
+
+            if (!interleaveChromaRow)
+            {
+                std::memset(dstRow, 128, size_t(chromaWidth) * 2);
+                continue;
+            }
+
+            // Chroma rows per output row, the source row of this output row within the MCU row
+            const uint32_t stepY = 2 / decompress.max_v_samp_factor;
+            const uint32_t sourceRow = (y - firstRow / 2) * stepY;
+
+            interleaveChromaRow(planes[1] + sourceRow, planes[2] + sourceRow, dstRow, chromaWidth);
+        }
+    }
+
+    jpeg_finish_decompress(&decompress);
+
+    return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+struct NV12Planes;
+
+// Decodes the JPEG images of MJPEG capture devices straight into NV12.
+//
+// libjpeg hands out the decoded YCbCr planes one MCU row at a time, which skips its color conversion and upsampling.
+// Each MCU row is copied into the destination while it is still in the cache. The full range samples of JPEG are
+// compressed to the limited range the encoder expects and 4:2:2 or 4:4:4 chroma is averaged down to 4:2:0.
+//
+// A decoder keeps its libjpeg state and row buffers between images, it must only be used by one thread at a time.
+class JpegDecoder
+{
+  public:
+    JpegDecoder();
+    ~JpegDecoder();
+
+    // Decodes an image of exactly the given size. Returns false if the data isn't a JPEG image of that size
+    // in YCbCr or grayscale with a sampling the decoder supports.
+    bool decode(const std::byte* data, size_t size, uint32_t width, uint32_t height, const NV12Planes& dst);
+
+  private:
+    struct Context;
+
+    std::unique_ptr<Context> m_context;
+};
@@ -0,0 +1,606 @@
+#include "nv12.h"
+#include "bgra.h"
+#include "bgra_kernels.h"
+#include "cpu_features.h"
+#include "nv12_kernels.h"
+#include "pipeline/thread_pool.h"
+#include "text_overlay.h"
+#include "video_input/video_format.h"
+
+namespace
+{
+// Position of a luma sample or U V pair in a row of the given size, counted from the end when mirroring
+template <bool Mirror>
+uint32_t Position(uint32_t x, uint32_t size)
+{
+    return Mirror ? size - 1 - x : x;
+}
+
+template <uint32_t LumaOffset, bool Mirror>
+void Packed422ToNV12Row(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    const uint32_t chromaOffset = 1 - LumaOffset;
+    const uint32_t chromaWidth = (width + 1) / 2;
+
+    for (uint32_t x = 0; x < width; x += 2)
+    {
+        const uint8_t* pixels0 = src0 + x * 2;
+        const uint8_t* pixels1 = src1 + x * 2;
+
+        dstY0[Position<Mirror>(x, width)] = pixels0[LumaOffset];
+        dstY1[Position<Mirror>(x, width)] = pixels1[LumaOffset];
+
+        // Odd widths still carry a full macro pixel, only its second luma sample is dropped
+        if (x + 1 < width)
+        {
+            dstY0[Position<Mirror>(x + 1, width)] = pixels0[LumaOffset + 2];
+            dstY1[Position<Mirror>(x + 1, width)] = pixels1[LumaOffset + 2];
+        }
+
+        uint8_t* uv = dstUV + Position<Mirror>(x / 2, chromaWidth) * 2;
+        uv[0] = uint8_t((pixels0[chromaOffset] + pixels1[chromaOffset] + 1) / 2);
+        uv[1] = uint8_t((pixels0[chromaOffset + 2] + pixels1[chromaOffset + 2] + 1) / 2);
+    }
+}
+
+uint8_t BGRAToLuma(const uint8_t* pixel)
+{
+    return uint8_t((BT709::LumaB * pixel[0] + BT709::LumaG * pixel[1] + BT709::LumaR * pixel[2] + BT709::LumaOffset) >> 15);
+}
+
+template <bool Mirror>
+void BGRAToNV12Row(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    const uint32_t chromaWidth = (width + 1) / 2;
+
+    for (uint32_t x = 0; x < width; x += 2)
+    {
+        // The last column of an odd width is paired with itself
+        const uint32_t x1 = std::min(x + 1, width - 1);
+
+        dstY0[Position<Mirror>(x, width)] = ::BGRAToLuma(src0 + x * 4);
+        dstY1[Position<Mirror>(x, width)] = ::BGRAToLuma(src1 + x * 4);
+        dstY0[Position<Mirror>(x1, width)] = ::BGRAToLuma(src0 + x1 * 4);
+        dstY1[Position<Mirror>(x1, width)] = ::BGRAToLuma(src1 + x1 * 4);
+
+        int32_t sum[3];
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            sum[c] = src0[x * 4 + c] + src0[x1 * 4 + c] + src1[x * 4 + c] + src1[x1 * 4 + c];
+        }
+
+        uint8_t* uv = dstUV + Position<Mirror>(x / 2, chromaWidth) * 2;
+        uv[0] = uint8_t((BT709::ChromaUB * sum[0] + BT709::ChromaUG * sum[1] + BT709::ChromaUR * sum[2] + BT709::ChromaOffset) >> BT709::ChromaShift);
+        uv[1] = uint8_t((BT709::ChromaVB * sum[0] + BT709::ChromaVG * sum[1] + BT709::ChromaVR * sum[2] + BT709::ChromaOffset) >> BT709::ChromaShift);
+    }
+}
+
+template <bool Mirror>
+void InterleaveUVRow(const uint8_t* srcU, const uint8_t* srcV, uint8_t* dstUV, uint32_t chromaWidth)
+{
+    for (uint32_t x = 0; x < chromaWidth; ++x)
+    {
+        uint8_t* uv = dstUV + Position<Mirror>(x, chromaWidth) * 2;
+        uv[0] = srcU[x];
+        uv[1] = srcV[x];
+    }
+}
+
+// Elements are copied as a whole, so that U V pairs stay in order
+template <typename Element>
+void MirrorRow(const uint8_t* src, uint8_t* dst, uint32_t count)
+{
+    for (uint32_t x = 0; x < count; ++x)
+    {
+        std::memcpy(dst + (count - 1 - x) * sizeof(Element), src + x * sizeof(Element), sizeof(Element));
+    }
+}
+
+// Rounds a little endian 16 bit sample to its upper 8 bits, saturating like the SIMD kernels
+uint8_t NarrowSample(const uint8_t* src)
+{
+    return uint8_t(std::min((src[0] | src[1] << 8) + 0x80, 0xffff) >> 8);
+}
+
+template <uint32_t ElementSize, bool Mirror>
+void NarrowRow(const uint8_t* src, uint8_t* dst, uint32_t count)
+{
+    for (uint32_t x = 0; x < count; ++x)
+    {
+        for (uint32_t i = 0; i < ElementSize; ++i)
+        {
+            dst[Position<Mirror>(x, count) * ElementSize + i] = ::NarrowSample(src + (x * ElementSize + i) * 2);
+        }
+    }
+}
+
+void ExpandRGB24Row(const uint8_t* src, uint8_t* dst, uint32_t width)
+{
+    ExpandRGB24ToBGRA(reinterpret_cast<const std::byte*>(src), reinterpret_cast<std::byte*>(dst), width);
+}
+
+struct Kernels
+{
+    const char* name = "C";
+
+    // Pixels the SIMD kernels process per block, the remainder of a row is handled by the scalar kernels
+    uint32_t blockSize = 1;
+
+    RowPairKernel yuy2 = Yuy2ToNV12Row_C;
+    RowPairKernel uyvy = UyvyToNV12Row_C;
+    RowPairKernel bgra = BGRAToNV12Row_C;
+    InterleaveRowKernel interleaveUV = InterleaveUVRow_C;
+
+    // RGB24 is expanded to BGRA row by row first, this handles any width
+    void (*expandRGB24)(const uint8_t* src, uint8_t* dst, uint32_t width) = RGB24ToBGRARow_C;
+
+    // SIMD variants for mirroring with the same block size, without them the scalar kernels convert the whole row
+    RowPairKernel yuy2Mirror = nullptr;
+    RowPairKernel uyvyMirror = nullptr;
+    RowPairKernel bgraMirror = nullptr;
+    InterleaveRowKernel interleaveUVMirror = nullptr;
+    MirrorRowKernel mirrorY = nullptr;
+    MirrorRowKernel mirrorUV = nullptr;
+
+    // P010 is narrowed to 8 bits while it is copied, mirrored or not
+    NarrowRowKernel narrow = nullptr;
+    NarrowRowKernel narrowMirrorY = nullptr;
+    NarrowRowKernel narrowMirrorUV = nullptr;
+};
+
+const Kernels ReferenceKernels;
+
+Kernels SelectKernels()
+{
+    Kernels kernels;
+
+#ifdef CPU_X86_64
+    const CpuFeatures& features = GetCpuFeatures();
+
+    // There is no SSSE3 color conversion or mirroring, those fall back to the scalar kernels for whole rows
+    if (features.avx2)
+    {
+        kernels = {"AVX2", 32, Yuy2ToNV12Row_AVX2, UyvyToNV12Row_AVX2, BGRAToNV12Row_AVX2, InterleaveUVRow_AVX2, ExpandRGB24Row};
+
+        kernels.yuy2Mirror = Yuy2ToNV12RowMirror_AVX2;
+        kernels.uyvyMirror = UyvyToNV12RowMirror_AVX2;
+        kernels.bgraMirror = BGRAToNV12RowMirror_AVX2;
+        kernels.interleaveUVMirror = InterleaveUVRowMirror_AVX2;
+        kernels.mirrorY = MirrorRow8_AVX2;
+        kernels.mirrorUV = MirrorRow16_AVX2;
+        kernels.narrow = NarrowRow_AVX2;
+        kernels.narrowMirrorY = NarrowRowMirror8_AVX2;
+        kernels.narrowMirrorUV = NarrowRowMirror16_AVX2;
+    }
+    else if (features.ssse3)
+    {
+        kernels = {"SSSE3", 16, Yuy2ToNV12Row_SSSE3, UyvyToNV12Row_SSSE3, nullptr, InterleaveUVRow_SSSE3, ExpandRGB24Row};
+    }
+#endif
+
+    info("CONVERT", "Using %s kernels for the conversion to NV12.", kernels.name);
+
+    return kernels;
+}
+
+const Kernels& GetKernels()
+{
+    static const Kernels kernels = ::SelectKernels();
+    return kernels;
+}
+
+uint32_t AlignDown(uint32_t value, uint32_t blockSize)
+{
+    return value - value % blockSize;
+}
+
+// Source row of a destination row, counted from the bottom when flipping
+uint32_t SourceRow(uint32_t y, uint32_t rows, bool flip)
+{
+    return flip ? rows - 1 - y : y;
+}
+
+// Destination of a conversion, points at the first luma and chroma row
+struct Destination
+{
+    uint8_t* y = nullptr;
+    size_t yPitch = 0;
+    uint8_t* uv = nullptr;
+    size_t uvPitch = 0;
+};
+
+// Copies the rows of an NV12 plane, the element size is 1 for luma and 2 for the U V pairs
+void CopyRows(const Frame::Plane& plane, const Kernels& kernels, Orientation orientation, uint32_t elementSize, uint32_t firstRow, uint32_t endRow, uint8_t* dst,
+              size_t dstPitch)
+{
+    const MirrorRowKernel kernel = elementSize == 1 ? kernels.mirrorY : kernels.mirrorUV;
+    const MirrorRowKernel scalarKernel = elementSize == 1 ? MirrorRow8_C : MirrorRow16_C;
+
+    const uint32_t count = plane.rowSize / elementSize;
+    const uint32_t blockCount = kernel ? AlignDown(count, kernels.blockSize) : 0;
+
+    for (uint32_t y = firstRow; y < endRow; ++y)
+    {
+        const uint8_t* src = reinterpret_cast<const uint8_t*>(plane.getRow(::SourceRow(y, plane.rows, orientation.flip)));
+        uint8_t* row = dst + y * dstPitch;
+
+        if (!orientation.mirror)
+        {
+            std::memcpy(row, src, plane.rowSize);
+            continue;
+        }
+
+        // The mirrored blocks go to the end of the row and the rest to its start
+        if (blockCount > 0)
+        {
+            kernel(src, row + (count - blockCount) * elementSize, blockCount);
+        }
+
+        scalarKernel(src + blockCount * elementSize, row, count - blockCount);
+    }
+}
+
+// Narrows the rows of a P010 plane into an NV12 plane, the element size is 1 for luma and 2 for the U V pairs
+void NarrowRows(const Frame::Plane& plane, const Kernels& kernels, Orientation orientation, uint32_t elementSize, uint32_t firstRow, uint32_t endRow, uint8_t* dst,
+                size_t dstPitch)
+{
+    const NarrowRowKernel kernel = orientation.mirror ? (elementSize == 1 ? kernels.narrowMirrorY : kernels.narrowMirrorUV) : kernels.narrow;
+    const NarrowRowKernel scalarKernel = orientation.mirror ? (elementSize == 1 ? NarrowRowMirror8_C : NarrowRowMirror16_C) : NarrowRow_C;
+
+    // Elements of 8 bit output, every one of them reads twice its size
+    const uint32_t count = plane.rowSize / (elementSize * 2);
+    const uint32_t blockCount = kernel ? AlignDown(count, kernels.blockSize) : 0;
+
+    for (uint32_t y = firstRow; y < endRow; ++y)
+    {
+        const uint8_t* src = reinterpret_cast<const uint8_t*>(plane.getRow(::SourceRow(y, plane.rows, orientation.flip)));
+        uint8_t* row = dst + y * dstPitch;
+
+        if (!orientation.mirror)
+        {
+            // The plain kernels don't care about element boundaries and take the number of samples
+            if (blockCount > 0)
+            {
+                kernel(src, row, blockCount * elementSize);
+            }
+
+            scalarKernel(src + blockCount * elementSize * 2, row + blockCount * elementSize, (count - blockCount) * elementSize);
+            continue;
+        }
+
+        // The mirrored blocks go to the end of the row and the rest to its start
+        if (blockCount > 0)
+        {
+            kernel(src, row + (count - blockCount) * elementSize, blockCount);
+        }
+
+        scalarKernel(src + blockCount * elementSize * 2, row, count - blockCount);
+    }
+}
+
+// Runs a row pair kernel over the rows, the source rows are taken from the plane or from the row source.
+// The bytes per pixel are a constant of the format, so that the offsets of the row tails fold into the instantiation.
+template <uint32_t BytesPerPixel, typename RowSource>
+void ConvertRowPairs(const Frame& frame, RowPairKernel kernel, RowPairKernel scalarKernel, uint32_t blockSize, Orientation orientation, uint32_t firstRow, uint32_t endRow,
+                     const Destination& dst, RowSource&& getRow)
+{
+    // Kernels without a SIMD variant run the scalar kernel for the whole row
+    const uint32_t blockWidth = kernel ? AlignDown(frame.width, blockSize) : 0;
+    const uint32_t restWidth = frame.width - blockWidth;
+
+    // Mirrored kernels write the blocks to the end of the destination rows and the rest to their start.
+    // The chroma offsets are in bytes, for odd widths the last U V pair only covers one pixel.
+    const uint32_t chromaRowSize = (frame.width + 1) / 2 * 2;
+    const uint32_t blockLumaOffset = orientation.mirror ? restWidth : 0;
+    const uint32_t blockChromaOffset = orientation.mirror ? chromaRowSize - blockWidth : 0;
+    const uint32_t restLumaOffset = orientation.mirror ? 0 : blockWidth;
+    const uint32_t restChromaOffset = orientation.mirror ? 0 : blockWidth;
+
+    for (uint32_t y = firstRow; y < endRow; y += 2)
+    {
+        // The last row of an odd height is paired with itself
+        const uint32_t y1 = std::min(y + 1, frame.height - 1);
+
+        const uint8_t* src0 = getRow(::SourceRow(y, frame.height, orientation.flip), 0);
+        const uint8_t* src1 = y1 == y ? src0 : getRow(::SourceRow(y1, frame.height, orientation.flip), 1);
+        uint8_t* dstY0 = dst.y + y * dst.yPitch;
+        uint8_t* dstY1 = dst.y + y1 * dst.yPitch;
+        uint8_t* dstUV = dst.uv + (y / 2) * dst.uvPitch;
+
+        if (blockWidth > 0)
+        {
+            kernel(src0, src1, dstY0 + blockLumaOffset, dstY1 + blockLumaOffset, dstUV + blockChromaOffset, blockWidth);
+        }
+
+        if (restWidth > 0)
+        {
+            const uint32_t offset = blockWidth * BytesPerPixel;
+            scalarKernel(src0 + offset, src1 + offset, dstY0 + restLumaOffset, dstY1 + restLumaOffset, dstUV + restChromaOffset, restWidth);
+        }
+    }
+}
+
+// Row pair kernels of the packed formats, RGB24 uses the BGRA ones after expanding its rows
+template <IDevice::VideoFormat Format>
+struct RowPairKernels;
+
+template <>
+struct RowPairKernels<IDevice::VideoFormat::YUY2>
+{
+    static constexpr RowPairKernel Kernels::*kernel = &Kernels::yuy2;
+    static constexpr RowPairKernel Kernels::*mirrorKernel = &Kernels::yuy2Mirror;
+    static constexpr RowPairKernel scalarKernel = Yuy2ToNV12Row_C;
+    static constexpr RowPairKernel scalarMirrorKernel = Yuy2ToNV12RowMirror_C;
+};
+
+template <>
+struct RowPairKernels<IDevice::VideoFormat::UYVY>
+{
+    static constexpr RowPairKernel Kernels::*kernel = &Kernels::uyvy;
+    static constexpr RowPairKernel Kernels::*mirrorKernel = &Kernels::uyvyMirror;
+    static constexpr RowPairKernel scalarKernel = UyvyToNV12Row_C;
+    static constexpr RowPairKernel scalarMirrorKernel = UyvyToNV12RowMirror_C;
+};
+
+template <>
+struct RowPairKernels<IDevice::VideoFormat::BGRA>
+{
+    static constexpr RowPairKernel Kernels::*kernel = &Kernels::bgra;
+    static constexpr RowPairKernel Kernels::*mirrorKernel = &Kernels::bgraMirror;
+    static constexpr RowPairKernel scalarKernel = BGRAToNV12Row_C;
+    static constexpr RowPairKernel scalarMirrorKernel = BGRAToNV12RowMirror_C;
+};
+
+template <>
+struct RowPairKernels<IDevice::VideoFormat::RGB24> : RowPairKernels<IDevice::VideoFormat::BGRA>
+{
+};
+
+// Converts the rows [firstRow, endRow) of a frame in the given format, firstRow needs to be even.
+// The packed formats share this one, the others are specialized below.
+template <IDevice::VideoFormat Format>
+bool ConvertRows(const Frame& frame, const Kernels& kernels, Orientation orientation, const Destination& dst, uint32_t firstRow, uint32_t endRow)
+{
+    using RowKernels = RowPairKernels<Format>;
+    constexpr PlaneFormat Plane = VideoFormatTraits<Format>::info.planes[0];
+
+    auto planeRows = [&frame](uint32_t y, uint32_t) { return reinterpret_cast<const uint8_t*>(frame.planes[0].getRow(y)); };
+
+    const bool mirror = orientation.mirror;
+    ::ConvertRowPairs<(Plane.bytesPerSample >> Plane.shiftX)>(frame, mirror ? kernels.*RowKernels::mirrorKernel : kernels.*RowKernels::kernel,
+                                                              mirror ? RowKernels::scalarMirrorKernel : RowKernels::scalarKernel, kernels.blockSize, orientation, firstRow,
+                                                              endRow, dst, planeRows);
+    return true;
+}
+
+template <>
+bool ConvertRows<IDevice::VideoFormat::Unknown>(const Frame& frame, const Kernels&, Orientation, const Destination&, uint32_t, uint32_t)
+{
+    error("CONVERT", "Can't convert video format %d to NV12.", (int)frame.videoFormat);
+    return false;
+}
+
+// Compressed frames are decoded to NV12 before they reach the converter, see MJPEGDecodedDevice
+template <>
+bool ConvertRows<IDevice::VideoFormat::MJPEG>(const Frame& frame, const Kernels& kernels, Orientation orientation, const Destination& dst, uint32_t firstRow, uint32_t endRow)
+{
+    return ConvertRows<IDevice::VideoFormat::Unknown>(frame, kernels, orientation, dst, firstRow, endRow);
+}
+
+template <>
+bool ConvertRows<IDevice::VideoFormat::NV12>(const Frame& frame, const Kernels& kernels, Orientation orientation, const Destination& dst, uint32_t firstRow, uint32_t endRow)
+{
+    constexpr auto& Planes = VideoFormatTraits<IDevice::VideoFormat::NV12>::info.planes;
+
+    ::CopyRows(frame.planes[0], kernels, orientation, Planes[0].bytesPerSample, firstRow, endRow, dst.y, dst.yPitch);
+    ::CopyRows(frame.planes[1], kernels, orientation, Planes[1].bytesPerSample, firstRow / 2, (endRow + 1) / 2, dst.uv, dst.uvPitch);
+    return true;
+}
+
+template <>
+bool ConvertRows<IDevice::VideoFormat::P010>(const Frame& frame, const Kernels& kernels, Orientation orientation, const Destination& dst, uint32_t firstRow, uint32_t endRow)
+{
+    ::NarrowRows(frame.planes[0], kernels, orientation, 1, firstRow, endRow, dst.y, dst.yPitch);
+    ::NarrowRows(frame.planes[1], kernels, orientation, 2, firstRow / 2, (endRow + 1) / 2, dst.uv, dst.uvPitch);
+    return true;
+}
+
+template <>
+bool ConvertRows<IDevice::VideoFormat::I420>(const Frame& frame, const Kernels& kernels, Orientation orientation, const Destination& dst, uint32_t firstRow, uint32_t endRow)
+{
+    ::CopyRows(frame.planes[0], kernels, orientation, 1, firstRow, endRow, dst.y, dst.yPitch);
+
+    const Frame::Plane& planeU = frame.planes[1];
+    const Frame::Plane& planeV = frame.planes[2];
+
+    const bool mirror = orientation.mirror;
+    const InterleaveRowKernel kernel = mirror ? kernels.interleaveUVMirror : kernels.interleaveUV;
+    const InterleaveRowKernel scalarKernel = mirror ? InterleaveUVRowMirror_C : InterleaveUVRow_C;
+
+    const uint32_t chromaWidth = planeU.rowSize;
+    const uint32_t blockWidth = kernel ? AlignDown(chromaWidth, kernels.blockSize) : 0;
+    const uint32_t restWidth = chromaWidth - blockWidth;
+
+    for (uint32_t y = firstRow / 2; y < (endRow + 1) / 2; ++y)
+    {
+        const uint32_t sourceRow = ::SourceRow(y, planeU.rows, orientation.flip);
+        const uint8_t* srcU = reinterpret_cast<const uint8_t*>(planeU.getRow(sourceRow));
+        const uint8_t* srcV = reinterpret_cast<const uint8_t*>(planeV.getRow(sourceRow));
+        uint8_t* dstUV = dst.uv + y * dst.uvPitch;
+
+        if (blockWidth > 0)
+        {
+            kernel(srcU, srcV, dstUV + (mirror ? restWidth : 0) * 2, blockWidth);
+        }
+
+        scalarKernel(srcU + blockWidth, srcV + blockWidth, dstUV + (mirror ? 0 : blockWidth) * 2, restWidth);
+    }
+
+    return true;
+}
+
+template <>
+bool ConvertRows<IDevice::VideoFormat::RGB24>(const Frame& frame, const Kernels& kernels, Orientation orientation, const Destination& dst, uint32_t firstRow, uint32_t endRow)
+{
+    using RowKernels = RowPairKernels<IDevice::VideoFormat::RGB24>;
+
+    // Each thread keeps its own scratch rows, so that the expansion doesn't allocate per frame
+    thread_local std::vector<uint8_t> scratch;
+    scratch.resize(size_t(frame.width) * 4 * 2);
+
+    auto expandedRows = [&](uint32_t y, uint32_t scratchRow)
+    {
+        uint8_t* row = scratch.data() + size_t(frame.width) * 4 * scratchRow;
+        kernels.expandRGB24(reinterpret_cast<const uint8_t*>(frame.planes[0].getRow(y)), row, frame.width);
+        return static_cast<const uint8_t*>(row);
+    };
+
+    // The kernels read the expanded rows, which have 4 bytes per pixel
+    const bool mirror = orientation.mirror;
+    ::ConvertRowPairs<4>(frame, mirror ? kernels.*RowKernels::mirrorKernel : kernels.*RowKernels::kernel, mirror ? RowKernels::scalarMirrorKernel : RowKernels::scalarKernel,
+                         kernels.blockSize, orientation, firstRow, endRow, dst, expandedRows);
+    return true;
+}
+
+using ConvertFunction = bool (*)(const Frame& frame, const Kernels& kernels, Orientation orientation, const Destination& dst, uint32_t firstRow, uint32_t endRow);
+
+// Indexed by the video format, so that picking the conversion of a frame is a single lookup
+constexpr auto ConvertFunctions = MakeVideoFormatTable([](auto format) -> ConvertFunction { return ConvertRows<format.value>; });
+
+ConvertFunction GetConvertFunction(IDevice::VideoFormat videoFormat)
+{
+    const size_t index = size_t(videoFormat);
+    return index < ConvertFunctions.size() ? ConvertFunctions[index] : ConvertFunctions[0];
+}
+
+Destination MakeDestination(std::byte* dstY, size_t dstYPitch, std::byte* dstUV, size_t dstUVPitch)
+{
+    return {reinterpret_cast<uint8_t*>(dstY), dstYPitch, reinterpret_cast<uint8_t*>(dstUV), dstUVPitch};
+}
+} // namespace
+
+void Yuy2ToNV12Row_C(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    ::Packed422ToNV12Row<0, false>(src0, src1, dstY0, dstY1, dstUV, width);
+}
+
+void UyvyToNV12Row_C(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    ::Packed422ToNV12Row<1, false>(src0, src1, dstY0, dstY1, dstUV, width);
+}
+
+void BGRAToNV12Row_C(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    ::BGRAToNV12Row<false>(src0, src1, dstY0, dstY1, dstUV, width);
+}
+
+void InterleaveUVRow_C(const uint8_t* srcU, const uint8_t* srcV, uint8_t* dstUV, uint32_t chromaWidth)
+{
+    ::InterleaveUVRow<false>(srcU, srcV, dstUV, chromaWidth);
+}
+
+void Yuy2ToNV12RowMirror_C(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    ::Packed422ToNV12Row<0, true>(src0, src1, dstY0, dstY1, dstUV, width);
+}
+
+void UyvyToNV12RowMirror_C(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    ::Packed422ToNV12Row<1, true>(src0, src1, dstY0, dstY1, dstUV, width);
+}
+
+void BGRAToNV12RowMirror_C(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    ::BGRAToNV12Row<true>(src0, src1, dstY0, dstY1, dstUV, width);
+}
+
+void InterleaveUVRowMirror_C(const uint8_t* srcU, const uint8_t* srcV, uint8_t* dstUV, uint32_t chromaWidth)
+{
+    ::InterleaveUVRow<true>(srcU, srcV, dstUV, chromaWidth);
+}
+
+void MirrorRow8_C(const uint8_t* src, uint8_t* dst, uint32_t count)
+{
+    ::MirrorRow<uint8_t>(src, dst, count);
+}
+
+void MirrorRow16_C(const uint8_t* src, uint8_t* dst, uint32_t count)
+{
+    ::MirrorRow<uint16_t>(src, dst, count);
+}
+
+void NarrowRow_C(const uint8_t* src, uint8_t* dst, uint32_t count)
+{
+    ::NarrowRow<1, false>(src, dst, count);
+}
+
+void NarrowRowMirror8_C(const uint8_t* src, uint8_t* dst, uint32_t count)
+{
+    ::NarrowRow<1, true>(src, dst, count);
+}
+
+void NarrowRowMirror16_C(const uint8_t* src, uint8_t* dst, uint32_t count)
+{
+    ::NarrowRow<2, true>(src, dst, count);
+}
+
+bool IsYUVFormat(IDevice::VideoFormat videoFormat)
+{
+    return GetVideoFormatInfo(videoFormat).yuv;
+}
+
+bool ConvertToNV12(const Frame& frame, std::byte* dstY, size_t dstYPitch, std::byte* dstUV, size_t dstUVPitch, Orientation orientation)
+{
+    return ::GetConvertFunction(frame.videoFormat)(frame, ::GetKernels(), orientation, ::MakeDestination(dstY, dstYPitch, dstUV, dstUVPitch), 0, frame.height);
+}
+
+bool ConvertToNV12Reference(const Frame& frame, std::byte* dstY, size_t dstYPitch, std::byte* dstUV, size_t dstUVPitch, Orientation orientation)
+{
+    return ::GetConvertFunction(frame.videoFormat)(frame, ::ReferenceKernels, orientation, ::MakeDestination(dstY, dstYPitch, dstUV, dstUVPitch), 0, frame.height);
+}
+
+NV12Converter::NV12Converter(IDevice::VideoFormat videoFormat, uint32_t threadCount)
+    : m_videoFormat(videoFormat), m_threadPool(std::make_unique<ThreadPool>(std::max(threadCount, 1u)))
+{
+    info("CONVERT", "Converting %s to NV12 on %d threads.", GetVideoFormatInfo(videoFormat).name, m_threadPool->getThreadCount());
+}
+
+NV12Converter::~NV12Converter() = default;
+
+bool NV12Converter::convert(const Frame& frame, std::byte* dstY, size_t dstYPitch, std::byte* dstUV, size_t dstUVPitch, Orientation orientation, const TextOverlay* overlay)
+{
+    if (frame.videoFormat != m_videoFormat)
+    {
+        error("CONVERT", "Got a frame in video format %d, the converter was set up for %d.", (int)frame.videoFormat, (int)m_videoFormat);
+        return false;
+    }
+
+    // The bands all run the conversion of the format without branching on it again
+    const ConvertFunction convertRows = ::GetConvertFunction(m_videoFormat);
+    const Kernels& kernels = ::GetKernels();
+    const Destination dst = ::MakeDestination(dstY, dstYPitch, dstUV, dstUVPitch);
+
+    // A few bands per thread balance the load if some threads get descheduled, bands start at even rows for the chroma
+    const uint32_t bandCount = std::max(1u, std::min(m_threadPool->getThreadCount() * 4, frame.height / 16));
+    const uint32_t bandHeight = (frame.height / bandCount + 1) & ~1u;
+
+    std::atomic<bool> success = true;
+
+    m_threadPool->parallelFor(bandCount,
+                              [&](uint32_t band)
+                              {
+                                  const uint32_t firstRow = std::min(band * bandHeight, frame.height);
+                                  const uint32_t endRow = band + 1 == bandCount ? frame.height : std::min(firstRow + bandHeight, frame.height);
+
+                                  if (firstRow < endRow && !convertRows(frame, kernels, orientation, dst, firstRow, endRow))
+                                  {
+                                      success = false;
+                                  }
+                                  else if (overlay)
+                                  {
+                                      overlay->drawNV12(dstY, dstYPitch, dstUV, dstUVPitch, frame.width, firstRow, endRow);
+                                  }
+                              });
+
+    return success;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "orientation.h"
+#include "video_input/frame.h"
+
+class TextOverlay;
+class ThreadPool;
+
+// True for the YUV formats, which ConvertToNV12() only needs to repack instead of doing a color conversion
+bool IsYUVFormat(IDevice::VideoFormat videoFormat);
+
+// Writes the frame as NV12 into the destination planes. Uses the fastest kernels the CPU supports.
+// Packed 4:2:2 formats are subsampled vertically by averaging the chroma of each row pair.
+// BGRA and RGB24 are converted to BT.709 limited range, with the chroma of each 2x2 block averaged.
+bool ConvertToNV12(const Frame& frame, std::byte* dstY, size_t dstYPitch, std::byte* dstUV, size_t dstUVPitch, Orientation orientation = {});
+
+// Same as ConvertToNV12() but always uses the scalar kernels, as a reference for the SIMD ones
+bool ConvertToNV12Reference(const Frame& frame, std::byte* dstY, size_t dstYPitch, std::byte* dstUV, size_t dstUVPitch, Orientation orientation = {});
+
+// Runs ConvertToNV12() on several threads, each one converting a band of rows.
+// This is the CPU alternative to RGBToNV12ConverterD3D11, which works for any encoder backend.
+// A converter handles the frames of one video format, a single thread converts on the calling thread.
+class NV12Converter
+{
+  public:
+    NV12Converter(IDevice::VideoFormat videoFormat, uint32_t threadCount);
+    ~NV12Converter();
+
+    // The overlay is drawn by each band right after converting it, while the band's rows are still in the cache
+    bool convert(const Frame& frame, std::byte* dstY, size_t dstYPitch, std::byte* dstUV, size_t dstUVPitch, Orientation orientation = {},
+                 const TextOverlay* overlay = nullptr);
+
+  private:
+    IDevice::VideoFormat m_videoFormat = IDevice::VideoFormat::Unknown;
+    std::unique_ptr<ThreadPool> m_threadPool;
+};
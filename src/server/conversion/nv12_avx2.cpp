@@ -0,0 +1,249 @@
+#include "nv12_kernels.h"
+#include "cpu_features.h"
+
+#ifdef CPU_X86_64
+#include <immintrin.h>
+
+namespace
+{
+// Same as the SSSE3 version, the shuffle works on both 128 bit lanes independently
+template <uint32_t LumaOffset>
+__m256i SplitPacked422(__m256i pixels)
+{
+    const __m256i mask = LumaOffset == 0 ? _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15, 0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15)
+                                         : _mm256_setr_epi8(1, 3, 5, 7, 9, 11, 13, 15, 0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15, 0, 2, 4, 6, 8, 10, 12, 14);
+    return _mm256_shuffle_epi8(pixels, mask);
+}
+
+// Unpacking works per lane as well, which leaves the 64 bit blocks in 0 2 1 3 order
+__m256i FixLaneOrder(__m256i value)
+{
+    return _mm256_permute4x64_epi64(value, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+// Reverses the order of the bytes (ElementSize 1) or of the 16 bit U V pairs (ElementSize 2)
+template <uint32_t ElementSize>
+__m256i Reverse(__m256i value)
+{
+    const __m256i mask = ElementSize == 1 ? _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+                                          : _mm256_setr_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1, 14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+    return _mm256_permute4x64_epi64(_mm256_shuffle_epi8(value, mask), _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+// Stores 32 bytes at the offset into the row, or reversed at the mirrored offset
+template <bool Mirror, uint32_t ElementSize>
+void StoreRow(uint8_t* row, uint32_t rowSize, uint32_t offset, __m256i value)
+{
+    if constexpr (Mirror)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + rowSize - offset - 32), Reverse<ElementSize>(value));
+    }
+    else
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + offset), value);
+    }
+}
+
+// Luma of 8 BGRA pixels as 32 bit values
+__m256i BGRAToLuma(__m256i pixels)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i coefficients = _mm256_setr_epi16(BT709::LumaB, BT709::LumaG, BT709::LumaR, 0, BT709::LumaB, BT709::LumaG, BT709::LumaR, 0, BT709::LumaB, BT709::LumaG,
+                                                   BT709::LumaR, 0, BT709::LumaB, BT709::LumaG, BT709::LumaR, 0);
+
+    // The pixels of the low and high unpack end up in the right order again after the horizontal add
+    const __m256i low = _mm256_madd_epi16(_mm256_unpacklo_epi8(pixels, zero), coefficients);
+    const __m256i high = _mm256_madd_epi16(_mm256_unpackhi_epi8(pixels, zero), coefficients);
+
+    return _mm256_srai_epi32(_mm256_add_epi32(_mm256_hadd_epi32(low, high), _mm256_set1_epi32(BT709::LumaOffset)), 15);
+}
+
+// Packs 4 x 8 luma values to 32 bytes
+__m256i PackLuma(__m256i luma0, __m256i luma1, __m256i luma2, __m256i luma3)
+{
+    const __m256i words01 = FixLaneOrder(_mm256_packs_epi32(luma0, luma1));
+    const __m256i words23 = FixLaneOrder(_mm256_packs_epi32(luma2, luma3));
+
+    return FixLaneOrder(_mm256_packus_epi16(words01, words23));
+}
+
+// One chroma component for 16 pixels of two rows (8 x 2 x 2 blocks), given as 16 bit sums of both rows
+__m256i BlockChroma(__m256i sumsLow0, __m256i sumsHigh0, __m256i sumsLow1, __m256i sumsHigh1, __m256i coefficients)
+{
+    const __m256i pixels0 = _mm256_hadd_epi32(_mm256_madd_epi16(sumsLow0, coefficients), _mm256_madd_epi16(sumsHigh0, coefficients));
+    const __m256i pixels1 = _mm256_hadd_epi32(_mm256_madd_epi16(sumsLow1, coefficients), _mm256_madd_epi16(sumsHigh1, coefficients));
+
+    // Adding horizontal neighbours leaves the blocks in 0 1 4 5 2 3 6 7 order
+    const __m256i blocks = _mm256_permutevar8x32_epi32(_mm256_hadd_epi32(pixels0, pixels1), _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7));
+
+    return _mm256_srai_epi32(_mm256_add_epi32(blocks, _mm256_set1_epi32(BT709::ChromaOffset)), BT709::ChromaShift);
+}
+
+template <uint32_t LumaOffset, bool Mirror>
+void Packed422ToNV12Row(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; x += 32)
+    {
+        const __m256i row0a = SplitPacked422<LumaOffset>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src0 + x * 2)));
+        const __m256i row0b = SplitPacked422<LumaOffset>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src0 + x * 2 + 32)));
+        const __m256i row1a = SplitPacked422<LumaOffset>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + x * 2)));
+        const __m256i row1b = SplitPacked422<LumaOffset>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + x * 2 + 32)));
+
+        StoreRow<Mirror, 1>(dstY0, width, x, FixLaneOrder(_mm256_unpacklo_epi64(row0a, row0b)));
+        StoreRow<Mirror, 1>(dstY1, width, x, FixLaneOrder(_mm256_unpacklo_epi64(row1a, row1b)));
+
+        const __m256i chroma = _mm256_avg_epu8(_mm256_unpackhi_epi64(row0a, row0b), _mm256_unpackhi_epi64(row1a, row1b));
+        StoreRow<Mirror, 2>(dstUV, width, x, FixLaneOrder(chroma));
+    }
+}
+
+template <bool Mirror>
+void BGRAToNV12Row(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i coefficientsU = _mm256_setr_epi16(BT709::ChromaUB, BT709::ChromaUG, BT709::ChromaUR, 0, BT709::ChromaUB, BT709::ChromaUG, BT709::ChromaUR, 0, BT709::ChromaUB,
+                                                    BT709::ChromaUG, BT709::ChromaUR, 0, BT709::ChromaUB, BT709::ChromaUG, BT709::ChromaUR, 0);
+    const __m256i coefficientsV = _mm256_setr_epi16(BT709::ChromaVB, BT709::ChromaVG, BT709::ChromaVR, 0, BT709::ChromaVB, BT709::ChromaVG, BT709::ChromaVR, 0, BT709::ChromaVB,
+                                                    BT709::ChromaVG, BT709::ChromaVR, 0, BT709::ChromaVB, BT709::ChromaVG, BT709::ChromaVR, 0);
+
+    for (uint32_t x = 0; x < width; x += 32)
+    {
+        __m256i row0[4], row1[4];
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            row0[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src0 + (x + i * 8) * 4));
+            row1[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + (x + i * 8) * 4));
+        }
+
+        StoreRow<Mirror, 1>(dstY0, width, x, PackLuma(BGRAToLuma(row0[0]), BGRAToLuma(row0[1]), BGRAToLuma(row0[2]), BGRAToLuma(row0[3])));
+        StoreRow<Mirror, 1>(dstY1, width, x, PackLuma(BGRAToLuma(row1[0]), BGRAToLuma(row1[1]), BGRAToLuma(row1[2]), BGRAToLuma(row1[3])));
+
+        // Vertical sums of both rows as 16 bit values, the horizontal ones are added after the multiplication
+        __m256i sumsLow[4], sumsHigh[4];
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            sumsLow[i] = _mm256_add_epi16(_mm256_unpacklo_epi8(row0[i], zero), _mm256_unpacklo_epi8(row1[i], zero));
+            sumsHigh[i] = _mm256_add_epi16(_mm256_unpackhi_epi8(row0[i], zero), _mm256_unpackhi_epi8(row1[i], zero));
+        }
+
+        const __m256i u0 = BlockChroma(sumsLow[0], sumsHigh[0], sumsLow[1], sumsHigh[1], coefficientsU);
+        const __m256i u1 = BlockChroma(sumsLow[2], sumsHigh[2], sumsLow[3], sumsHigh[3], coefficientsU);
+        const __m256i v0 = BlockChroma(sumsLow[0], sumsHigh[0], sumsLow[1], sumsHigh[1], coefficientsV);
+        const __m256i v1 = BlockChroma(sumsLow[2], sumsHigh[2], sumsLow[3], sumsHigh[3], coefficientsV);
+
+        // U and V are both within 0 - 255, so every 16 bit word becomes one U V pair
+        const __m256i u = FixLaneOrder(_mm256_packs_epi32(u0, u1));
+        const __m256i v = FixLaneOrder(_mm256_packs_epi32(v0, v1));
+
+        StoreRow<Mirror, 2>(dstUV, width, x, _mm256_or_si256(u, _mm256_slli_epi16(v, 8)));
+    }
+}
+
+template <bool Mirror>
+void InterleaveUVRow(const uint8_t* srcU, const uint8_t* srcV, uint8_t* dstUV, uint32_t chromaWidth)
+{
+    for (uint32_t x = 0; x < chromaWidth; x += 32)
+    {
+        // Unpacking per lane interleaves samples 0-7 and 16-23 into the low result, so the inputs are reordered first
+        const __m256i u = FixLaneOrder(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcU + x)));
+        const __m256i v = FixLaneOrder(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcV + x)));
+
+        StoreRow<Mirror, 2>(dstUV, chromaWidth * 2, x * 2, _mm256_unpacklo_epi8(u, v));
+        StoreRow<Mirror, 2>(dstUV, chromaWidth * 2, x * 2 + 32, _mm256_unpackhi_epi8(u, v));
+    }
+}
+
+template <uint32_t ElementSize>
+void MirrorRow(const uint8_t* src, uint8_t* dst, uint32_t count)
+{
+    const uint32_t rowSize = count * ElementSize;
+
+    for (uint32_t x = 0; x < rowSize; x += 32)
+    {
+        StoreRow<true, ElementSize>(dst, rowSize, x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x)));
+    }
+}
+
+// Narrows 32 elements of 16 bit samples per step, count is the number of 8 or 16 bit elements written
+template <bool Mirror, uint32_t ElementSize>
+void NarrowRow(const uint8_t* src, uint8_t* dst, uint32_t count)
+{
+    const uint32_t rowSize = count * ElementSize;
+    const __m256i rounding = _mm256_set1_epi16(0x80);
+
+    for (uint32_t x = 0; x < rowSize; x += 32)
+    {
+        // Saturating keeps the largest values from rounding up past 8 bits
+        const __m256i low = _mm256_srli_epi16(_mm256_adds_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 2)), rounding), 8);
+        const __m256i high = _mm256_srli_epi16(_mm256_adds_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 2 + 32)), rounding), 8);
+
+        StoreRow<Mirror, ElementSize>(dst, rowSize, x, FixLaneOrder(_mm256_packus_epi16(low, high)));
+    }
+}
+} // namespace
+
+void Yuy2ToNV12Row_AVX2(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    Packed422ToNV12Row<0, false>(src0, src1, dstY0, dstY1, dstUV, width);
+}
+
+void UyvyToNV12Row_AVX2(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    Packed422ToNV12Row<1, false>(src0, src1, dstY0, dstY1, dstUV, width);
+}
+
+void BGRAToNV12Row_AVX2(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    BGRAToNV12Row<false>(src0, src1, dstY0, dstY1, dstUV, width);
+}
+
+void InterleaveUVRow_AVX2(const uint8_t* srcU, const uint8_t* srcV, uint8_t* dstUV, uint32_t chromaWidth)
+{
+    InterleaveUVRow<false>(srcU, srcV, dstUV, chromaWidth);
+}
+
+void Yuy2ToNV12RowMirror_AVX2(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    Packed422ToNV12Row<0, true>(src0, src1, dstY0, dstY1, dstUV, width);
+}
+
+void UyvyToNV12RowMirror_AVX2(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    Packed422ToNV12Row<1, true>(src0, src1, dstY0, dstY1, dstUV, width);
+}
+
+void BGRAToNV12RowMirror_AVX2(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    BGRAToNV12Row<true>(src0, src1, dstY0, dstY1, dstUV, width);
+}
+
+void InterleaveUVRowMirror_AVX2(const uint8_t* srcU, const uint8_t* srcV, uint8_t* dstUV, uint32_t chromaWidth)
+{
+    InterleaveUVRow<true>(srcU, srcV, dstUV, chromaWidth);
+}
+
+void MirrorRow8_AVX2(const uint8_t* src, uint8_t* dst, uint32_t count)
+{
+    MirrorRow<1>(src, dst, count);
+}
+
+void MirrorRow16_AVX2(const uint8_t* src, uint8_t* dst, uint32_t count)
+{
+    MirrorRow<2>(src, dst, count);
+}
+
+void NarrowRow_AVX2(const uint8_t* src, uint8_t* dst, uint32_t count)
+{
+    NarrowRow<false, 1>(src, dst, count);
+}
+
+void NarrowRowMirror8_AVX2(const uint8_t* src, uint8_t* dst, uint32_t count)
+{
+    NarrowRow<true, 1>(src, dst, count);
+}
+
+void NarrowRowMirror16_AVX2(const uint8_t* src, uint8_t* dst, uint32_t count)
+{
+    NarrowRow<true, 2>(src, dst, count);
+}
+#endif
@@ -0,0 +1,79 @@
+#pragma once
+
+// Row kernels used by ConvertToNV12(). The SIMD variants live in their own translation units, which are built with the
+// matching instruction set enabled and without the precompiled header, so this header only depends on the standard library.
+#include <cstdint>
+
+// Converts a pair of source rows into two NV12 luma rows and one chroma row, the chroma of both rows is averaged.
+// The SIMD variants require the width to be a multiple of their block size.
+using RowPairKernel = void (*)(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width);
+
+// Interleaves one row of U and V samples into an NV12 chroma row
+using InterleaveRowKernel = void (*)(const uint8_t* srcU, const uint8_t* srcV, uint8_t* dstUV, uint32_t chromaWidth);
+
+// Copies a row of 8 or 16 bit elements in reverse order, used to mirror NV12 luma and chroma rows
+using MirrorRowKernel = void (*)(const uint8_t* src, uint8_t* dst, uint32_t count);
+
+// Narrows 16 bit samples with the value in their upper bits, like P010, to 8 bits with rounding. The plain kernel
+// takes the number of samples, the mirrored ones the number of 8 or 16 bit elements they reverse like MirrorRowKernel.
+using NarrowRowKernel = void (*)(const uint8_t* src, uint8_t* dst, uint32_t count);
+
+// The ...Mirror kernels write their output in reverse order: the first source pixel ends up at the end of the destination rows.
+// The chroma is mirrored per U V pair, for odd widths the chroma of the last column therefore lands in the first pair.
+
+// BT.709 limited range coefficients for full range RGB in 1.15 fixed point, shared by all kernels so that they are bit exact
+namespace BT709
+{
+constexpr int32_t LumaR = 5983;
+constexpr int32_t LumaG = 20127;
+constexpr int32_t LumaB = 2032;
+constexpr int32_t LumaOffset = (16 << 15) + (1 << 14);
+
+constexpr int32_t ChromaUR = -3296;
+constexpr int32_t ChromaUG = -11095;
+constexpr int32_t ChromaUB = 14392;
+constexpr int32_t ChromaVR = 14392;
+constexpr int32_t ChromaVG = -13071;
+constexpr int32_t ChromaVB = -1321;
+
+// Chroma is computed from the sum of a 2x2 block, so two more bits are shifted out
+constexpr int32_t ChromaShift = 17;
+constexpr int32_t ChromaOffset = (128 << ChromaShift) + (1 << (ChromaShift - 1));
+} // namespace BT709
+
+void Yuy2ToNV12Row_C(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width);
+void UyvyToNV12Row_C(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width);
+void BGRAToNV12Row_C(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width);
+void InterleaveUVRow_C(const uint8_t* srcU, const uint8_t* srcV, uint8_t* dstUV, uint32_t chromaWidth);
+
+void Yuy2ToNV12RowMirror_C(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width);
+void UyvyToNV12RowMirror_C(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width);
+void BGRAToNV12RowMirror_C(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width);
+void InterleaveUVRowMirror_C(const uint8_t* srcU, const uint8_t* srcV, uint8_t* dstUV, uint32_t chromaWidth);
+void MirrorRow8_C(const uint8_t* src, uint8_t* dst, uint32_t count);
+void MirrorRow16_C(const uint8_t* src, uint8_t* dst, uint32_t count);
+void NarrowRow_C(const uint8_t* src, uint8_t* dst, uint32_t count);
+void NarrowRowMirror8_C(const uint8_t* src, uint8_t* dst, uint32_t count);
+void NarrowRowMirror16_C(const uint8_t* src, uint8_t* dst, uint32_t count);
+
+// 16 pixels per block
+void Yuy2ToNV12Row_SSSE3(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width);
+void UyvyToNV12Row_SSSE3(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width);
+void InterleaveUVRow_SSSE3(const uint8_t* srcU, const uint8_t* srcV, uint8_t* dstUV, uint32_t chromaWidth);
+
+// 32 pixels per block
+void Yuy2ToNV12Row_AVX2(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width);
+void UyvyToNV12Row_AVX2(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width);
+void BGRAToNV12Row_AVX2(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width);
+void InterleaveUVRow_AVX2(const uint8_t* srcU, const uint8_t* srcV, uint8_t* dstUV, uint32_t chromaWidth);
+
+// 32 pixels or elements per block, the mirrored kernels have no SSSE3 variants
+void Yuy2ToNV12RowMirror_AVX2(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width);
+void UyvyToNV12RowMirror_AVX2(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width);
+void BGRAToNV12RowMirror_AVX2(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width);
+void InterleaveUVRowMirror_AVX2(const uint8_t* srcU, const uint8_t* srcV, uint8_t* dstUV, uint32_t chromaWidth);
+void MirrorRow8_AVX2(const uint8_t* src, uint8_t* dst, uint32_t count);
+void MirrorRow16_AVX2(const uint8_t* src, uint8_t* dst, uint32_t count);
+void NarrowRow_AVX2(const uint8_t* src, uint8_t* dst, uint32_t count);
+void NarrowRowMirror8_AVX2(const uint8_t* src, uint8_t* dst, uint32_t count);
+void NarrowRowMirror16_AVX2(const uint8_t* src, uint8_t* dst, uint32_t count);
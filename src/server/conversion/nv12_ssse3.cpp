@@ -0,0 +1,58 @@
+#include "nv12_kernels.h"
+#include "cpu_features.h"
+
+#ifdef CPU_X86_64
+#include <tmmintrin.h>
+
+namespace
+{
+// Moves the luma samples of 8 packed pixels into the low and their chroma samples into the high 8 bytes
+template <uint32_t LumaOffset>
+__m128i SplitPacked422(__m128i pixels)
+{
+    const __m128i mask = LumaOffset == 0 ? _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15) : _mm_setr_epi8(1, 3, 5, 7, 9, 11, 13, 15, 0, 2, 4, 6, 8, 10, 12, 14);
+    return _mm_shuffle_epi8(pixels, mask);
+}
+
+template <uint32_t LumaOffset>
+void Packed422ToNV12Row(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; x += 16)
+    {
+        const __m128i row0a = SplitPacked422<LumaOffset>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src0 + x * 2)));
+        const __m128i row0b = SplitPacked422<LumaOffset>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src0 + x * 2 + 16)));
+        const __m128i row1a = SplitPacked422<LumaOffset>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + x * 2)));
+        const __m128i row1b = SplitPacked422<LumaOffset>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + x * 2 + 16)));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dstY0 + x), _mm_unpacklo_epi64(row0a, row0b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dstY1 + x), _mm_unpacklo_epi64(row1a, row1b));
+
+        // The chroma is already in U V order, same rounding as the scalar (a + b + 1) / 2
+        const __m128i chroma = _mm_avg_epu8(_mm_unpackhi_epi64(row0a, row0b), _mm_unpackhi_epi64(row1a, row1b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dstUV + x), chroma);
+    }
+}
+} // namespace
+
+void Yuy2ToNV12Row_SSSE3(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    Packed422ToNV12Row<0>(src0, src1, dstY0, dstY1, dstUV, width);
+}
+
+void UyvyToNV12Row_SSSE3(const uint8_t* src0, const uint8_t* src1, uint8_t* dstY0, uint8_t* dstY1, uint8_t* dstUV, uint32_t width)
+{
+    Packed422ToNV12Row<1>(src0, src1, dstY0, dstY1, dstUV, width);
+}
+
+void InterleaveUVRow_SSSE3(const uint8_t* srcU, const uint8_t* srcV, uint8_t* dstUV, uint32_t chromaWidth)
+{
+    for (uint32_t x = 0; x < chromaWidth; x += 16)
+    {
+        const __m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcU + x));
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcV + x));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dstUV + x * 2), _mm_unpacklo_epi8(u, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dstUV + x * 2 + 16), _mm_unpackhi_epi8(u, v));
+    }
+}
+#endif
@@ -0,0 +1,11 @@
+#pragma once
+
+// How a frame is flipped while it is converted. The flips are fused into the conversion kernels, so they don't need an extra pass over the frame.
+// Rotating by 180 degrees is the same as flipping both ways.
+struct Orientation
+{
+    bool mirror = false; // Horizontal flip
+    bool flip = false;   // Vertical flip
+
+    bool operator==(const Orientation&) const = default;
+};
@@ -0,0 +1,336 @@
+#include "scaler.h"
+#include "cpu_features.h"
+#include "pipeline/thread_pool.h"
+#include "scaler_kernels.h"
+
+#include <cmath>
+
+struct ScalerKernels
+{
+    const char* name = "C";
+
+    // Samples the SIMD kernels process per block, the remainder of a row is handled by the scalar kernels
+    uint32_t verticalBlockSize = 1;
+    uint32_t horizontalBlockSize = 1;
+
+    ScaleVerticalKernel vertical = ScaleRowVertical_C;
+    ScaleHorizontalKernel horizontal = ScaleRowHorizontal_C;
+};
+
+// Filter along one direction: output sample i is the weighted sum of the taps source samples from starts[i] on
+struct ScalerAxisFilter
+{
+    uint32_t taps = 0;
+    std::vector<uint32_t> starts;
+    std::vector<int16_t> weights; // taps per output sample
+};
+
+struct ScalerPlaneFilter
+{
+    ScalerAxisFilter vertical;
+
+    // Source samples per row and output samples per row, with U and V counted separately
+    uint32_t sourceWidth = 0;
+    uint32_t width = 0;
+
+    // Horizontal filter in the layout of ScaleHorizontalKernel, padded to whole blocks of 8
+    uint32_t steps = 0;
+    std::vector<int32_t> offsets;
+    std::vector<int32_t> weights;
+
+    // First output row of every band, with one more entry for the end of the last band.
+    // A row belongs to the band which holds the last source row it needs.
+    std::vector<uint32_t> bandRows;
+};
+
+namespace
+{
+// Source rows per band of the luma plane, the chroma plane uses half as many so that both have the same number of bands
+constexpr uint32_t BandHeight = 32;
+
+const ScalerKernels ReferenceKernels;
+
+ScalerKernels SelectKernels()
+{
+    ScalerKernels kernels;
+
+#ifdef CPU_X86_64
+    // The horizontal pass needs gathers, so there is no SSSE3 variant
+    if (GetCpuFeatures().avx2)
+    {
+        kernels = {"AVX2", 16, 8, ScaleRowVertical_AVX2, ScaleRowHorizontal_AVX2};
+    }
+#endif
+
+    info("CONVERT", "Using %s kernels for scaling.", kernels.name);
+
+    return kernels;
+}
+
+const ScalerKernels& GetKernels()
+{
+    static const ScalerKernels kernels = ::SelectKernels();
+    return kernels;
+}
+
+uint32_t AlignDown(uint32_t value, uint32_t blockSize)
+{
+    return value - value % blockSize;
+}
+
+// Triangle filter whose radius grows with the scale factor, so that every source sample contributes to the output.
+// Taps beyond the edges are folded onto the edge sample.
+ScalerAxisFilter BuildAxisFilter(uint32_t sourceSize, uint32_t size)
+{
+    const double scale = double(sourceSize) / size;
+    const double radius = std::max(1.0, scale);
+
+    ScalerAxisFilter filter;
+    filter.taps = std::min(sourceSize, uint32_t(std::ceil(2 * radius)));
+    filter.starts.resize(size);
+    filter.weights.resize(size_t(size) * filter.taps);
+
+    std::vector<double> weights(filter.taps);
+
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        const double center = (i + 0.5) * scale - 0.5;
+        const int32_t first = int32_t(std::floor(center - radius)) + 1;
+        const int32_t start = std::clamp(first, 0, int32_t(sourceSize - filter.taps));
+
+        std::fill(weights.begin(), weights.end(), 0.0);
+        double sum = 0;
+
+        for (int32_t position = first; position < first + int32_t(filter.taps); ++position)
+        {
+            const double weight = std::max(0.0, 1.0 - std::abs(position - center) / radius);
+            weights[std::clamp(position, 0, int32_t(sourceSize) - 1) - start] += weight;
+            sum += weight;
+        }
+
+        // Round to fixed point and put the rounding error on the largest weight, so that flat areas stay flat
+        int16_t* fixedWeights = &filter.weights[size_t(i) * filter.taps];
+        int32_t fixedSum = 0;
+        uint32_t largest = 0;
+
+        for (uint32_t t = 0; t < filter.taps; ++t)
+        {
+            fixedWeights[t] = int16_t(std::lround(weights[t] / sum * (1 << ScalerWeightBits)));
+            fixedSum += fixedWeights[t];
+            largest = fixedWeights[t] > fixedWeights[largest] ? t : largest;
+        }
+
+        fixedWeights[largest] = int16_t(fixedWeights[largest] + (1 << ScalerWeightBits) - fixedSum);
+        filter.starts[i] = uint32_t(start);
+    }
+
+    return filter;
+}
+
+// Pairs the weights of a horizontal filter up for ScaleHorizontalKernel. Luma pairs neighbouring taps, the interleaved
+// chroma gets one tap per step, with U and V taking every second sample.
+void BuildHorizontalFilter(ScalerPlaneFilter& planeFilter, const ScalerAxisFilter& filter, bool chroma)
+{
+    const uint32_t components = chroma ? 2 : 1;
+    const uint32_t width = uint32_t(filter.starts.size()) * components;
+    const uint32_t paddedWidth = (width + 7) / 8 * 8;
+
+    planeFilter.width = width;
+    planeFilter.steps = chroma ? filter.taps : (filter.taps + 1) / 2;
+    planeFilter.offsets.assign(paddedWidth, 0);
+    planeFilter.weights.assign(size_t(paddedWidth) * planeFilter.steps, 0);
+
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        const uint32_t i = x / components;
+        const int16_t* weights = &filter.weights[size_t(i) * filter.taps];
+
+        planeFilter.offsets[x] = int32_t(filter.starts[i] * components + x % components);
+
+        for (uint32_t k = 0; k < planeFilter.steps; ++k)
+        {
+            const uint32_t tap = chroma ? k : k * 2;
+            const int16_t low = weights[tap];
+            const int16_t high = !chroma && tap + 1 < filter.taps ? weights[tap + 1] : 0;
+
+            planeFilter.weights[(size_t(x / 8) * planeFilter.steps + k) * 8 + x % 8] = int32_t(uint16_t(low)) | (int32_t(high) << 16);
+        }
+    }
+}
+
+ScalerPlaneFilter BuildPlaneFilter(uint32_t sourceWidth, uint32_t sourceRows, uint32_t width, uint32_t rows, bool chroma, uint32_t bandCount)
+{
+    ScalerPlaneFilter planeFilter;
+    planeFilter.vertical = ::BuildAxisFilter(sourceRows, rows);
+    planeFilter.sourceWidth = sourceWidth * (chroma ? 2 : 1);
+
+    ::BuildHorizontalFilter(planeFilter, ::BuildAxisFilter(sourceWidth, width), chroma);
+
+    const uint32_t bandHeight = chroma ? BandHeight / 2 : BandHeight;
+
+    planeFilter.bandRows.assign(bandCount + 1, rows);
+
+    for (uint32_t row = rows; row-- > 0;)
+    {
+        const uint32_t lastSourceRow = planeFilter.vertical.starts[row] + planeFilter.vertical.taps - 1;
+        planeFilter.bandRows[lastSourceRow / bandHeight] = row;
+    }
+
+    // Bands which complete no row start where the next one does
+    for (uint32_t band = bandCount; band-- > 0;)
+    {
+        planeFilter.bandRows[band] = std::min(planeFilter.bandRows[band], planeFilter.bandRows[band + 1]);
+    }
+
+    return planeFilter;
+}
+} // namespace
+
+void ScaleRowVertical_C(const uint8_t* const* rows, const int16_t* weights, uint32_t taps, uint16_t* dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        int32_t sum = 1 << (ScalerWeightBits - ScalerIntermediateBits - 1);
+
+        for (uint32_t t = 0; t < taps; ++t)
+        {
+            sum += weights[t] * rows[t][x];
+        }
+
+        dst[x] = uint16_t(sum >> (ScalerWeightBits - ScalerIntermediateBits));
+    }
+}
+
+void ScaleRowHorizontal_C(const uint16_t* src, const int32_t* offsets, const int32_t* weights, uint32_t steps, uint8_t* dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        const int32_t* sampleWeights = weights + size_t(x / 8) * steps * 8 + x % 8;
+        int32_t sum = 1 << (ScalerWeightBits + ScalerIntermediateBits - 1);
+
+        for (uint32_t k = 0; k < steps; ++k)
+        {
+            const int32_t weightPair = sampleWeights[k * 8];
+            sum += src[offsets[x] + 2 * k] * int16_t(weightPair & 0xFFFF) + src[offsets[x] + 2 * k + 1] * int16_t(weightPair >> 16);
+        }
+
+        dst[x] = uint8_t(sum >> (ScalerWeightBits + ScalerIntermediateBits));
+    }
+}
+
+NV12Scaler::NV12Scaler(Size source, const std::vector<Size>& layers, uint32_t threadCount)
+    : m_source(source), m_layers(layers), m_threadPool(std::make_unique<ThreadPool>(std::max(threadCount, 1u)))
+{
+    m_bandCount = (source.height + BandHeight - 1) / BandHeight;
+
+    for (const Size& layer : m_layers)
+    {
+        m_filters.push_back(::BuildPlaneFilter(source.width, source.height, layer.width, layer.height, false, m_bandCount));
+        m_filters.push_back(::BuildPlaneFilter((source.width + 1) / 2, (source.height + 1) / 2, layer.width / 2, layer.height / 2, true, m_bandCount));
+
+        info("CONVERT", "Scaling %d x %d to %d x %d.", source.width, source.height, layer.width, layer.height);
+    }
+}
+
+NV12Scaler::~NV12Scaler() = default;
+
+bool NV12Scaler::checkFrame(const Frame& frame, std::span<const NV12Planes> layers) const
+{
+    if (frame.videoFormat != IDevice::VideoFormat::NV12 || frame.width != m_source.width || frame.height != m_source.height)
+    {
+        error("CONVERT", "Scaler expected a %d x %d NV12 frame.", m_source.width, m_source.height);
+        return false;
+    }
+
+    if (layers.size() != m_layers.size())
+    {
+        error("CONVERT", "Scaler expected %d destinations.", int(m_layers.size()));
+        return false;
+    }
+
+    return true;
+}
+
+bool NV12Scaler::scale(const Frame& frame, std::span<const NV12Planes> layers)
+{
+    if (!checkFrame(frame, layers))
+    {
+        return false;
+    }
+
+    const ScalerKernels& kernels = ::GetKernels();
+
+    m_threadPool->parallelFor(m_bandCount * 2, [&](uint32_t task) { scaleBand(frame, layers, kernels, task % 2, task / 2); });
+
+    return true;
+}
+
+bool NV12Scaler::scaleReference(const Frame& frame, std::span<const NV12Planes> layers)
+{
+    if (!checkFrame(frame, layers))
+    {
+        return false;
+    }
+
+    for (uint32_t band = 0; band < m_bandCount; ++band)
+    {
+        scaleBand(frame, layers, ::ReferenceKernels, 0, band);
+        scaleBand(frame, layers, ::ReferenceKernels, 1, band);
+    }
+
+    return true;
+}
+
+void NV12Scaler::scaleBand(const Frame& frame, std::span<const NV12Planes> layers, const ScalerKernels& kernels, uint32_t plane, uint32_t band) const
+{
+    const Frame::Plane& source = frame.planes[plane];
+
+    // Each thread keeps its own intermediate row, the padding is read by the last horizontal steps with a zero weight
+    thread_local std::vector<uint16_t> intermediate;
+    thread_local std::vector<const uint8_t*> rows;
+
+    for (size_t layer = 0; layer < layers.size(); ++layer)
+    {
+        const ScalerPlaneFilter& filter = m_filters[layer * 2 + plane];
+        const ScalerAxisFilter& vertical = filter.vertical;
+
+        std::byte* dstPlane = plane == 0 ? layers[layer].y : layers[layer].uv;
+        const size_t dstPitch = plane == 0 ? layers[layer].yPitch : layers[layer].uvPitch;
+
+        const uint32_t verticalBlockWidth = AlignDown(filter.sourceWidth, kernels.verticalBlockSize);
+        const uint32_t horizontalBlockWidth = AlignDown(filter.width, kernels.horizontalBlockSize);
+
+        if (intermediate.size() < filter.sourceWidth + 2)
+        {
+            intermediate.assign(filter.sourceWidth + 2, 0);
+        }
+
+        rows.resize(vertical.taps);
+
+        for (uint32_t row = filter.bandRows[band]; row < filter.bandRows[band + 1]; ++row)
+        {
+            for (uint32_t t = 0; t < vertical.taps; ++t)
+            {
+                rows[t] = reinterpret_cast<const uint8_t*>(source.getRow(vertical.starts[row] + t));
+            }
+
+            const int16_t* weights = &vertical.weights[size_t(row) * vertical.taps];
+
+            kernels.vertical(rows.data(), weights, vertical.taps, intermediate.data(), verticalBlockWidth);
+
+            // The scalar kernel takes the row pointers as they are, so they are moved to the remaining samples
+            for (auto& sourceRow : rows)
+            {
+                sourceRow += verticalBlockWidth;
+            }
+
+            ScaleRowVertical_C(rows.data(), weights, vertical.taps, intermediate.data() + verticalBlockWidth, filter.sourceWidth - verticalBlockWidth);
+
+            uint8_t* dst = reinterpret_cast<uint8_t*>(dstPlane + row * dstPitch);
+
+            kernels.horizontal(intermediate.data(), filter.offsets.data(), filter.weights.data(), filter.steps, dst, horizontalBlockWidth);
+            ScaleRowHorizontal_C(intermediate.data(), filter.offsets.data() + horizontalBlockWidth, filter.weights.data() + size_t(horizontalBlockWidth) * filter.steps,
+                                 filter.steps, dst + horizontalBlockWidth, filter.width - horizontalBlockWidth);
+        }
+    }
+}
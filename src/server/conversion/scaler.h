@@ -0,0 +1,61 @@
+#pragma once
+
+#include "video_input/frame.h"
+
+class ThreadPool;
+struct ScalerKernels;
+struct ScalerPlaneFilter;
+
+// Destination planes of an NV12 image
+struct NV12Planes
+{
+    std::byte* y = nullptr;
+    size_t yPitch = 0;
+    std::byte* uv = nullptr;
+    size_t uvPitch = 0;
+};
+
+// Scales NV12 frames to several sizes at once with a separable triangle filter, which widens with the
+// scale factor so that small layers don't alias.
+//
+// The frame is swept in bands of source rows, and while a band is in the cache every layer produces the rows which
+// end within it. The bands of both planes are spread across a thread pool.
+class NV12Scaler
+{
+  public:
+    struct Size
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        bool operator==(const Size& other) const = default;
+    };
+
+    // Every layer needs even dimensions. Layers larger than the source are scaled up, which makes the filter bilinear.
+    NV12Scaler(Size source, const std::vector<Size>& layers, uint32_t threadCount);
+    ~NV12Scaler();
+
+    Size getSourceSize() const
+    {
+        return m_source;
+    }
+
+    // Scales an NV12 frame of the source size into one destination per layer
+    bool scale(const Frame& frame, std::span<const NV12Planes> layers);
+
+    // Same as scale() but always uses the scalar kernels on the calling thread, as a reference for the SIMD ones
+    bool scaleReference(const Frame& frame, std::span<const NV12Planes> layers);
+
+  private:
+    bool checkFrame(const Frame& frame, std::span<const NV12Planes> layers) const;
+    void scaleBand(const Frame& frame, std::span<const NV12Planes> layers, const ScalerKernels& kernels, uint32_t plane, uint32_t band) const;
+
+    Size m_source;
+    std::vector<Size> m_layers;
+
+    // Indexed by layer * 2 + plane
+    std::vector<ScalerPlaneFilter> m_filters;
+    uint32_t m_bandCount = 0;
+
+    std::unique_ptr<ThreadPool> m_threadPool;
+};
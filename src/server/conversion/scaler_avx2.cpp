@@ -0,0 +1,63 @@
+#include "scaler_kernels.h"
+#include "cpu_features.h"
+
+#ifdef CPU_X86_64
+#include <immintrin.h>
+
+void ScaleRowVertical_AVX2(const uint8_t* const* rows, const int16_t* weights, uint32_t taps, uint16_t* dst, uint32_t width)
+{
+    const __m256i rounding = _mm256_set1_epi32(1 << (ScalerWeightBits - ScalerIntermediateBits - 1));
+
+    for (uint32_t x = 0; x < width; x += 16)
+    {
+        __m256i sumLow = rounding;
+        __m256i sumHigh = rounding;
+
+        // Two rows per step, an odd last row is paired with itself and a weight of zero
+        for (uint32_t t = 0; t < taps; t += 2)
+        {
+            const uint32_t t1 = t + 1 < taps ? t + 1 : t;
+            const int16_t weight1 = t + 1 < taps ? weights[t + 1] : 0;
+
+            const __m256i row0 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[t] + x)));
+            const __m256i row1 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[t1] + x)));
+            const __m256i weightPair = _mm256_set1_epi32(int32_t(uint16_t(weights[t])) | (int32_t(weight1) << 16));
+
+            // Samples 0-3 and 8-11 end up in the low, 4-7 and 12-15 in the high unpack, packing puts them back in order
+            sumLow = _mm256_add_epi32(sumLow, _mm256_madd_epi16(_mm256_unpacklo_epi16(row0, row1), weightPair));
+            sumHigh = _mm256_add_epi32(sumHigh, _mm256_madd_epi16(_mm256_unpackhi_epi16(row0, row1), weightPair));
+        }
+
+        const __m256i samples = _mm256_packus_epi32(_mm256_srai_epi32(sumLow, ScalerWeightBits - ScalerIntermediateBits), _mm256_srai_epi32(sumHigh, ScalerWeightBits - ScalerIntermediateBits));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), samples);
+    }
+}
+
+void ScaleRowHorizontal_AVX2(const uint16_t* src, const int32_t* offsets, const int32_t* weights, uint32_t steps, uint8_t* dst, uint32_t width)
+{
+    const __m256i rounding = _mm256_set1_epi32(1 << (ScalerWeightBits + ScalerIntermediateBits - 1));
+
+    for (uint32_t x = 0; x < width; x += 8)
+    {
+        const __m256i offset = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets + x));
+        const int32_t* blockWeights = weights + x * steps;
+
+        __m256i sum = rounding;
+
+        // Every gather fetches two neighbouring 16 bit samples per lane, which are weighted with one pair
+        for (uint32_t k = 0; k < steps; ++k)
+        {
+            const __m256i samples = _mm256_i32gather_epi32(reinterpret_cast<const int*>(src + 2 * k), offset, 2);
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(samples, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blockWeights + k * 8))));
+        }
+
+        const __m256i values = _mm256_srai_epi32(sum, ScalerWeightBits + ScalerIntermediateBits);
+
+        // 8 values of at most 255, packed within the lanes and then moved together
+        const __m256i words = _mm256_packus_epi32(values, values);
+        const __m256i bytes = _mm256_packus_epi16(words, words);
+        const __m128i packed = _mm_unpacklo_epi32(_mm256_castsi256_si128(bytes), _mm256_extracti128_si256(bytes, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x), packed);
+    }
+}
+#endif
@@ -0,0 +1,31 @@
+#pragma once
+
+// Row kernels used by NV12Scaler, built like the NV12 kernels (see nv12_kernels.h)
+#include <cstdint>
+
+// Fixed point precision of the filter weights, the weights of one output sample sum up to 1 << WeightBits
+constexpr uint32_t ScalerWeightBits = 14;
+
+// Fractional bits kept in the 16 bit samples between the vertical and the horizontal pass.
+// 255 << 7 still fits into a signed 16 bit value, which the horizontal pass multiplies with.
+constexpr uint32_t ScalerIntermediateBits = 7;
+
+// Filters a row of samples from several source rows: dst[x] = (sum of weights[t] * rows[t][x]) >> (WeightBits - IntermediateBits), rounded.
+// The SIMD variant requires the width to be a multiple of its block size.
+using ScaleVerticalKernel = void (*)(const uint8_t* const* rows, const int16_t* weights, uint32_t taps, uint16_t* dst, uint32_t width);
+
+// Filters a row of intermediate samples horizontally. Output sample x of block b = x / 8 and lane l = x % 8 is
+//   sum over k < steps of src[offsets[x] + 2k] * low(weights[(b * steps + k) * 8 + l]) + src[offsets[x] + 2k + 1] * high(...)
+// with the weights as pairs of 16 bit values. Luma uses both halves for neighbouring taps, chroma only the low half
+// so that U and V stay apart. src needs to be readable up to the last offset + 2 * steps.
+// The SIMD variant requires the width to be a multiple of its block size.
+using ScaleHorizontalKernel = void (*)(const uint16_t* src, const int32_t* offsets, const int32_t* weights, uint32_t steps, uint8_t* dst, uint32_t width);
+
+void ScaleRowVertical_C(const uint8_t* const* rows, const int16_t* weights, uint32_t taps, uint16_t* dst, uint32_t width);
+void ScaleRowHorizontal_C(const uint16_t* src, const int32_t* offsets, const int32_t* weights, uint32_t steps, uint8_t* dst, uint32_t width);
+
+// 16 samples per block
+void ScaleRowVertical_AVX2(const uint8_t* const* rows, const int16_t* weights, uint32_t taps, uint16_t* dst, uint32_t width);
+
+// 8 samples per block
+void ScaleRowHorizontal_AVX2(const uint16_t* src, const int32_t* offsets, const int32_t* weights, uint32_t steps, uint8_t* dst, uint32_t width);
@@ -0,0 +1,179 @@
+#include "text_overlay.h"
+
+namespace
+{
+constexpr uint32_t GlyphWidth = 5;
+constexpr uint32_t GlyphHeight = 7;
+
+struct Glyph
+{
+    char character;
+
+    // One row per byte, the leftmost pixel in bit 4
+    uint8_t rows[GlyphHeight];
+};
+
+// Enough for time stamps, counters and labels
+constexpr Glyph Font[] = {
+    {'0', {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}}, {'1', {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}}, {'2', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}},
+    {'3', {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}}, {'4', {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}}, {'5', {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}},
+    {'6', {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}}, {'7', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}}, {'8', {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}},
+    {'9', {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}}, {'A', {0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}}, {'B', {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}},
+    {'C', {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}}, {'D', {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}}, {'E', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}},
+    {'F', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}}, {'G', {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}}, {'H', {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+    {'I', {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}}, {'J', {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}}, {'K', {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}},
+    {'L', {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}}, {'M', {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}}, {'N', {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}},
+    {'O', {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}}, {'P', {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}}, {'Q', {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}},
+    {'R', {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}}, {'S', {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}}, {'T', {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}},
+    {'U', {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}}, {'V', {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}}, {'W', {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}},
+    {'X', {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}}, {'Y', {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}}, {'Z', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}},
+    {'-', {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}}, {'.', {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}}, {':', {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}},
+    {'/', {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}},
+};
+
+constexpr uint32_t GlyphCount = uint32_t(std::size(Font));
+
+// Index of the glyph of a character, or GlyphCount for a space
+uint32_t FindGlyph(char character)
+{
+    if (character >= 'a' && character <= 'z')
+    {
+        character = char(character - 'a' + 'A');
+    }
+
+    for (uint32_t i = 0; i < GlyphCount; ++i)
+    {
+        if (Font[i].character == character)
+        {
+            return i;
+        }
+    }
+
+    return GlyphCount;
+}
+
+// Limited range luma and full range BGRA of the text and the box
+constexpr uint8_t TextLuma = 235;
+constexpr uint8_t BoxLuma = 16;
+constexpr uint8_t NeutralChroma = 128;
+constexpr uint32_t TextBGRA = 0xFFFFFFFF;
+constexpr uint32_t BoxBGRA = 0xFF000000;
+} // namespace
+
+TextOverlay::TextOverlay(const Options& options)
+    : m_x(options.x & ~1u), m_y(options.y & ~1u), m_scale(std::max(options.scale, 1u)), m_cellWidth((GlyphWidth + 1) * m_scale), m_cellHeight((GlyphHeight + 2) * m_scale)
+{
+    m_atlas.resize(size_t(GlyphCount) * m_cellWidth * m_cellHeight);
+
+    for (uint32_t i = 0; i < GlyphCount; ++i)
+    {
+        uint8_t* cell = m_atlas.data() + size_t(i) * m_cellWidth * m_cellHeight;
+
+        for (uint32_t y = 0; y < GlyphHeight * m_scale; ++y)
+        {
+            for (uint32_t x = 0; x < GlyphWidth * m_scale; ++x)
+            {
+                cell[y * m_cellWidth + x] = (Font[i].rows[y / m_scale] >> (GlyphWidth - 1 - x / m_scale)) & 1;
+            }
+        }
+    }
+}
+
+TextOverlay::~TextOverlay() = default;
+
+void TextOverlay::setText(std::string_view text)
+{
+    uint32_t lineCount = 1;
+    uint32_t columnCount = 0;
+
+    for (uint32_t column = 0; char character : text)
+    {
+        column = character == '\n' ? 0 : column + 1;
+        lineCount += character == '\n' ? 1 : 0;
+        columnCount = std::max(columnCount, column);
+    }
+
+    // The box leaves a margin of one cell spacing around the text
+    m_width = (columnCount * m_cellWidth + m_scale * 2 + 1) & ~1u;
+    m_height = (lineCount * m_cellHeight + m_scale + 1) & ~1u;
+    m_coverage.assign(size_t(m_width) * m_height, 0);
+
+    uint32_t line = 0;
+    uint32_t column = 0;
+
+    for (char character : text)
+    {
+        if (character == '\n')
+        {
+            ++line;
+            column = 0;
+            continue;
+        }
+
+        const uint32_t glyph = ::FindGlyph(character);
+
+        if (glyph < GlyphCount)
+        {
+            const uint8_t* cell = m_atlas.data() + size_t(glyph) * m_cellWidth * m_cellHeight;
+            uint8_t* dst = m_coverage.data() + size_t(line * m_cellHeight + m_scale) * m_width + column * m_cellWidth + m_scale;
+
+            for (uint32_t y = 0; y < m_cellHeight; ++y)
+            {
+                std::memcpy(dst + size_t(y) * m_width, cell + size_t(y) * m_cellWidth, m_cellWidth);
+            }
+        }
+
+        ++column;
+    }
+}
+
+void TextOverlay::drawNV12(std::byte* dstY, size_t dstYPitch, std::byte* dstUV, size_t dstUVPitch, uint32_t width, uint32_t firstRow, uint32_t endRow) const
+{
+    if (m_x >= width)
+    {
+        return;
+    }
+
+    const uint32_t visibleWidth = std::min(m_width, width - m_x);
+
+    for (uint32_t y = std::max(firstRow, m_y); y < std::min(endRow, m_y + m_height); ++y)
+    {
+        const uint8_t* coverage = m_coverage.data() + size_t(y - m_y) * m_width;
+        uint8_t* row = reinterpret_cast<uint8_t*>(dstY + y * dstYPitch) + m_x;
+
+        for (uint32_t x = 0; x < visibleWidth; ++x)
+        {
+            row[x] = coverage[x] ? TextLuma : BoxLuma;
+        }
+    }
+
+    // The box covers whole chroma samples, a band starting at an even row owns the chroma rows of its row pairs
+    const uint32_t chromaWidth = std::min(m_width / 2, (width + 1) / 2 - m_x / 2);
+
+    for (uint32_t y = std::max(firstRow / 2, m_y / 2); y < std::min((endRow + 1) / 2, (m_y + m_height) / 2); ++y)
+    {
+        std::memset(dstUV + y * dstUVPitch + m_x, NeutralChroma, size_t(chromaWidth) * 2);
+    }
+}
+
+void TextOverlay::drawBGRA(std::byte* dst, size_t dstPitch, uint32_t width, uint32_t firstRow, uint32_t endRow) const
+{
+    if (m_x >= width)
+    {
+        return;
+    }
+
+    const uint32_t visibleWidth = std::min(m_width, width - m_x);
+
+    for (uint32_t y = std::max(firstRow, m_y); y < std::min(endRow, m_y + m_height); ++y)
+    {
+        const uint8_t* coverage = m_coverage.data() + size_t(y - m_y) * m_width;
+        std::byte* row = dst + y * dstPitch + size_t(m_x) * 4;
+
+        for (uint32_t x = 0; x < visibleWidth; ++x)
+        {
+            const uint32_t pixel = coverage[x] ? TextBGRA : BoxBGRA;
+            std::memcpy(row + size_t(x) * 4, &pixel, 4);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+// Burns a few lines of text into converted frames, e.g. the frame id, capture time and latency of a stream.
+//
+// The glyphs of a built-in 5 x 7 font are expanded to the chosen scale once, and setText() composes the text from
+// this atlas into a small coverage bitmap. The conversions draw the bitmap into the rows they just wrote, so the overlay
+// never takes a pass over the frame of its own. It is drawn in the coordinates of the converted frame, so it isn't
+// mirrored or flipped along with the picture.
+class TextOverlay
+{
+  public:
+    struct Options
+    {
+        // Top left corner in the converted frame, rounded down to even coordinates for the chroma
+        uint32_t x = 16;
+        uint32_t y = 16;
+
+        // Every pixel of the font becomes a square of this size
+        uint32_t scale = 2;
+    };
+
+    explicit TextOverlay(const Options& options);
+    ~TextOverlay();
+
+    // Lays out the lines of text, which are separated by '\n'. Lower case is drawn as upper case and characters
+    // without a glyph as space. Must not be called while a conversion draws the overlay.
+    void setText(std::string_view text);
+
+    // Draw the white text on a black box into the rows [firstRow, endRow) of a converted frame of the given width.
+    // Conversions which run in bands of rows draw each band right after converting it, the rest of the box is clipped.
+    void drawNV12(std::byte* dstY, size_t dstYPitch, std::byte* dstUV, size_t dstUVPitch, uint32_t width, uint32_t firstRow, uint32_t endRow) const;
+    void drawBGRA(std::byte* dst, size_t dstPitch, uint32_t width, uint32_t firstRow, uint32_t endRow) const;
+
+  private:
+    uint32_t m_x = 0;
+    uint32_t m_y = 0;
+    uint32_t m_scale = 1;
+
+    // Size of a character including the spacing to the next one
+    uint32_t m_cellWidth = 0;
+    uint32_t m_cellHeight = 0;
+
+    // Coverage of every glyph at the scale, one byte per pixel and glyph after glyph
+    std::vector<uint8_t> m_atlas;
+
+    // The laid out text with its box, at even size
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    std::vector<uint8_t> m_coverage;
+};
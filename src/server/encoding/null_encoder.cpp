@@ -0,0 +1,434 @@
+#include "null_encoder.h"
+#include "trace_logging.h"
+#include "video_input/frame.h"
+
+namespace
+{
+// NAL unit headers: nal_ref_idc in bits 5-6, nal_unit_type in bits 0-4
+constexpr uint8_t SequenceParameterSetHeader = 0x67;
+constexpr uint8_t PictureParameterSetHeader = 0x68;
+constexpr uint8_t IDRSliceHeader = 0x65;
+constexpr uint8_t PSliceHeader = 0x41;
+constexpr uint8_t FillerDataHeader = 0x0c;
+
+// Start code, NAL unit header and the trailing bits of a filler data NAL unit
+constexpr size_t FillerDataOverhead = 6;
+
+// frame_num counts the reference frames modulo 16
+constexpr uint32_t Log2MaxFrameNum = 4;
+
+// A 16x16 intra macroblock with DC prediction, DC chroma prediction, no QP change and no coefficients, so the decoder
+// predicts 128 everywhere: mb_type ue(3) "00100", intra_chroma_pred_mode ue(0) "1", mb_qp_delta se(0) "1", coeff_token "1"
+constexpr uint8_t GrayMacroblock = 0x27;
+
+struct Level
+{
+    uint8_t levelIdc;
+    uint32_t maxFrameSize;      // macroblocks
+    uint32_t maxMacroblockRate; // macroblocks per second
+    uint32_t maxBitrate;        // kbit/s for baseline profile
+};
+
+// Table A-1 of the H.264 specification from level 3.1 on, which browsers expect of a camera stream anyway
+constexpr Level Levels[] = {
+    {31, 3600, 108000, 14000},   {32, 5120, 216000, 20000},   {40, 8192, 245760, 20000},   {42, 8704, 522240, 50000},
+    {50, 22080, 589824, 135000}, {51, 36864, 983040, 240000}, {52, 36864, 2073600, 240000},
+};
+
+uint8_t SelectLevel(uint32_t macroblockCount, Ratio fps, uint32_t bitrate)
+{
+    const double macroblockRate = double(macroblockCount) * fps.asFloat();
+
+    for (const Level& level : Levels)
+    {
+        if (macroblockCount <= level.maxFrameSize && macroblockRate <= level.maxMacroblockRate && bitrate / 1000 <= level.maxBitrate)
+        {
+            return level.levelIdc;
+        }
+    }
+
+    return Levels[std::size(Levels) - 1].levelIdc;
+}
+
+// Writes the raw byte sequence payload of a NAL unit, most significant bit first
+class BitWriter
+{
+  public:
+    void writeBits(uint32_t value, uint32_t count)
+    {
+        for (uint32_t i = count; i > 0; --i)
+        {
+            m_current = uint8_t((m_current << 1) | ((value >> (i - 1)) & 1));
+
+            if (++m_bitCount == 8)
+            {
+                m_bytes.push_back(std::byte(m_current));
+                m_current = 0;
+                m_bitCount = 0;
+            }
+        }
+    }
+
+    // Exp-Golomb codes of the syntax elements
+    void writeUE(uint32_t value)
+    {
+        const uint64_t codeNum = uint64_t(value) + 1;
+        const uint32_t length = uint32_t(std::bit_width(codeNum));
+
+        writeBits(0, length - 1);
+        writeBits(uint32_t(codeNum >> 32), length > 32 ? length - 32 : 0);
+        writeBits(uint32_t(codeNum), std::min(length, 32u));
+    }
+
+    void writeSE(int32_t value)
+    {
+        writeUE(value > 0 ? uint32_t(value) * 2 - 1 : uint32_t(-int64_t(value)) * 2);
+    }
+
+    // rbsp_trailing_bits(): a stop bit and zeros up to the next byte
+    void writeTrailingBits()
+    {
+        writeBits(1, 1);
+
+        if (m_bitCount > 0)
+        {
+            writeBits(0, 8 - m_bitCount);
+        }
+    }
+
+    const std::vector<std::byte>& getBytes() const
+    {
+        return m_bytes;
+    }
+
+  private:
+    std::vector<std::byte> m_bytes;
+    uint8_t m_current = 0;
+    uint32_t m_bitCount = 0;
+};
+
+// Appends the NAL unit with a start code, inserting emulation prevention bytes so that the payload never contains one
+void AppendNalUnit(std::vector<std::byte>& sample, uint8_t header, const std::vector<std::byte>& payload)
+{
+    constexpr std::byte StartCode[] = {std::byte(0), std::byte(0), std::byte(0), std::byte(1)};
+    sample.insert(sample.end(), std::begin(StartCode), std::end(StartCode));
+    sample.push_back(std::byte(header));
+
+    uint32_t zeroCount = 0;
+    for (std::byte value : payload)
+    {
+        if (zeroCount == 2 && uint8_t(value) <= 3)
+        {
+            sample.push_back(std::byte(3));
+            zeroCount = 0;
+        }
+
+        sample.push_back(value);
+        zeroCount = value == std::byte(0) ? zeroCount + 1 : 0;
+    }
+}
+
+// Pads the sample to the size with a filler data NAL unit, which decoders discard. Samples which are already larger stay as they are.
+void AppendFillerData(std::vector<std::byte>& sample, size_t size)
+{
+    if (size < sample.size() + FillerDataOverhead)
+    {
+        return;
+    }
+
+    const size_t fillerSize = size - sample.size() - FillerDataOverhead;
+
+    std::vector<std::byte> payload(fillerSize + 1, std::byte(0xff));
+    payload.back() = std::byte(0x80);
+
+    AppendNalUnit(sample, FillerDataHeader, payload);
+}
+
+uint32_t GetMacroblockCount(uint32_t size)
+{
+    return (size + 15) / 16;
+}
+} // namespace
+
+NullEncoder::NullEncoder() = default;
+
+NullEncoder::~NullEncoder() = default;
+
+bool NullEncoder::init(uint32_t width, uint32_t height, IDevice::VideoFormat videoFormat, Ratio fps, const Options& options)
+{
+    m_width = width;
+    m_height = height;
+    m_fps = fps;
+    m_synthetic = options.synthetic;
+    m_latency = options.latency ? options.latency : std::make_shared<StreamLatency>();
+
+    if (width == 0 || height == 0 || videoFormat == IDevice::VideoFormat::Unknown || fps.numerator == 0)
+    {
+        error("NULLENC", "Video dimensions, fps or format is invalid.");
+        return false;
+    }
+
+    if (m_synthetic.bitrate == 0 || m_synthetic.keyframeFactor <= 0.0f || m_synthetic.sizeVariation < 0.0f || m_synthetic.sizeVariation >= 1.0f)
+    {
+        error("NULLENC", "Synthetic stream needs a bitrate, a positive keyframe factor and a size variation below 1.");
+        return false;
+    }
+
+    // The IDR frames of a GOP take the place of that many P frames
+    const double averageFrameSize = m_synthetic.bitrate / 8.0 / fps.asFloat();
+    const uint32_t gopLength = m_synthetic.gopLength;
+    m_averagePFrameSize = gopLength > 0 ? averageFrameSize * gopLength / (m_synthetic.keyframeFactor + gopLength - 1) : averageFrameSize;
+
+    // The same sizes for every run, so that load tests can be compared
+    m_random.seed(1);
+
+    startSequence(width, height);
+
+    info("NULLENC", "Synthesizing %d x %d at %.1f MBit/s, IDR frames %.0f KB every %d frames, P frames %.0f KB +-%d%%.", width, height, m_synthetic.bitrate / 1e6,
+         m_averagePFrameSize * m_synthetic.keyframeFactor / 1024, gopLength, m_averagePFrameSize / 1024, int(m_synthetic.sizeVariation * 100));
+
+    return true;
+}
+
+void NullEncoder::shutdown()
+{
+    m_sample.clear();
+    m_firstFrame.clear();
+}
+
+void NullEncoder::logStatistics() const
+{
+    if (m_frameCount == 0)
+    {
+        return;
+    }
+
+    const double bitrate = m_byteCount * 8.0 * m_fps.asFloat() / m_frameCount;
+    info("NULLENC", "%d frames synthesized, %d of them IDR frames, %.2f MBit/s.", int(m_frameCount), int(m_idrFrameCount), bitrate / 1e6);
+}
+
+bool NullEncoder::setRegionOfInterest(const RegionOfInterest& regionOfInterest)
+{
+    RegionOfInterest aligned;
+    if (!AlignRegionOfInterest(regionOfInterest, m_width, m_height, aligned))
+    {
+        return false;
+    }
+
+    info("NULLENC", "Region of interest: %d, %d, %d x %d%s", aligned.rect.x, aligned.rect.y, aligned.rect.width, aligned.rect.height, aligned.zoom ? ", zoomed" : "");
+
+    std::lock_guard _(m_regionOfInterestMutex);
+    m_regionOfInterest = aligned;
+
+    return true;
+}
+
+bool NullEncoder::setOverlay(bool enabled)
+{
+    if (enabled)
+    {
+        warning("NULLENC", "The null encoder can't show the overlay.");
+        return false;
+    }
+
+    return true;
+}
+
+void NullEncoder::requestKeyFrame()
+{
+    m_keyFrameRequested = true;
+}
+
+void NullEncoder::startSequence(uint32_t width, uint32_t height)
+{
+    m_encodeWidth = width;
+    m_encodeHeight = height;
+    m_gopPosition = 0;
+
+    const uint32_t widthInMacroblocks = ::GetMacroblockCount(width);
+    const uint32_t heightInMacroblocks = ::GetMacroblockCount(height);
+
+    // Cropping works in units of two pixels for 4:2:0, odd sizes keep one more column or row
+    const uint32_t cropRight = (widthInMacroblocks * 16 - width) / 2;
+    const uint32_t cropBottom = (heightInMacroblocks * 16 - height) / 2;
+
+    BitWriter sps;
+    sps.writeBits(66, 8);   // profile_idc: baseline
+    sps.writeBits(0xc0, 8); // constraint_set0_flag and constraint_set1_flag: constrained baseline
+    sps.writeBits(::SelectLevel(widthInMacroblocks * heightInMacroblocks, m_fps, m_synthetic.bitrate), 8);
+    sps.writeUE(0);                   // seq_parameter_set_id
+    sps.writeUE(Log2MaxFrameNum - 4); // log2_max_frame_num_minus4
+    sps.writeUE(2);                   // pic_order_cnt_type: output order is decoding order
+    sps.writeUE(1);                   // max_num_ref_frames
+    sps.writeBits(0, 1);              // gaps_in_frame_num_value_allowed_flag
+    sps.writeUE(widthInMacroblocks - 1);
+    sps.writeUE(heightInMacroblocks - 1);
+    sps.writeBits(1, 1); // frame_mbs_only_flag
+    sps.writeBits(1, 1); // direct_8x8_inference_flag
+    sps.writeBits(cropRight > 0 || cropBottom > 0 ? 1 : 0, 1);
+
+    if (cropRight > 0 || cropBottom > 0)
+    {
+        sps.writeUE(0);
+        sps.writeUE(cropRight);
+        sps.writeUE(0);
+        sps.writeUE(cropBottom);
+    }
+
+    sps.writeBits(0, 1); // vui_parameters_present_flag
+    sps.writeTrailingBits();
+
+    BitWriter pps;
+    pps.writeUE(0);      // pic_parameter_set_id
+    pps.writeUE(0);      // seq_parameter_set_id
+    pps.writeBits(0, 1); // entropy_coding_mode_flag: CAVLC
+    pps.writeBits(0, 1); // bottom_field_pic_order_in_frame_present_flag
+    pps.writeUE(0);      // num_slice_groups_minus1
+    pps.writeUE(0);      // num_ref_idx_l0_default_active_minus1
+    pps.writeUE(0);      // num_ref_idx_l1_default_active_minus1
+    pps.writeBits(0, 1); // weighted_pred_flag
+    pps.writeBits(0, 2); // weighted_bipred_idc
+    pps.writeSE(0);      // pic_init_qp_minus26
+    pps.writeSE(0);      // pic_init_qs_minus26
+    pps.writeSE(0);      // chroma_qp_index_offset
+    pps.writeBits(1, 1); // deblocking_filter_control_present_flag, the slices turn it off
+    pps.writeBits(0, 1); // constrained_intra_pred_flag
+    pps.writeBits(0, 1); // redundant_pic_cnt_present_flag
+    pps.writeTrailingBits();
+
+    m_parameterSets.clear();
+    ::AppendNalUnit(m_parameterSets, SequenceParameterSetHeader, sps.getBytes());
+    ::AppendNalUnit(m_parameterSets, PictureParameterSetHeader, pps.getBytes());
+
+    // Viewers which connect from now on need to start with a frame of the new size
+    m_firstFrame.clear();
+
+    if (width != m_width || height != m_height)
+    {
+        info("NULLENC", "Synthesizing %d x %d.", width, height);
+    }
+}
+
+size_t NullEncoder::drawFrameSize(bool idr)
+{
+    const double average = idr ? m_averagePFrameSize * m_synthetic.keyframeFactor : m_averagePFrameSize;
+    const double variation = idr ? m_synthetic.sizeVariation / 2 : m_synthetic.sizeVariation;
+
+    std::uniform_real_distribution<double> distribution(-variation, variation);
+    return size_t(average * (1.0 + distribution(m_random)));
+}
+
+void NullEncoder::writeIDRFrame(size_t targetSize)
+{
+    BitWriter slice;
+    slice.writeUE(0);                    // first_mb_in_slice
+    slice.writeUE(7);                    // slice_type: I, like all slices of the picture
+    slice.writeUE(0);                    // pic_parameter_set_id
+    slice.writeBits(0, Log2MaxFrameNum); // frame_num
+    slice.writeUE(m_idrPicId);
+    slice.writeBits(0, 1); // no_output_of_prior_pics_flag
+    slice.writeBits(0, 1); // long_term_reference_flag
+    slice.writeSE(0);      // slice_qp_delta
+    slice.writeUE(1);      // disable_deblocking_filter_idc
+
+    const uint32_t macroblockCount = ::GetMacroblockCount(m_encodeWidth) * ::GetMacroblockCount(m_encodeHeight);
+    for (uint32_t i = 0; i < macroblockCount; ++i)
+    {
+        slice.writeBits(GrayMacroblock, 8);
+    }
+
+    slice.writeTrailingBits();
+
+    ::AppendNalUnit(m_sample, IDRSliceHeader, slice.getBytes());
+    ::AppendFillerData(m_sample, targetSize);
+
+    // Consecutive IDR frames need different ids
+    m_idrPicId = (m_idrPicId + 1) % 2;
+    m_frameNum = 1;
+}
+
+void NullEncoder::writePFrame(size_t targetSize)
+{
+    BitWriter slice;
+    slice.writeUE(0);                             // first_mb_in_slice
+    slice.writeUE(5);                             // slice_type: P, like all slices of the picture
+    slice.writeUE(0);                             // pic_parameter_set_id
+    slice.writeBits(m_frameNum, Log2MaxFrameNum); // frame_num
+    slice.writeBits(0, 1);                        // num_ref_idx_active_override_flag
+    slice.writeBits(0, 1);                        // ref_pic_list_modification_flag_l0
+    slice.writeBits(0, 1);                        // adaptive_ref_pic_marking_mode_flag
+    slice.writeSE(0);                             // slice_qp_delta
+    slice.writeUE(1);                             // disable_deblocking_filter_idc
+
+    // mb_skip_run over the whole picture, the decoder repeats the reference frame
+    slice.writeUE(::GetMacroblockCount(m_encodeWidth) * ::GetMacroblockCount(m_encodeHeight));
+    slice.writeTrailingBits();
+
+    ::AppendNalUnit(m_sample, PSliceHeader, slice.getBytes());
+    ::AppendFillerData(m_sample, targetSize);
+
+    m_frameNum = (m_frameNum + 1) % (1u << Log2MaxFrameNum);
+}
+
+void NullEncoder::onSample(const FrameRef& frame, IVideoStreamSampleConsumer* sampleConsumer)
+{
+    const uint64_t frameId = frame->frameId;
+    const auto encodeStartTime = std::chrono::steady_clock::now();
+
+    RegionOfInterest regionOfInterest;
+    {
+        std::lock_guard _(m_regionOfInterestMutex);
+        regionOfInterest = m_regionOfInterest;
+    }
+
+    // Only the size matters, a zoomed region is streamed at the frame size
+    const bool cropped = !regionOfInterest.rect.isEmpty() && !regionOfInterest.zoom;
+    const uint32_t encodeWidth = cropped ? regionOfInterest.rect.width : frame->width;
+    const uint32_t encodeHeight = cropped ? regionOfInterest.rect.height : frame->height;
+
+    if (encodeWidth != m_encodeWidth || encodeHeight != m_encodeHeight)
+    {
+        startSequence(encodeWidth, encodeHeight);
+    }
+
+    if (m_keyFrameRequested.exchange(false))
+    {
+        m_gopPosition = 0;
+    }
+
+    const bool idr = m_gopPosition == 0;
+    const size_t targetSize = drawFrameSize(idr);
+
+    m_sample.clear();
+    if (idr)
+    {
+        m_sample = m_parameterSets;
+        writeIDRFrame(targetSize);
+    }
+    else
+    {
+        writePFrame(targetSize);
+    }
+
+    if (++m_gopPosition == m_synthetic.gopLength)
+    {
+        m_gopPosition = 0;
+    }
+
+    Trace::Encode_EncodeFrameFinished(frameId, m_sample.size());
+
+    const auto encodeTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - encodeStartTime);
+    m_latency->encodeNs.store(encodeTime.count(), std::memory_order_relaxed);
+
+    ++m_frameCount;
+    m_idrFrameCount += idr ? 1 : 0;
+    m_byteCount += m_sample.size();
+
+    // Late viewers start with the latest IDR frame, which the following P frames refer to
+    if (idr)
+    {
+        m_firstFrame = m_sample;
+    }
+
+    sampleConsumer->onEncodedSampleAvailable(frame->timeStamp, m_sample, frameId, m_firstFrame);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "video_encoder.h"
+
+#include <random>
+
+// Stand-in for a real encoder to load test the streaming on its own: measures what WebRTCServer's fan-out and packetization
+// cost per viewer without capture, conversion or GPU time hiding it.
+//
+// The pixels are never read. Every frame becomes a valid baseline profile sample of the configured size instead: an IDR frame
+// which decodes to a gray picture or a P frame which skips every macroblock, padded with filler data NAL units. The sizes follow
+// the synthetic stream options, so the viewers get the bitrate, GOP pattern and keyframe spikes of a real stream.
+class NullEncoder : public IVideoEncoder
+{
+  public:
+    NullEncoder();
+    ~NullEncoder();
+
+    virtual bool init(uint32_t width, uint32_t height, IDevice::VideoFormat videoFormat, Ratio fps, const Options& options) override;
+    virtual void shutdown() override;
+
+    virtual const char* getName() const override
+    {
+        return "null";
+    }
+
+    virtual void logStatistics() const override;
+
+    virtual void onSample(const FrameRef& frame, IVideoStreamSampleConsumer* sampleConsumer) override;
+
+    // A region which is streamed at its own size changes the size in the sequence parameters, like a real encoder restart would
+    virtual bool setRegionOfInterest(const RegionOfInterest& regionOfInterest) override;
+
+    // There are no pixels to draw into
+    virtual bool setOverlay(bool enabled) override;
+
+    // Restarts the GOP with an IDR frame, like the real encoders
+    virtual void requestKeyFrame() override;
+
+  private:
+    // Starts a new sequence for the size, its next frame is an IDR frame with the sequence parameters
+    void startSequence(uint32_t width, uint32_t height);
+
+    // Target size of the next frame in bytes, drawn around the average of its frame type
+    size_t drawFrameSize(bool idr);
+
+    void writeIDRFrame(size_t targetSize);
+    void writePFrame(size_t targetSize);
+
+    std::vector<std::byte> m_sample;
+    std::vector<std::byte> m_firstFrame;
+
+    // The sequence and picture parameter sets in Annex-B, written once per size
+    std::vector<std::byte> m_parameterSets;
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+
+    // Smaller than the frame size while a region of interest is streamed at its own size
+    uint32_t m_encodeWidth = 0;
+    uint32_t m_encodeHeight = 0;
+
+    Options::SyntheticStream m_synthetic;
+
+    // Average P frame size which, together with the IDR frames, results in the configured bitrate
+    double m_averagePFrameSize = 0;
+
+    // Frames since the last IDR frame, the frame number in the slice headers and the id which tells consecutive IDR frames apart
+    uint32_t m_gopPosition = 0;
+    uint32_t m_frameNum = 0;
+    uint32_t m_idrPicId = 0;
+
+    std::minstd_rand m_random;
+
+    std::atomic<bool> m_keyFrameRequested = false;
+
+    std::mutex m_regionOfInterestMutex;
+    RegionOfInterest m_regionOfInterest;
+
+    std::shared_ptr<StreamLatency> m_latency;
+
+    Ratio m_fps;
+
+    uint64_t m_frameCount = 0;
+    uint64_t m_idrFrameCount = 0;
+    uint64_t m_byteCount = 0;
+};
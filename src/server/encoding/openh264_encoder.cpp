@@ -0,0 +1,395 @@
+#include "openh264_encoder.h"
+#include "conversion/nv12.h"
+#include "conversion/scaler.h"
+#include "conversion/text_overlay.h"
+#include "pipeline/repeated_frame_filter.h"
+#include "trace_logging.h"
+#include "video_input/frame.h"
+
+#include <wels/codec_api.h>
+
+namespace
+{
+// Average bits per pixel of the stream, about 6 MBit/s for 1080p30 which keeps camera images sharp without B frames
+constexpr double BitsPerPixel = 0.1;
+
+// Threads and slices per encoder. Every stream has its own encoder, so a few each keep several streams in real time.
+constexpr uint32_t MaxThreadCount = 4;
+
+// Splits interleaved NV12 chroma into the separate U and V planes of I420
+void SplitChroma(const std::byte* uv, std::byte* u, std::byte* v, size_t sampleCount)
+{
+    for (size_t i = 0; i < sampleCount; ++i)
+    {
+        u[i] = uv[i * 2];
+        v[i] = uv[i * 2 + 1];
+    }
+}
+} // namespace
+
+OpenH264Encoder::OpenH264Encoder() = default;
+
+OpenH264Encoder::~OpenH264Encoder()
+{
+    destroyEncoder();
+}
+
+bool OpenH264Encoder::init(uint32_t width, uint32_t height, IDevice::VideoFormat videoFormat, Ratio fps, const Options& options)
+{
+    m_width = width;
+    m_height = height;
+    m_fps = fps;
+    m_orientation = options.orientation;
+    m_cpuConversionThreads = std::max(options.cpuConversionThreads, 1u);
+    m_threadCount = std::clamp(std::thread::hardware_concurrency() / 2, 1u, MaxThreadCount);
+    m_framePool = FramePool::create();
+    m_overlayEnabled = options.overlay;
+    m_latency = options.latency ? options.latency : std::make_shared<StreamLatency>();
+
+    if (width == 0 || height == 0 || videoFormat == IDevice::VideoFormat::Unknown || fps.numerator == 0)
+    {
+        error("OPENH264", "Video dimensions, fps or format is invalid.");
+        return false;
+    }
+
+    if (options.skipRepeatedFrames)
+    {
+        m_repeatedFrameFilter = std::make_unique<RepeatedFrameFilter>(RepeatedFrameFilter::Options());
+    }
+
+    m_overlay = std::make_unique<TextOverlay>(TextOverlay::Options());
+
+    // Every format is converted on the CPU, there is no GPU to do it
+    m_nv12Converter = std::make_unique<NV12Converter>(videoFormat, m_cpuConversionThreads);
+
+    const size_t chromaSize = size_t((width + 1) / 2) * ((height + 1) / 2);
+    m_picture.resize(size_t(width) * height + chromaSize * 2);
+    m_interleavedChroma.resize(chromaSize * 2);
+
+    return createEncoder(width, height);
+}
+
+void OpenH264Encoder::shutdown()
+{
+    destroyEncoder();
+
+    m_nv12Converter = nullptr;
+    m_zoomScaler = nullptr;
+}
+
+bool OpenH264Encoder::createEncoder(uint32_t width, uint32_t height)
+{
+    destroyEncoder();
+
+    if (WelsCreateSVCEncoder(&m_encoder) != 0 || !m_encoder)
+    {
+        error("OPENH264", "Couldn't create the encoder.");
+        m_encoder = nullptr;
+        return false;
+    }
+
+    int traceLevel = WELS_LOG_ERROR;
+    m_encoder->SetOption(ENCODER_OPTION_TRACE_LEVEL, &traceLevel);
+
+    const int bitrate = int(std::min(double(width) * height * m_fps.asFloat() * BitsPerPixel, double(INT32_MAX)));
+
+    SEncParamExt params;
+    m_encoder->GetDefaultParams(&params);
+
+    params.iUsageType = CAMERA_VIDEO_REAL_TIME;
+    params.iPicWidth = int(width);
+    params.iPicHeight = int(height);
+    params.fMaxFrameRate = m_fps.asFloat();
+    params.iTargetBitrate = bitrate;
+    params.iRCMode = RC_BITRATE_MODE;
+    params.iComplexityMode = LOW_COMPLEXITY;
+
+    // Viewers which join late start with the first frame, an IDR frame is only sent after a size change
+    params.uiIntraPeriod = 0;
+    params.iNumRefFrame = 1;
+    params.iEntropyCodingModeFlag = 0;
+    params.eSpsPpsIdStrategy = CONSTANT_ID;
+    params.bEnableFrameSkip = false;
+    params.bEnableLongTermReference = false;
+    params.bEnableSSEI = false;
+    params.bPrefixNalAddingCtrl = false;
+    params.bEnableDenoise = false;
+    params.bEnableBackgroundDetection = false;
+    params.bEnableAdaptiveQuant = false;
+
+    params.iMultipleThreadIdc = static_cast<unsigned short>(m_threadCount);
+    params.iSpatialLayerNum = 1;
+    params.iTemporalLayerNum = 1;
+
+    SSpatialLayerConfig& layer = params.sSpatialLayers[0];
+    layer.iVideoWidth = int(width);
+    layer.iVideoHeight = int(height);
+    layer.fFrameRate = m_fps.asFloat();
+    layer.iSpatialBitrate = bitrate;
+    layer.iMaxSpatialBitrate = UNSPECIFIED_BIT_RATE;
+    layer.uiProfileIdc = PRO_BASELINE;
+    layer.sSliceArgument.uiSliceMode = SM_FIXEDSLCNUM_SLICE;
+    layer.sSliceArgument.uiSliceNum = m_threadCount;
+
+    if (m_encoder->InitializeExt(&params) != cmResultSuccess)
+    {
+        error("OPENH264", "Couldn't initialize the encoder for %d x %d.", width, height);
+        destroyEncoder();
+        return false;
+    }
+
+    int dataFormat = videoFormatI420;
+    m_encoder->SetOption(ENCODER_OPTION_DATAFORMAT, &dataFormat);
+
+    info("OPENH264", "Encoding %d x %d at %.1f MBit/s on %d threads.", width, height, bitrate / 1e6, m_threadCount);
+
+    m_encodeWidth = width;
+    m_encodeHeight = height;
+
+    // Viewers which connect from now on need to start with a frame of the new size
+    m_firstFrame.clear();
+
+    return true;
+}
+
+void OpenH264Encoder::destroyEncoder()
+{
+    if (m_encoder)
+    {
+        m_encoder->Uninitialize();
+        WelsDestroySVCEncoder(m_encoder);
+        m_encoder = nullptr;
+    }
+}
+
+void OpenH264Encoder::logStatistics() const
+{
+    if (m_repeatedFrameFilter)
+    {
+        m_repeatedFrameFilter->logStatistics();
+    }
+}
+
+bool OpenH264Encoder::setRegionOfInterest(const RegionOfInterest& regionOfInterest)
+{
+    RegionOfInterest aligned;
+    if (!AlignRegionOfInterest(regionOfInterest, m_width, m_height, aligned))
+    {
+        return false;
+    }
+
+    info("OPENH264", "Region of interest: %d, %d, %d x %d%s", aligned.rect.x, aligned.rect.y, aligned.rect.width, aligned.rect.height, aligned.zoom ? ", zoomed" : "");
+
+    std::lock_guard _(m_regionOfInterestMutex);
+    m_regionOfInterest = aligned;
+
+    return true;
+}
+
+bool OpenH264Encoder::setOverlay(bool enabled)
+{
+    info("OPENH264", "Overlay %s.", enabled ? "on" : "off");
+
+    m_overlayEnabled = enabled;
+    return true;
+}
+
+void OpenH264Encoder::requestKeyFrame()
+{
+    m_keyFrameRequested = true;
+}
+
+const TextOverlay* OpenH264Encoder::updateOverlay(const Frame& frame)
+{
+    if (!m_overlayEnabled)
+    {
+        return nullptr;
+    }
+
+    SetOverlayText(*m_overlay, frame, *m_latency);
+    return m_overlay.get();
+}
+
+bool OpenH264Encoder::zoom(const Frame& region, std::byte* dstY, std::byte* dstUV, const TextOverlay* overlay)
+{
+    const Frame* source = &region;
+    FrameRef converted;
+
+    // The scaler reads NV12 in the right orientation straight from the capture buffer, everything else takes one more pass
+    if (region.videoFormat != IDevice::VideoFormat::NV12 || m_orientation != Orientation{})
+    {
+        const size_t lumaSize = size_t(region.width) * region.height;
+        m_zoomBuffer.resize(lumaSize * 3 / 2);
+
+        converted = m_framePool->acquire();
+        converted->videoFormat = IDevice::VideoFormat::NV12;
+        converted->width = region.width;
+        converted->height = region.height;
+        converted->setPackedData(m_zoomBuffer.data(), m_zoomBuffer.size());
+
+        std::byte* y = m_zoomBuffer.data();
+        std::byte* uv = y + lumaSize;
+
+        if (!m_nv12Converter->convert(region, y, region.width, uv, region.width, m_orientation))
+        {
+            return false;
+        }
+
+        source = converted.get();
+    }
+
+    const NV12Scaler::Size regionSize = {region.width, region.height};
+
+    if (!m_zoomScaler || m_zoomScaler->getSourceSize() != regionSize)
+    {
+        m_zoomScaler = std::make_unique<NV12Scaler>(regionSize, std::vector<NV12Scaler::Size>{{m_width, m_height}}, m_cpuConversionThreads);
+    }
+
+    const size_t uvPitch = size_t((m_width + 1) / 2) * 2;
+    const NV12Planes destination = {dstY, m_width, dstUV, uvPitch};
+    if (!m_zoomScaler->scale(*source, {&destination, 1}))
+    {
+        return false;
+    }
+
+    // Drawn on top of the scaled picture so that the text stays sharp, this only touches the overlay's own rows
+    if (overlay)
+    {
+        overlay->drawNV12(dstY, m_width, dstUV, uvPitch, m_width, 0, m_height);
+    }
+
+    return true;
+}
+
+void OpenH264Encoder::onSample(const FrameRef& frame, IVideoStreamSampleConsumer* sampleConsumer)
+{
+    const uint64_t frameId = frame->frameId;
+
+    RegionOfInterest regionOfInterest;
+    {
+        std::lock_guard _(m_regionOfInterestMutex);
+        regionOfInterest = m_regionOfInterest;
+    }
+
+    // Cropping moves the start of the planes of a view of the frame, the pixels are only read once by the conversion below
+    FrameRef source = frame;
+    if (!regionOfInterest.rect.isEmpty())
+    {
+        source = m_framePool->acquireView(frame);
+
+        if (!source->crop(regionOfInterest.rect))
+        {
+            error("OPENH264", "Couldn't crop the %d x %d frame to the region of interest.", frame->width, frame->height);
+            return;
+        }
+    }
+
+    const bool zoomed = regionOfInterest.zoom && !regionOfInterest.rect.isEmpty();
+    const uint32_t encodeWidth = zoomed ? m_width : source->width;
+    const uint32_t encodeHeight = zoomed ? m_height : source->height;
+
+    // A repeat isn't encoded at all, the viewers keep showing the previous frame. The zoom changes what is made of the same pixels.
+    // New viewers don't have that frame, so a requested key frame is encoded in any case.
+    if (m_repeatedFrameFilter && !m_keyFrameRequested && m_repeatedFrameFilter->isRepeat(*source, zoomed ? 1 : 0))
+    {
+        Trace::Encode_FrameSkipped(frameId);
+        return;
+    }
+
+    const auto encodeStartTime = std::chrono::steady_clock::now();
+
+    if ((encodeWidth != m_encodeWidth || encodeHeight != m_encodeHeight || !m_encoder) && !createEncoder(encodeWidth, encodeHeight))
+    {
+        return;
+    }
+
+    // The planes of the picture are packed for the encoded size, which is at most the frame size they were allocated for
+    const uint32_t chromaWidth = (encodeWidth + 1) / 2;
+    const size_t lumaSize = size_t(encodeWidth) * encodeHeight;
+    const size_t chromaSize = size_t(chromaWidth) * ((encodeHeight + 1) / 2);
+
+    std::byte* dstY = m_picture.data();
+    std::byte* dstU = dstY + lumaSize;
+    std::byte* dstV = dstU + chromaSize;
+
+    const TextOverlay* overlay = updateOverlay(*frame);
+
+    // Luma is written straight into the picture, only the chroma takes a detour through the interleaved plane
+    const bool converted = zoomed ? zoom(*source, dstY, m_interleavedChroma.data(), overlay)
+                                  : m_nv12Converter->convert(*source, dstY, encodeWidth, m_interleavedChroma.data(), size_t(chromaWidth) * 2, m_orientation, overlay);
+
+    if (!converted)
+    {
+        return;
+    }
+
+    ::SplitChroma(m_interleavedChroma.data(), dstU, dstV, chromaSize);
+
+    SSourcePicture picture = {};
+    picture.iColorFormat = videoFormatI420;
+    picture.iPicWidth = int(encodeWidth);
+    picture.iPicHeight = int(encodeHeight);
+    picture.iStride[0] = int(encodeWidth);
+    picture.iStride[1] = int(chromaWidth);
+    picture.iStride[2] = int(chromaWidth);
+    picture.pData[0] = reinterpret_cast<unsigned char*>(dstY);
+    picture.pData[1] = reinterpret_cast<unsigned char*>(dstU);
+    picture.pData[2] = reinterpret_cast<unsigned char*>(dstV);
+    picture.uiTimeStamp = std::chrono::duration_cast<std::chrono::milliseconds>(frame->timeStamp).count();
+
+    // Every request which arrived until now is served by this frame
+    if (m_keyFrameRequested.exchange(false))
+    {
+        m_encoder->ForceIntraFrame(true);
+    }
+
+    SFrameBSInfo bitstream = {};
+    if (m_encoder->EncodeFrame(&picture, &bitstream) != cmResultSuccess)
+    {
+        error("OPENH264", "Failed to encode frame %llu.", (unsigned long long)frameId);
+        return;
+    }
+
+    // The NAL units of all layers follow each other as Annex-B with start codes, an IDR frame starts with the sequence parameters
+    m_sample.clear();
+    if (bitstream.eFrameType != videoFrameTypeSkip)
+    {
+        for (int i = 0; i < bitstream.iLayerNum; ++i)
+        {
+            const SLayerBSInfo& layer = bitstream.sLayerInfo[i];
+
+            size_t layerSize = 0;
+            for (int nal = 0; nal < layer.iNalCount; ++nal)
+            {
+                layerSize += size_t(layer.pNalLengthInByte[nal]);
+            }
+
+            const std::byte* layerData = reinterpret_cast<const std::byte*>(layer.pBsBuf);
+            m_sample.insert(m_sample.end(), layerData, layerData + layerSize);
+        }
+    }
+
+    Trace::Encode_EncodeFrameFinished(frameId, m_sample.size());
+
+    const auto encodeTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - encodeStartTime);
+    m_latency->encodeNs.store(encodeTime.count(), std::memory_order_relaxed);
+
+    if (m_repeatedFrameFilter)
+    {
+        // The picture the encoder reads stands in for the upload of the hardware encoders
+        m_repeatedFrameFilter->onFrameEncoded(lumaSize + chromaSize * 2, m_sample.size(), encodeTime);
+    }
+
+    if (m_sample.empty())
+    {
+        return;
+    }
+
+    // Viewers which connect later start with the latest IDR frame, which the frames after it refer to
+    if (m_firstFrame.empty() || bitstream.eFrameType == videoFrameTypeIDR)
+    {
+        m_firstFrame = m_sample;
+    }
+
+    sampleConsumer->onEncodedSampleAvailable(frame->timeStamp, m_sample, frameId, m_firstFrame);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "video_encoder.h"
+
+class ISVCEncoder;
+
+class NV12Converter;
+class NV12Scaler;
+class RepeatedFrameFilter;
+
+// Software H.264 encoder on top of Cisco's openh264, for machines without an NVIDIA GPU and for benchmarking the rest of the pipeline.
+//
+// Tuned for latency like NVEnc: baseline profile with CAVLC, one reference frame, no periodic IDR frames and a rate control which
+// never skips frames. A frame is split into one slice per encoder thread, so that it is encoded on several cores at once.
+// Frames are converted to NV12 on the CPU and their chroma is split into the I420 planes openh264 takes.
+class OpenH264Encoder : public IVideoEncoder
+{
+  public:
+    OpenH264Encoder();
+    ~OpenH264Encoder();
+
+    virtual bool init(uint32_t width, uint32_t height, IDevice::VideoFormat videoFormat, Ratio fps, const Options& options) override;
+    virtual void shutdown() override;
+
+    virtual const char* getName() const override
+    {
+        return "openh264";
+    }
+
+    virtual void logStatistics() const override;
+
+    virtual void onSample(const FrameRef& frame, IVideoStreamSampleConsumer* sampleConsumer) override;
+
+    // A region which is streamed at its own size restarts the encoder at that size, the viewers continue with its IDR frame
+    virtual bool setRegionOfInterest(const RegionOfInterest& regionOfInterest) override;
+    virtual bool setOverlay(bool enabled) override;
+    virtual void requestKeyFrame() override;
+
+  private:
+    // Creates the encoder for the frame size, its first frame is an IDR frame with the sequence parameters
+    bool createEncoder(uint32_t width, uint32_t height);
+    void destroyEncoder();
+
+    // Scales a cropped frame up to the full frame size while writing it as NV12
+    bool zoom(const Frame& region, std::byte* dstY, std::byte* dstUV, const TextOverlay* overlay);
+
+    // Lays out the overlay text for the frame, returns null while the overlay is off
+    const TextOverlay* updateOverlay(const Frame& frame);
+
+    ISVCEncoder* m_encoder = nullptr;
+
+    std::unique_ptr<NV12Converter> m_nv12Converter;
+    std::unique_ptr<NV12Scaler> m_zoomScaler;
+    std::unique_ptr<RepeatedFrameFilter> m_repeatedFrameFilter;
+    std::unique_ptr<TextOverlay> m_overlay;
+
+    // The I420 picture handed to the encoder and the interleaved chroma the conversion writes before it is split
+    std::vector<std::byte> m_picture;
+    std::vector<std::byte> m_interleavedChroma;
+    std::vector<std::byte> m_zoomBuffer;
+
+    std::vector<std::byte> m_sample;
+    std::vector<std::byte> m_firstFrame;
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+
+    // Smaller than the frame size while a region of interest is streamed at its own size
+    uint32_t m_encodeWidth = 0;
+    uint32_t m_encodeHeight = 0;
+
+    uint32_t m_threadCount = 1;
+    uint32_t m_cpuConversionThreads = 1;
+
+    Orientation m_orientation;
+
+    std::mutex m_regionOfInterestMutex;
+    RegionOfInterest m_regionOfInterest;
+
+    std::atomic<bool> m_overlayEnabled = false;
+    std::atomic<bool> m_keyFrameRequested = false;
+    std::shared_ptr<StreamLatency> m_latency;
+
+    // Views of the captured frames for cropping
+    std::shared_ptr<FramePool> m_framePool;
+
+    Ratio m_fps;
+};
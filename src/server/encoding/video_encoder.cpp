@@ -0,0 +1,111 @@
+#include "video_encoder.h"
+#include "conversion/text_overlay.h"
+#include "null_encoder.h"
+#include "openh264_encoder.h"
+#include "video_input/frame.h"
+
+#ifdef _WIN32
+#include "nvenc.h"
+#endif
+
+namespace
+{
+// Probed in this order by "auto", the software encoder works everywhere but takes CPU time the conversions could use
+constexpr const char* AutoBackends[] = {"nvenc", "openh264"};
+
+std::unique_ptr<IVideoEncoder> InstantiateVideoEncoder(const std::string& backend)
+{
+#ifdef _WIN32
+    if (backend == "nvenc")
+    {
+        return std::make_unique<NVEnc>();
+    }
+#endif
+
+    if (backend == "openh264")
+    {
+        return std::make_unique<OpenH264Encoder>();
+    }
+
+    // Never probed by "auto", it doesn't show the captured pixels
+    if (backend == "null")
+    {
+        return std::make_unique<NullEncoder>();
+    }
+
+    return nullptr;
+}
+} // namespace
+
+std::unique_ptr<IVideoEncoder> CreateVideoEncoder(const std::string& backend, uint32_t width, uint32_t height, IDevice::VideoFormat videoFormat, Ratio fps,
+                                                  const IVideoEncoder::Options& options)
+{
+    const bool probe = backend == "auto";
+    const std::vector<std::string> candidates = probe ? std::vector<std::string>(std::begin(AutoBackends), std::end(AutoBackends)) : std::vector<std::string>{backend};
+
+    for (const auto& candidate : candidates)
+    {
+        auto encoder = ::InstantiateVideoEncoder(candidate);
+
+        if (!encoder)
+        {
+            if (!probe)
+            {
+                error("ENCODER", "Unknown or unsupported encoder '%s'.", candidate.c_str());
+            }
+
+            continue;
+        }
+
+        if (encoder->init(width, height, videoFormat, fps, options))
+        {
+            info("ENCODER", "Encoding %d x %d with %s.", width, height, encoder->getName());
+            return encoder;
+        }
+
+        encoder->shutdown();
+
+        if (probe)
+        {
+            warning("ENCODER", "Encoder '%s' isn't available on this machine.", candidate.c_str());
+        }
+    }
+
+    return nullptr;
+}
+
+bool AlignRegionOfInterest(const RegionOfInterest& regionOfInterest, uint32_t width, uint32_t height, RegionOfInterest& aligned)
+{
+    aligned = {};
+    aligned.zoom = regionOfInterest.zoom;
+
+    if (regionOfInterest.rect.isEmpty())
+    {
+        return true;
+    }
+
+    const FrameRect& rect = regionOfInterest.rect;
+    aligned.rect = {rect.x & ~1u, rect.y & ~1u, (rect.width - (rect.x & 1)) & ~1u, (rect.height - (rect.y & 1)) & ~1u};
+
+    if (aligned.rect.isEmpty() || uint64_t(aligned.rect.x) + aligned.rect.width > width || uint64_t(aligned.rect.y) + aligned.rect.height > height)
+    {
+        warning("ENCODER", "Region of interest %d, %d, %d x %d doesn't fit into the %d x %d frame.", rect.x, rect.y, rect.width, rect.height, width, height);
+        return false;
+    }
+
+    return true;
+}
+
+void SetOverlayText(TextOverlay& overlay, const Frame& frame, const StreamLatency& latency)
+{
+    // The capture time is shown on the device's clock, e.g. the wall clock for the test pattern
+    const auto captureTime = std::chrono::duration_cast<std::chrono::milliseconds>(frame.timeStamp).count();
+    const double encodeTime = latency.encodeNs.load(std::memory_order_relaxed) / 1e6;
+    const double sendTime = latency.sendNs.load(std::memory_order_relaxed) / 1e6;
+
+    char text[128];
+    std::snprintf(text, sizeof(text), "FRAME %llu\nCAPTURE %02d:%02d:%02d.%03d\nENCODE %.1f MS SEND %.1f MS", (unsigned long long)frame.frameId,
+                  int(captureTime / 3600000 % 24), int(captureTime / 60000 % 60), int(captureTime / 1000 % 60), int(captureTime % 1000), encodeTime, sendTime);
+
+    overlay.setText(text);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "conversion/orientation.h"
+#include "pipeline/stream_latency.h"
+#include "streaming/streaming.h"
+#include "video_input/device.h"
+
+class TextOverlay;
+
+// Encodes the frames of one stream to H.264 and hands the samples to the stream's consumer.
+//
+// Every backend takes frames in any capture format, applies the orientation, the region of interest and the overlay
+// the viewers asked for, and produces baseline profile Annex-B samples which start with an IDR frame carrying the
+// sequence parameters. The pipelines only see this interface, so a backend can be picked at startup.
+class IVideoEncoder : public IDeviceSampleHandler, public IVideoStreamControl
+{
+  public:
+    struct Options
+    {
+        // RGB formats are converted to NV12 on the GPU, unless this is set. Then they are converted on the CPU
+        // by that many threads while uploading, which frees the GPU and works the same way for every encoder.
+        // Software encoders always convert on the CPU and use at least one thread for it.
+        uint32_t cpuConversionThreads = 0;
+
+        // Applied while the frame is copied into the encoder's input
+        Orientation orientation;
+
+        // Frames which repeat the previous one are neither uploaded nor encoded, see RepeatedFrameFilter
+        bool skipRepeatedFrames = false;
+
+        // Initial state of the overlay, see setOverlay()
+        bool overlay = false;
+
+        // Shared with the stream's pipeline, which adds the send latency the overlay shows. Created if not given.
+        std::shared_ptr<StreamLatency> latency;
+
+        // Shape of the samples of the "null" backend, which doesn't encode at all, see NullEncoder
+        struct SyntheticStream
+        {
+            // Average over a GOP in bits per second
+            uint32_t bitrate = 6000000;
+
+            // Frames from one IDR frame to the next, 0 only sends one at the start and after a size change like the real encoders
+            uint32_t gopLength = 300;
+
+            // An IDR frame is this many times the size of an average P frame
+            float keyframeFactor = 8.0f;
+
+            // P frame sizes vary uniformly by up to this fraction around their average, IDR frames by half of it
+            float sizeVariation = 0.3f;
+        } synthetic;
+    };
+
+    virtual ~IVideoEncoder() = default;
+
+    // Returns false if the backend isn't available on this machine or can't encode the frames
+    virtual bool init(uint32_t width, uint32_t height, IDevice::VideoFormat videoFormat, Ratio fps, const Options& options) = 0;
+    virtual void shutdown() = 0;
+
+    // Short name of the backend, as accepted by CreateVideoEncoder()
+    virtual const char* getName() const = 0;
+
+    virtual void logStatistics() const = 0;
+};
+
+// Creates and initializes an encoder of the named backend, "nvenc", "openh264" or "null" for load tests. "auto" probes the hardware encoder first
+// and falls back to the software one, so that machines without an NVIDIA GPU can still stream. Returns null if no backend could be initialized.
+std::unique_ptr<IVideoEncoder> CreateVideoEncoder(const std::string& backend, uint32_t width, uint32_t height, IDevice::VideoFormat videoFormat, Ratio fps,
+                                                  const IVideoEncoder::Options& options);
+
+// Lays out the overlay text all encoders show: the frame id, its capture time and the latencies of the stream
+void SetOverlayText(TextOverlay& overlay, const Frame& frame, const StreamLatency& latency);
+
+// Shrinks the region to even coordinates, so that cropping works on whole chroma samples.
+// Returns false if the region doesn't fit into a frame of the given size.
+bool AlignRegionOfInterest(const RegionOfInterest& regionOfInterest, uint32_t width, uint32_t height, RegionOfInterest& aligned);
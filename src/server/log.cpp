@@ -1,39 +1,65 @@
-
 #include <iostream>
 
-inline std::ostream& red(std::ostream& s)
+namespace
+{
+#ifdef _WIN32
+enum class Color : WORD
+{
+    Red = FOREGROUND_RED | FOREGROUND_INTENSITY,
+    Green = FOREGROUND_GREEN | FOREGROUND_INTENSITY,
+    Blue = FOREGROUND_BLUE | FOREGROUND_INTENSITY,
+    Yellow = FOREGROUND_GREEN | FOREGROUND_RED | FOREGROUND_INTENSITY,
+    White = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE
+};
+
+std::ostream& SetColor(std::ostream& s, Color color)
 {
     HANDLE hStdout = GetStdHandle(STD_OUTPUT_HANDLE);
-    SetConsoleTextAttribute(hStdout, FOREGROUND_RED | FOREGROUND_INTENSITY);
+    SetConsoleTextAttribute(hStdout, WORD(color));
     return s;
 }
+#else
+// ANSI escape sequences, the terminal's default color stands in for white
+enum class Color
+{
+    Red,
+    Green,
+    Blue,
+    Yellow,
+    White
+};
+
+std::ostream& SetColor(std::ostream& s, Color color)
+{
+    constexpr const char* EscapeSequences[] = {"\x1b[91m", "\x1b[92m", "\x1b[94m", "\x1b[93m", "\x1b[0m"};
+    return s << EscapeSequences[int(color)];
+}
+#endif
+} // namespace
+
+inline std::ostream& red(std::ostream& s)
+{
+    return SetColor(s, Color::Red);
+}
 
 inline std::ostream& green(std::ostream& s)
 {
-    HANDLE hStdout = GetStdHandle(STD_OUTPUT_HANDLE);
-    SetConsoleTextAttribute(hStdout, FOREGROUND_GREEN | FOREGROUND_INTENSITY);
-    return s;
+    return SetColor(s, Color::Green);
 }
 
 inline std::ostream& blue(std::ostream& s)
 {
-    HANDLE hStdout = GetStdHandle(STD_OUTPUT_HANDLE);
-    SetConsoleTextAttribute(hStdout, FOREGROUND_BLUE | FOREGROUND_INTENSITY);
-    return s;
+    return SetColor(s, Color::Blue);
 }
 
 inline std::ostream& yellow(std::ostream& s)
 {
-    HANDLE hStdout = GetStdHandle(STD_OUTPUT_HANDLE);
-    SetConsoleTextAttribute(hStdout, FOREGROUND_GREEN | FOREGROUND_RED | FOREGROUND_INTENSITY);
-    return s;
+    return SetColor(s, Color::Yellow);
 }
 
 inline std::ostream& white(std::ostream& s)
 {
-    HANDLE hStdout = GetStdHandle(STD_OUTPUT_HANDLE);
-    SetConsoleTextAttribute(hStdout, FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE);
-    return s;
+    return SetColor(s, Color::White);
 }
 
 void error(const char* tag, const char* msg...)
@@ -41,7 +67,7 @@ void error(const char* tag, const char* msg...)
     char buf[256];
     va_list args;
     va_start(args, msg);
-    vsnprintf_s(buf, _TRUNCATE, msg, args);
+    std::vsnprintf(buf, sizeof(buf), msg, args);
     va_end(args);
 
     std::cout << white << "[" << red << tag << white << "] " << buf << std::endl;
@@ -52,7 +78,7 @@ void warning(const char* tag, const char* msg...)
     char buf[256];
     va_list args;
     va_start(args, msg);
-    vsnprintf_s(buf, _TRUNCATE, msg, args);
+    std::vsnprintf(buf, sizeof(buf), msg, args);
     va_end(args);
 
     std::cout << white << "[" << yellow << tag << white << "] " << buf << std::endl;
@@ -63,7 +89,7 @@ void info(const char* tag, const char* msg...)
     char buf[256];
     va_list args;
     va_start(args, msg);
-    vsnprintf_s(buf, _TRUNCATE, msg, args);
+    std::vsnprintf(buf, sizeof(buf), msg, args);
     va_end(args);
 
     std::cout << white << "[" << tag << "] " << buf << std::endl;
@@ -75,7 +101,7 @@ void debug(const char* tag, const char* msg...)
     char buf[256];
     va_list args;
     va_start(args, msg);
-    vsnprintf_s(buf, _TRUNCATE, msg, args);
+    std::vsnprintf(buf, sizeof(buf), msg, args);
     va_end(args);
 
     std::cout << white << "[" << blue << tag << white << "] " << buf << std::endl;
@@ -0,0 +1,594 @@
+
+#include "cxxopts.hpp"
+#include "encoding/video_encoder.h"
+#include "pipeline/deinterlaced_device.h"
+#include "pipeline/frame_pipeline.h"
+#include "pipeline/mjpeg_decoded_device.h"
+#include "pipeline/simulcast.h"
+#include "streaming/webrtc.h"
+#include "version.h"
+#include "video_input/file.h"
+#include "video_input/test_pattern.h"
+#include "video_input/video_format.h"
+#include "video_input/video_mode.h"
+
+#ifdef _WIN32
+#include "video_input/media_foundation.h"
+using CaptureVideoInput = MediaFoundationVideoInput;
+#else
+#include "video_input/v4l2.h"
+using CaptureVideoInput = V4L2VideoInput;
+
+#include <csignal>
+#endif
+
+#ifdef _DEBUG
+const bool debugBuild = true;
+#else
+const bool debugBuild = false;
+#endif
+
+static std::atomic<bool> run = true;
+
+#ifdef _WIN32
+// Ensure that the nVidia and AMD drivers put us on the high power GPU
+extern "C"
+{
+    _declspec(dllexport) DWORD NvOptimusEnablement = 0x1;
+    _declspec(dllexport) DWORD AmdPowerXpressRequestHighPerformance = 0x1;
+}
+
+BOOL WINAPI consoleHandler(DWORD signal)
+{
+    if (signal == CTRL_C_EVENT)
+    {
+        info("MAIN", "CTRL+C");
+        run = false;
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+bool setStopHandler()
+{
+    return SetConsoleCtrlHandler(consoleHandler, TRUE);
+}
+#else
+// Only lock free atomics may be touched in a signal handler, so the main loop reports the stop
+void signalHandler(int)
+{
+    run = false;
+}
+
+bool setStopHandler()
+{
+    return std::signal(SIGINT, signalHandler) != SIG_ERR && std::signal(SIGTERM, signalHandler) != SIG_ERR;
+}
+#endif
+
+bool parseFrameSize(const std::string& size, uint32_t& width, uint32_t& height)
+{
+    if (std::sscanf(size.c_str(), "%ux%u", &width, &height) != 2)
+    {
+        error("MAIN", "Invalid frame size '%s', expected WIDTHxHEIGHT.", size.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool parseFrameRate(const std::string& fps, Ratio& frameRate)
+{
+    frameRate.denominator = 1;
+    if (std::sscanf(fps.c_str(), "%u/%u", &frameRate.numerator, &frameRate.denominator) < 1 || frameRate.denominator == 0)
+    {
+        error("MAIN", "Invalid frame rate '%s', expected FPS or NUMERATOR/DENOMINATOR.", fps.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool parseFileOptions(const cxxopts::ParseResult& result, FileVideoInput::Options& fileOptions)
+{
+    if (result.count("format"))
+    {
+        const auto format = result["format"].as<std::string>();
+
+        fileOptions.videoFormat = GetVideoFormatByName(format);
+
+        if (fileOptions.videoFormat == IDevice::VideoFormat::Unknown)
+        {
+            error("MAIN", "Unknown video format '%s'.", format.c_str());
+            return false;
+        }
+
+        if (GetVideoFormatInfo(fileOptions.videoFormat).compressed)
+        {
+            error("MAIN", "Video format '%s' is only supported for capture devices.", format.c_str());
+            return false;
+        }
+    }
+
+    if (result.count("size") && !parseFrameSize(result["size"].as<std::string>(), fileOptions.width, fileOptions.height))
+    {
+        return false;
+    }
+
+    if (result.count("fps") && !parseFrameRate(result["fps"].as<std::string>(), fileOptions.fps))
+    {
+        return false;
+    }
+
+    fileOptions.realTime = result.count("unpaced") == 0;
+
+    return true;
+}
+
+bool parseVideoModeConstraints(const cxxopts::ParseResult& result, VideoModeConstraints& constraints)
+{
+    if (result.count("capture-size") && !parseFrameSize(result["capture-size"].as<std::string>(), constraints.width, constraints.height))
+    {
+        return false;
+    }
+
+    if (result.count("capture-fps") && !parseFrameRate(result["capture-fps"].as<std::string>(), constraints.fps))
+    {
+        return false;
+    }
+
+    return parseFrameRate(result["capture-min-fps"].as<std::string>(), constraints.minimumFps);
+}
+
+bool parseOrientation(const std::string& name, Orientation& orientation)
+{
+    if (name == "normal")
+    {
+        orientation = {};
+    }
+    else if (name == "mirror")
+    {
+        orientation = {true, false};
+    }
+    else if (name == "flip")
+    {
+        orientation = {false, true};
+    }
+    else if (name == "rotate180")
+    {
+        orientation = {true, true};
+    }
+    else
+    {
+        error("MAIN", "Unknown orientation '%s'.", name.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// "auto" only deinterlaces inputs which report interlaced frames, the modes force it for inputs that misreport
+struct DeinterlaceOptions
+{
+    bool enabled = true;
+    bool force = false;
+    Deinterlacer::Mode mode = Deinterlacer::Mode::MotionAdaptive;
+};
+
+bool parseDeinterlace(const std::string& name, DeinterlaceOptions& options)
+{
+    if (name == "auto")
+    {
+        options = {};
+    }
+    else if (name == "off")
+    {
+        options.enabled = false;
+    }
+    else if (name == "bob")
+    {
+        options = {true, true, Deinterlacer::Mode::Bob};
+    }
+    else if (name == "adaptive")
+    {
+        options = {true, true, Deinterlacer::Mode::MotionAdaptive};
+    }
+    else
+    {
+        error("MAIN", "Unknown deinterlacing mode '%s'.", name.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// Everything belonging to one capture -> encode -> stream chain
+struct StreamPipeline
+{
+    std::shared_ptr<IDevice> device;
+    std::unique_ptr<IVideoEncoder> encoder;
+    WebRTCStream* stream = nullptr;
+    std::unique_ptr<FramePipeline> pipeline;
+};
+
+int main(int argc, char** argv)
+{
+    {
+        info("MAIN", "Initializing version " APP_VERSION_NAME);
+
+        // Parse command line options
+        cxxopts::Options options(APP_NAME, "PPS Video Mirror Server");
+        options.add_options()("d,device", "The video capturer device name, can be given multiple times to stream several devices", cxxopts::value<std::vector<std::string>>());
+        options.add_options()("mode-cache", "File which remembers the video mode picked for each capture device", cxxopts::value<std::string>()->default_value("video_modes.json"));
+        options.add_options()("capture-size", "Capture in this frame size as WIDTHxHEIGHT instead of the largest one", cxxopts::value<std::string>());
+        options.add_options()("capture-fps", "Capture at this frame rate as FPS or NUMERATOR/DENOMINATOR instead of picking one", cxxopts::value<std::string>());
+        options.add_options()("capture-min-fps", "Prefer capture modes with at least this frame rate over larger but slower ones",
+                              cxxopts::value<std::string>()->default_value("25"));
+        options.add_options()("encoder", "H.264 encoder (auto, nvenc, openh264, null). Auto uses NVENC if the GPU has it and openh264 otherwise",
+                              cxxopts::value<std::string>()->default_value("auto"));
+        options.add_options()("cpu-conversion-threads", "Convert RGB input to NV12 on this many CPU threads instead of the GPU, 0 uses the GPU", cxxopts::value<uint32_t>()->default_value("0"));
+        options.add_options()("s,stream", "The stream names viewers pick from, in the order of the inputs. Defaults to the device names", cxxopts::value<std::vector<std::string>>());
+        options.add_options()("orientation", "Orientation of each stream in the order of the inputs (normal, mirror, flip, rotate180)", cxxopts::value<std::vector<std::string>>());
+        options.add_options()("mjpeg-threads", "Decode the frames of MJPEG capture devices on this many threads", cxxopts::value<uint32_t>()->default_value("3"));
+        options.add_options()("deinterlace", "Deinterlacing of the inputs (auto, off, bob, adaptive). Auto uses adaptive for inputs which report interlaced frames",
+                              cxxopts::value<std::string>()->default_value("auto"));
+        options.add_options()("skip-repeated-frames", "Don't encode frames which repeat the previous one, e.g. from a 30p camera on a 60p link or a static scene");
+        options.add_options()("overlay", "Burn frame id, capture time and latency into every stream, viewers can toggle it per stream");
+        options.add_options()("layers", "Heights of smaller simulcast layers for every input, e.g. 720,360. Offered as the streams NAME-720p etc.", cxxopts::value<std::vector<uint32_t>>());
+        options.add_options("Synthetic input")("f,file", "Replay a raw or Y4M video file instead of using a capture device", cxxopts::value<std::vector<std::string>>());
+        options.add_options("Synthetic input")("test-pattern", "Stream a generated test pattern with a frame id / time stamp barcode instead of using a capture device");
+        options.add_options("Synthetic input")("format", "Video format of a raw file or the test pattern (nv12, bgra, rgb24, i420, yuy2, uyvy, p010)", cxxopts::value<std::string>());
+        options.add_options("Synthetic input")("size", "Frame size of a raw file or the test pattern as WIDTHxHEIGHT", cxxopts::value<std::string>());
+        options.add_options("Synthetic input")("fps", "Frame rate of a raw file or the test pattern as FPS or NUMERATOR/DENOMINATOR", cxxopts::value<std::string>());
+        options.add_options("Synthetic input")("unpaced", "Deliver frames as fast as possible instead of in real time");
+        options.add_options("Load testing")("null-bitrate", "Average bitrate of the null encoder's synthetic stream in kbit/s", cxxopts::value<uint32_t>()->default_value("6000"));
+        options.add_options("Load testing")("null-gop", "Frames from one IDR frame of the null encoder to the next, 0 only sends the first", cxxopts::value<uint32_t>()->default_value("300"));
+        options.add_options("Load testing")("null-keyframe-factor", "Size of the null encoder's IDR frames relative to its average P frame", cxxopts::value<float>()->default_value("8"));
+        options.add_options("Load testing")("null-size-variation", "Fraction by which the null encoder's frame sizes vary around their average", cxxopts::value<float>()->default_value("0.3"));
+
+        auto result = options.parse(argc, argv);
+
+        std::vector<std::string> deviceNames;
+        if (result.count("device"))
+        {
+            deviceNames = result["device"].as<std::vector<std::string>>();
+
+            for (const auto& deviceName : deviceNames)
+            {
+                info("MAIN", "User requested device '%s'", deviceName.c_str());
+            }
+        }
+
+        std::vector<std::string> streamNames;
+        if (result.count("stream"))
+        {
+            streamNames = result["stream"].as<std::vector<std::string>>();
+        }
+
+        std::vector<Orientation> orientations;
+        if (result.count("orientation"))
+        {
+            for (const auto& name : result["orientation"].as<std::vector<std::string>>())
+            {
+                if (!parseOrientation(name, orientations.emplace_back()))
+                {
+                    return -1;
+                }
+            }
+        }
+
+        if (!setStopHandler())
+        {
+            error("MAIN", "Couldn't set CTRL handler");
+            return -1;
+        }
+
+        std::unique_ptr<CaptureVideoInput> captureInput;
+        std::vector<std::shared_ptr<IDevice>> inputDevices;
+
+        if (result.count("file"))
+        {
+            // Replay files instead of capturing
+            FileVideoInput::Options fileOptions;
+            if (!parseFileOptions(result, fileOptions))
+            {
+                return -1;
+            }
+
+            for (const auto& path : result["file"].as<std::vector<std::string>>())
+            {
+                inputDevices.push_back(FileVideoInput().instantiateDevice(path, fileOptions));
+            }
+        }
+
+        if (result.count("test-pattern"))
+        {
+            // The test pattern shares the format options with raw files, but defaults to 1080p
+            FileVideoInput::Options fileOptions;
+            fileOptions.width = 1920;
+            fileOptions.height = 1080;
+            if (!parseFileOptions(result, fileOptions))
+            {
+                return -1;
+            }
+
+            TestPatternVideoInput::Options patternOptions;
+            patternOptions.videoFormat = fileOptions.videoFormat;
+            patternOptions.width = fileOptions.width;
+            patternOptions.height = fileOptions.height;
+            patternOptions.fps = fileOptions.fps;
+            patternOptions.realTime = fileOptions.realTime;
+
+            inputDevices.push_back(TestPatternVideoInput().instantiateDevice(patternOptions));
+        }
+
+        if (!deviceNames.empty() || inputDevices.empty())
+        {
+            // Setup media foundation or V4L2 input and enumerate devices
+            captureInput = std::make_unique<CaptureVideoInput>();
+            auto availableDevices = captureInput->enumerateDevices();
+
+            if (availableDevices.empty())
+            {
+                error("MAIN", "No input devices!");
+                return -1;
+            }
+
+            info("MAIN", "Found %d input devices.", availableDevices.size());
+            for (const auto& availableDevice : availableDevices)
+            {
+                info("MAIN", "Input device '%s'.", availableDevice.c_str());
+            }
+
+            // Try to instantiate the devices the user requested or the first one in the list
+            if (deviceNames.empty())
+            {
+                deviceNames.push_back(availableDevices[0]);
+            }
+
+            // Capture devices support several modes, pick the cheapest one to encode
+            VideoModeCache videoModeCache(result["mode-cache"].as<std::string>());
+
+            VideoModeConstraints videoModeConstraints;
+            if (!parseVideoModeConstraints(result, videoModeConstraints))
+            {
+                return -1;
+            }
+
+            for (const auto& deviceName : deviceNames)
+            {
+                auto device = captureInput->instantiateDevice(deviceName);
+
+                if (device && !SelectVideoMode(*device, &videoModeCache, videoModeConstraints))
+                {
+                    error("MAIN", "Input device '%s' has no usable video mode. Aborting.", deviceName.c_str());
+                    return -1;
+                }
+
+                inputDevices.push_back(device);
+            }
+        }
+
+        for (const auto& inputDevice : inputDevices)
+        {
+            if (!inputDevice)
+            {
+                error("MAIN", "Didn't get requested input device. Aborting.");
+                return -1;
+            }
+
+            if (!inputDevice->prepareStreaming())
+            {
+                error("MAIN", "Input device '%s' failed stream preparation. Aborting.", inputDevice->getName().c_str());
+                return -1;
+            }
+        }
+
+        const uint32_t cpuConversionThreads = result["cpu-conversion-threads"].as<uint32_t>();
+
+        DeinterlaceOptions deinterlaceOptions;
+        if (!parseDeinterlace(result["deinterlace"].as<std::string>(), deinterlaceOptions))
+        {
+            return -1;
+        }
+
+        // Decoding wraps MJPEG devices first, so that the deinterlacing and everything after it get NV12 frames
+        MJPEGDecodedDevice::Options mjpegOptions;
+        mjpegOptions.threadCount = std::max(result["mjpeg-threads"].as<uint32_t>(), 1u);
+
+        for (auto& inputDevice : inputDevices)
+        {
+            if (inputDevice->getVideoFormat() == IDevice::VideoFormat::MJPEG)
+            {
+                info("MAIN", "Decoding MJPEG input '%s' on %d threads.", inputDevice->getName().c_str(), int(mjpegOptions.threadCount));
+                inputDevice = std::make_shared<MJPEGDecodedDevice>(inputDevice, mjpegOptions);
+            }
+        }
+
+        // Deinterlacing wraps the device, so that everything downstream only sees progressive frames
+        for (auto& inputDevice : inputDevices)
+        {
+            const IDevice::FieldOrder fieldOrder = inputDevice->getFieldOrder();
+
+            if (!deinterlaceOptions.enabled || (fieldOrder == IDevice::FieldOrder::Progressive && !deinterlaceOptions.force))
+            {
+                continue;
+            }
+
+            Deinterlacer::Options deinterlacerOptions;
+            deinterlacerOptions.mode = deinterlaceOptions.mode;
+            deinterlacerOptions.fieldOrder = fieldOrder;
+            deinterlacerOptions.threadCount = std::max(cpuConversionThreads, 2u);
+
+            info("MAIN", "Deinterlacing input '%s'.", inputDevice->getName().c_str());
+            inputDevice = std::make_shared<DeinterlacedDevice>(inputDevice, deinterlacerOptions);
+        }
+
+        // One signaling web server is shared by all streams
+        auto webrtcServer = std::make_unique<WebRTCServer>();
+        if (!webrtcServer->init())
+        {
+            error("MAIN", "WebRTCServer init failed. Aborting.");
+            return -1;
+        }
+
+        std::vector<uint32_t> layerHeights;
+        if (result.count("layers"))
+        {
+            layerHeights = result["layers"].as<std::vector<uint32_t>>();
+        }
+
+        // Every input gets its own encoder and pipeline threads, with simulcast every layer does.
+        // The stages are declared last, so that they end the layer streams before the pipelines are destroyed on errors.
+        std::vector<StreamPipeline> streamPipelines;
+        std::vector<std::unique_ptr<SimulcastStage>> simulcastStages;
+
+        for (size_t i = 0; i < inputDevices.size(); ++i)
+        {
+            const std::string inputStreamName = i < streamNames.size() ? streamNames[i] : inputDevices[i]->getName();
+            const Orientation orientation = i < orientations.size() ? orientations[i] : Orientation{};
+
+            std::vector<std::shared_ptr<IDevice>> devices = {inputDevices[i]};
+            std::vector<std::string> deviceStreamNames = {inputStreamName};
+
+            if (!layerHeights.empty())
+            {
+                // The stage converts to NV12 and applies the orientation once for all layers
+                SimulcastStage::Options simulcastOptions;
+                simulcastOptions.layerHeights = layerHeights;
+                simulcastOptions.threadCount = std::max(cpuConversionThreads, 2u);
+                simulcastOptions.orientation = orientation;
+
+                auto simulcastStage = std::make_unique<SimulcastStage>();
+                if (!simulcastStage->init(inputDevices[i], simulcastOptions))
+                {
+                    error("MAIN", "Simulcast init failed for '%s'. Aborting.", inputDevices[i]->getName().c_str());
+                    return -1;
+                }
+
+                devices = simulcastStage->getLayerDevices();
+
+                for (size_t layer = 1; layer < devices.size(); ++layer)
+                {
+                    uint32_t layerWidth = 0, layerHeight = 0;
+                    devices[layer]->getFrameSize(layerWidth, layerHeight);
+
+                    deviceStreamNames.push_back(inputStreamName + "-" + std::to_string(layerHeight) + "p");
+                }
+
+                simulcastStages.push_back(std::move(simulcastStage));
+            }
+
+            for (size_t j = 0; j < devices.size(); ++j)
+            {
+                StreamPipeline streamPipeline;
+                streamPipeline.device = devices[j];
+
+                uint32_t inputWidth = 0, inputHeight = 0;
+                streamPipeline.device->getFrameSize(inputWidth, inputHeight);
+
+                IVideoEncoder::Options encoderOptions;
+                encoderOptions.cpuConversionThreads = cpuConversionThreads;
+                encoderOptions.orientation = layerHeights.empty() ? orientation : Orientation{};
+                encoderOptions.skipRepeatedFrames = result.count("skip-repeated-frames") > 0;
+                encoderOptions.overlay = result.count("overlay") > 0;
+                encoderOptions.latency = std::make_shared<StreamLatency>();
+                encoderOptions.synthetic.bitrate = result["null-bitrate"].as<uint32_t>() * 1000;
+                encoderOptions.synthetic.gopLength = result["null-gop"].as<uint32_t>();
+                encoderOptions.synthetic.keyframeFactor = result["null-keyframe-factor"].as<float>();
+                encoderOptions.synthetic.sizeVariation = result["null-size-variation"].as<float>();
+
+                streamPipeline.encoder = CreateVideoEncoder(result["encoder"].as<std::string>(), inputWidth, inputHeight, streamPipeline.device->getVideoFormat(),
+                                                            streamPipeline.device->getFrameRate(), encoderOptions);
+                if (!streamPipeline.encoder)
+                {
+                    error("MAIN", "Encoder init failed for '%s'. Aborting.", streamPipeline.device->getName().c_str());
+                    return -1;
+                }
+
+                const std::string& streamName = deviceStreamNames[j];
+
+                streamPipeline.stream = webrtcServer->addStream(streamName);
+                if (!streamPipeline.stream)
+                {
+                    error("MAIN", "Couldn't add stream '%s'. Aborting.", streamName.c_str());
+                    return -1;
+                }
+
+                // Regions of interest and the overlay requested by the viewers are applied by the encoder
+                streamPipeline.stream->setControl(streamPipeline.encoder.get());
+
+                info("MAIN", "Starting stream '%s'.", streamName.c_str());
+
+                FramePipeline::Options pipelineOptions;
+                pipelineOptions.latency = encoderOptions.latency;
+
+                streamPipeline.pipeline = std::make_unique<FramePipeline>();
+                if (!streamPipeline.pipeline->start(streamPipeline.device, streamPipeline.encoder.get(), streamPipeline.stream, pipelineOptions))
+                {
+                    error("MAIN", "Pipeline start failed. Aborting.");
+                    return -1;
+                }
+
+                streamPipelines.push_back(std::move(streamPipeline));
+            }
+        }
+
+        // The layer pipelines are waiting for frames now
+        for (auto& simulcastStage : simulcastStages)
+        {
+            simulcastStage->start();
+        }
+
+        // Report the pipeline statistics every now and then, so that dropped frames are visible without a trace
+        auto lastStatisticsTime = std::chrono::steady_clock::now();
+
+        while (run)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+            if (std::chrono::steady_clock::now() - lastStatisticsTime > std::chrono::seconds(30))
+            {
+                for (const auto& streamPipeline : streamPipelines)
+                {
+                    info("MAIN", "Statistics for stream '%s':", streamPipeline.stream->getName().c_str());
+                    streamPipeline.pipeline->logStatistics();
+                    streamPipeline.encoder->logStatistics();
+                }
+
+                lastStatisticsTime = std::chrono::steady_clock::now();
+            }
+        }
+
+        info("MAIN", "Shutting down");
+
+        // Stopping a stage ends the streams of its layer devices, which lets their pipelines stop
+        for (auto& simulcastStage : simulcastStages)
+        {
+            simulcastStage->stop();
+        }
+
+        for (auto& streamPipeline : streamPipelines)
+        {
+            streamPipeline.pipeline->stop();
+            streamPipeline.pipeline = nullptr;
+        }
+
+        webrtcServer->shutdown();
+        webrtcServer = nullptr;
+
+        for (auto& streamPipeline : streamPipelines)
+        {
+            streamPipeline.encoder->shutdown();
+            streamPipeline.encoder = nullptr;
+        }
+    }
+
+#ifdef _WIN32
+    _CrtDumpMemoryLeaks();
+#endif
+
+    return 0;
+}
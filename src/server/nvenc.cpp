@@ -2,23 +2,47 @@
 #include "nvenc.h"
 #include "NvEncoder/NvEncoderD3D11.h"
 #include "NvEncoder/RGBToNV12ConverterD3D11.h"
+#include "conversion/bgra.h"
+#include "conversion/nv12.h"
+#include "conversion/scaler.h"
+#include "conversion/text_overlay.h"
+#include "pipeline/repeated_frame_filter.h"
 #include "streaming/streaming.h"
 #include "trace_logging.h"
+#include "video_input/frame.h"
 
 #include <codecvt>
 #include <d3d11.h>
 
 using NvEncPackets = std::vector<std::vector<std::byte>>;
 
+namespace
+{
+// Input buffers beyond the one being encoded: one is uploaded while the previous frame is encoded and one waits for the
+// completion thread, so that a late retrieval doesn't stall the upload
+constexpr uint32_t ExtraInputFrames = 2;
+} // namespace
+
 NVEnc::NVEnc() = default;
-NVEnc::~NVEnc() = default;
 
-bool NVEnc::init(uint32_t width, uint32_t height, IDevice::VideoFormat videoFormat, Ratio fps)
+NVEnc::~NVEnc()
+{
+    stopCompletionThread();
+}
+
+bool NVEnc::init(uint32_t width, uint32_t height, IDevice::VideoFormat videoFormat, Ratio fps, const Options& options)
 {
     m_width = width;
     m_height = height;
     m_videoFormat = videoFormat;
     m_fps = fps;
+    m_orientation = options.orientation;
+    m_encodeWidth = width;
+    m_encodeHeight = height;
+    m_cpuConversionThreads = options.cpuConversionThreads;
+    m_framePool = FramePool::create();
+    m_overlayEnabled = options.overlay;
+    m_latency = options.latency ? options.latency : std::make_shared<StreamLatency>();
 
     if (width == 0 || height == 0 || videoFormat == IDevice::VideoFormat::Unknown || fps.numerator == 0)
     {
@@ -26,6 +50,21 @@ bool NVEnc::init(uint32_t width, uint32_t height, IDevice::VideoFormat videoForm
         return false;
     }
 
+    if (options.skipRepeatedFrames)
+    {
+        m_repeatedFrameFilter = std::make_unique<RepeatedFrameFilter>(RepeatedFrameFilter::Options());
+    }
+
+    m_overlay = std::make_unique<TextOverlay>(TextOverlay::Options());
+
+    // YUV formats are always repacked on the CPU, for RGB it replaces the conversion on the GPU if threads are given.
+    // The converter is set up for the format here, so that uploading a frame doesn't branch on it.
+    // 10 bit formats are narrowed in the same pass, the stream stays 8 bit H.264 since browsers don't decode High 10.
+    if (IsYUVFormat(videoFormat) || options.cpuConversionThreads > 0)
+    {
+        m_nv12Converter = std::make_unique<NV12Converter>(videoFormat, options.cpuConversionThreads);
+    }
+
     // Create DXGI factory
     {
         ComPtr<IDXGIFactory> factory;
@@ -110,7 +149,7 @@ bool NVEnc::init(uint32_t width, uint32_t height, IDevice::VideoFormat videoForm
         desc.Height = m_height;
         desc.MipLevels = 1;
         desc.ArraySize = 1;
-        desc.Format = videoFormat == IDevice::VideoFormat::NV12 ? DXGI_FORMAT_NV12 : DXGI_FORMAT_B8G8R8A8_UNORM;
+        desc.Format = uploadsNV12() ? DXGI_FORMAT_NV12 : DXGI_FORMAT_B8G8R8A8_UNORM;
         desc.SampleDesc.Count = 1;
         desc.Usage = D3D11_USAGE_STAGING;
         desc.BindFlags = 0;
@@ -122,11 +161,12 @@ bool NVEnc::init(uint32_t width, uint32_t height, IDevice::VideoFormat videoForm
         }
     }
 
-    // Initialize NVEnc itself
+    // Initialize NVEnc itself, this is where machines without an NVIDIA GPU or driver fail
+    try
     {
         NV_ENC_BUFFER_FORMAT nvencFormat = NV_ENC_BUFFER_FORMAT_NV12;
 
-        m_nvencInstance = std::make_unique<NvEncoderD3D11>(m_device.Get(), m_width, m_height, nvencFormat, 0);
+        m_nvencInstance = std::make_unique<NvEncoderD3D11>(m_device.Get(), m_width, m_height, nvencFormat, ExtraInputFrames);
 
         GUID codec = NV_ENC_CODEC_H264_GUID;
         GUID preset = NV_ENC_PRESET_P3_GUID;
@@ -145,19 +185,29 @@ bool NVEnc::init(uint32_t width, uint32_t height, IDevice::VideoFormat videoForm
 
         m_nvencInstance->CreateEncoder(&initializeParams);
 
-        if (m_videoFormat != IDevice::VideoFormat::NV12)
+        if (!uploadsNV12())
         {
             m_rgbToNV12Converter = std::make_unique<RGBToNV12ConverterD3D11>(m_device.Get(), m_deviceContext.Get(), m_width, m_height);
         }
 
         m_nvencInstance->GetSequenceParams(m_sequenceParameters);
     }
+    catch (const NVENCException& exception)
+    {
+        error("NVENC", "Couldn't create the encoder: %s", exception.what());
+        return false;
+    }
+
+    m_inFlightFrames.resize(m_nvencInstance->GetEncoderBufferCount());
+    m_completionThread = std::thread(&NVEnc::completionThread, this);
 
     return true;
 }
 
 void NVEnc::shutdown()
 {
+    stopCompletionThread();
+
     if (m_nvencInstance)
     {
         NvEncPackets packets;
@@ -177,6 +227,8 @@ void NVEnc::shutdown()
     m_uploadTexture = nullptr;
 
     m_rgbToNV12Converter = nullptr;
+    m_nv12Converter = nullptr;
+    m_zoomScaler = nullptr;
 
     if (m_deviceContext)
     {
@@ -188,14 +240,212 @@ void NVEnc::shutdown()
     m_device = nullptr;
 }
 
-void NVEnc::onSample(std::chrono::nanoseconds timeStamp, const void* data, uint32_t dataSize, uint64_t frameId, IVideoStreamSampleConsumer* sampleConsumer)
+bool NVEnc::uploadsNV12() const
 {
-    // Get the next input frame,
-    // map the D3D texture which is the input and upload the data we got passed in
-    const NvEncInputFrame* encoderInputFrame = m_nvencInstance->GetNextInputFrame();
+    return m_nv12Converter != nullptr;
+}
+
+void NVEnc::logStatistics() const
+{
+    if (m_repeatedFrameFilter)
+    {
+        m_repeatedFrameFilter->logStatistics();
+    }
+}
+
+bool NVEnc::setRegionOfInterest(const RegionOfInterest& regionOfInterest)
+{
+    RegionOfInterest aligned;
+    if (!AlignRegionOfInterest(regionOfInterest, m_width, m_height, aligned))
+    {
+        return false;
+    }
+
+    // Zooming scales on the CPU, which needs the NV12 upload texture
+    if (aligned.zoom && !aligned.rect.isEmpty() && !uploadsNV12())
+    {
+        warning("NVENC", "Zooming into RGB input needs the CPU conversion, see --cpu-conversion-threads.");
+        return false;
+    }
+
+    info("NVENC", "Region of interest: %d, %d, %d x %d%s", aligned.rect.x, aligned.rect.y, aligned.rect.width, aligned.rect.height, aligned.zoom ? ", zoomed" : "");
+
+    std::lock_guard _(m_regionOfInterestMutex);
+    m_regionOfInterest = aligned;
+
+    return true;
+}
+
+bool NVEnc::setOverlay(bool enabled)
+{
+    info("NVENC", "Overlay %s.", enabled ? "on" : "off");
+
+    m_overlayEnabled = enabled;
+    return true;
+}
+
+void NVEnc::requestKeyFrame()
+{
+    m_keyFrameRequested = true;
+}
+
+const TextOverlay* NVEnc::updateOverlay(const Frame& frame)
+{
+    if (!m_overlayEnabled)
+    {
+        return nullptr;
+    }
+
+    SetOverlayText(*m_overlay, frame, *m_latency);
+    return m_overlay.get();
+}
+
+bool NVEnc::reconfigure(uint32_t width, uint32_t height)
+{
+    // The frames of the old size are finished first, resetting the encoder would drop them
+    waitForInFlightFrames();
+
+    NV_ENC_CONFIG encodeConfig = {NV_ENC_CONFIG_VER};
+    NV_ENC_RECONFIGURE_PARAMS reconfigureParams = {NV_ENC_RECONFIGURE_PARAMS_VER};
+    reconfigureParams.reInitEncodeParams.encodeConfig = &encodeConfig;
+
+    try
+    {
+        m_nvencInstance->GetInitializeParams(&reconfigureParams.reInitEncodeParams);
+
+        reconfigureParams.reInitEncodeParams.encodeWidth = width;
+        reconfigureParams.reInitEncodeParams.encodeHeight = height;
+        reconfigureParams.reInitEncodeParams.darWidth = width;
+        reconfigureParams.reInitEncodeParams.darHeight = height;
+
+        // The next frame is an IDR frame with the new sequence parameters, which lets the viewers' decoders switch over
+        reconfigureParams.resetEncoder = 1;
+        reconfigureParams.forceIDR = 1;
+
+        m_nvencInstance->Reconfigure(&reconfigureParams);
+        m_nvencInstance->GetSequenceParams(m_sequenceParameters);
+    }
+    catch (const NVENCException& exception)
+    {
+        error("NVENC", "Couldn't change the encoded frame size to %d x %d: %s", width, height, exception.what());
+        return false;
+    }
+
+    info("NVENC", "Encoding %d x %d.", width, height);
+
+    m_encodeWidth = width;
+    m_encodeHeight = height;
+
+    // Viewers which connect from now on need to start with a frame of the new size
+    m_startsSequence = true;
+
+    return true;
+}
+
+bool NVEnc::zoom(const Frame& region, std::byte* dstY, std::byte* dstUV, size_t dstPitch, const TextOverlay* overlay)
+{
+    const Frame* source = &region;
+    FrameRef converted;
+
+    // The scaler reads NV12 in the right orientation straight from the capture buffer, everything else takes one more pass
+    if (region.videoFormat != IDevice::VideoFormat::NV12 || m_orientation != Orientation{})
+    {
+        const size_t lumaSize = size_t(region.width) * region.height;
+        m_zoomBuffer.resize(lumaSize * 3 / 2);
+
+        converted = m_framePool->acquire();
+        converted->videoFormat = IDevice::VideoFormat::NV12;
+        converted->width = region.width;
+        converted->height = region.height;
+        converted->setPackedData(m_zoomBuffer.data(), m_zoomBuffer.size());
+
+        std::byte* y = m_zoomBuffer.data();
+        std::byte* uv = y + lumaSize;
+
+        if (!m_nv12Converter->convert(region, y, region.width, uv, region.width, m_orientation))
+        {
+            return false;
+        }
+
+        source = converted.get();
+    }
+
+    const NV12Scaler::Size regionSize = {region.width, region.height};
+
+    if (!m_zoomScaler || m_zoomScaler->getSourceSize() != regionSize)
+    {
+        m_zoomScaler = std::make_unique<NV12Scaler>(regionSize, std::vector<NV12Scaler::Size>{{m_width, m_height}}, std::max(m_cpuConversionThreads, 1u));
+    }
+
+    const NV12Planes destination = {dstY, dstPitch, dstUV, dstPitch};
+    if (!m_zoomScaler->scale(*source, {&destination, 1}))
+    {
+        return false;
+    }
+
+    // Drawn on top of the scaled picture so that the text stays sharp, this only touches the overlay's own rows
+    if (overlay)
+    {
+        overlay->drawNV12(dstY, dstPitch, dstUV, dstPitch, m_width, 0, m_height);
+    }
+
+    return true;
+}
+
+void NVEnc::onSample(const FrameRef& frame, IVideoStreamSampleConsumer* sampleConsumer)
+{
+    const uint64_t frameId = frame->frameId;
+
+    RegionOfInterest regionOfInterest;
+    {
+        std::lock_guard _(m_regionOfInterestMutex);
+        regionOfInterest = m_regionOfInterest;
+    }
+
+    // Cropping moves the start of the planes of a view of the frame, the pixels are only read once by the conversion below
+    FrameRef source = frame;
+    if (!regionOfInterest.rect.isEmpty())
+    {
+        source = m_framePool->acquireView(frame);
+
+        if (!source->crop(regionOfInterest.rect))
+        {
+            error("NVENC", "Couldn't crop the %d x %d frame to the region of interest.", frame->width, frame->height);
+            return;
+        }
+    }
+
+    const bool zoomed = regionOfInterest.zoom && !regionOfInterest.rect.isEmpty();
+    const uint32_t encodeWidth = zoomed ? m_width : source->width;
+    const uint32_t encodeHeight = zoomed ? m_height : source->height;
+
+    // A repeat isn't uploaded at all, the viewers keep showing the previous frame. The zoom changes what is made of the same pixels.
+    // New viewers don't have that frame, so a requested key frame is encoded in any case.
+    if (m_repeatedFrameFilter && !m_keyFrameRequested && m_repeatedFrameFilter->isRepeat(*source, zoomed ? 1 : 0))
+    {
+        Trace::Encode_FrameSkipped(frameId);
+        return;
+    }
+
+    const auto encodeStartTime = std::chrono::steady_clock::now();
 
+    if ((encodeWidth != m_encodeWidth || encodeHeight != m_encodeHeight) && !reconfigure(encodeWidth, encodeHeight))
+    {
+        return;
+    }
+
+    // Every input buffer is still being encoded or waits for the completion thread, which only happens while the GPU falls behind
     Trace::Encode_WaitForNextInputFrame(frameId);
 
+    const uint64_t submitted = m_submittedCount.load(std::memory_order_relaxed);
+    for (uint64_t completed = m_completedCount.load(std::memory_order_acquire); submitted - completed >= m_inFlightFrames.size();
+         completed = m_completedCount.load(std::memory_order_acquire))
+    {
+        m_completedCount.wait(completed, std::memory_order_acquire);
+    }
+
+    // Map the D3D texture which is the input and upload the data we got passed in
+    const NvEncInputFrame* encoderInputFrame = m_nvencInstance->GetNextInputFrame();
     ID3D11Texture2D* encoderInputTexture = static_cast<ID3D11Texture2D*>(encoderInputFrame->inputPtr);
 
     Trace::Encode_NextInputFrameAvailable(frameId);
@@ -209,49 +459,41 @@ void NVEnc::onSample(std::chrono::nanoseconds timeStamp, const void* data, uint3
 
     Trace::Encode_UploadTextureMapped(frameId);
 
-    if (m_videoFormat == IDevice::VideoFormat::NV12)
+    // The frame's rows and the texture rows can both be padded, so everything is copied with the respective pitch
+    std::byte* dstY = static_cast<std::byte*>(map.pData);
+
+    // The chroma plane of the NV12 upload texture directly follows the luma rows
+    std::byte* dstUV = dstY + map.RowPitch * m_height;
+
+    const TextOverlay* overlay = updateOverlay(*frame);
+
+    // A frame smaller than the texture fills its top left corner, which is all the encoder reads at that size
+    bool converted = false;
+    if (zoomed)
     {
-        std::memcpy(map.pData, data, dataSize);
+        converted = zoom(*source, dstY, dstUV, map.RowPitch, overlay);
     }
-    else if (m_videoFormat == IDevice::VideoFormat::BGRA)
+    else if (m_nv12Converter)
     {
-        if (map.RowPitch == 4 * m_width)
-        {
-            std::memcpy(map.pData, data, dataSize);
-        }
-        else
-        {
-            for (uint32_t y = 0; y < m_height; ++y)
-            {
-                std::memcpy(static_cast<std::byte*>(map.pData) + y * map.RowPitch, static_cast<const std::byte*>(data) + y * m_width * 4, m_width * 4);
-            }
-        }
-    }
-    else if (m_videoFormat == IDevice::VideoFormat::RGB24)
-    {
-        for (uint32_t y = 0; y < m_height; ++y)
-        {
-            for (uint32_t x = 0; x < m_width; ++x)
-            {
-                (static_cast<std::byte*>(map.pData) + y * map.RowPitch)[x * 4 + 0] = (static_cast<const std::byte*>(data) + y * m_width * 3)[x * 3 + 0];
-                (static_cast<std::byte*>(map.pData) + y * map.RowPitch)[x * 4 + 1] = (static_cast<const std::byte*>(data) + y * m_width * 3)[x * 3 + 1];
-                (static_cast<std::byte*>(map.pData) + y * map.RowPitch)[x * 4 + 2] = (static_cast<const std::byte*>(data) + y * m_width * 3)[x * 3 + 2];
-            }
-        }
+        converted = m_nv12Converter->convert(*source, dstY, map.RowPitch, dstUV, map.RowPitch, m_orientation, overlay);
     }
     else
     {
-        error("D3D", "Unhandled video format!");
-        return;
+        converted = ConvertToBGRA(*source, dstY, map.RowPitch, m_orientation, overlay);
     }
 
     m_deviceContext->Unmap(m_uploadTexture.Get(), D3D11CalcSubresource(0, 0, 1));
 
+    if (!converted)
+    {
+        return;
+    }
+
     Trace::Encode_UploadTextureUnmapped(frameId);
 
     // Trigger a conversion to NV12 if we have a BGRA texture so that the encoder
     // can use the NV12 data
-    if (m_videoFormat == IDevice::VideoFormat::NV12)
+    if (uploadsNV12())
     {
         m_deviceContext->CopyResource(encoderInputTexture, m_uploadTexture.Get());
     }
@@ -262,35 +504,148 @@ void NVEnc::onSample(std::chrono::nanoseconds timeStamp, const void* data, uint3
 
     Trace::Encode_InputFrameTextureUpdated(frameId);
 
-    NvEncPackets packets;
+    // The slot belongs to this thread until the frame is counted as submitted
+    InFlightFrame& inFlight = m_inFlightFrames[submitted % m_inFlightFrames.size()];
+    inFlight.frameId = frameId;
+    inFlight.timeStamp = frame->timeStamp;
+    inFlight.encodeStartTime = encodeStartTime;
+    inFlight.sampleConsumer = sampleConsumer;
 
-    NV_ENC_PIC_PARAMS picParams = {NV_ENC_PIC_PARAMS_VER};
-    // picParams.encodePicFlags = NV_ENC_PIC_FLAG_FORCEINTRA;
+    // Every request which arrived until now is served by this frame
+    const bool keyFrameRequested = m_keyFrameRequested.exchange(false);
+    inFlight.idr = m_startsSequence || keyFrameRequested;
 
-    m_nvencInstance->EncodeFrame(packets, &picParams /* TODO: Force I-Frame only when a new connection came in etc. */);
+    // The whole upload texture is copied to the GPU, whatever part of it the frame covers
+    inFlight.uploadBytes = size_t(map.RowPitch) * (uploadsNV12() ? m_height * 3 / 2 : m_height);
 
-    Trace::Encode_EncodeFrameFinished(frameId, packets.size() > 0 ? packets[0].size() : 0);
+    NV_ENC_PIC_PARAMS picParams = {NV_ENC_PIC_PARAMS_VER};
+    if (keyFrameRequested)
+    {
+        picParams.encodePicFlags = NV_ENC_PIC_FLAG_FORCEIDR | NV_ENC_PIC_FLAG_OUTPUT_SPSPPS;
+    }
 
-    // info("NVENC", "Encoded frame: %d packets, packet 0 size: %d", packets.size(), packets.size() > 0 ? packets[0].size() : 0);
+    inFlight.submitTime = std::chrono::steady_clock::now();
 
-    // TODO: Handle multi-packet frames (if they ever crop up)
-    if (packets.size() == 1)
+    try
     {
-        if (m_firstFrame.empty())
+        m_nvencInstance->SubmitFrame(&picParams);
+    }
+    catch (const NVENCException& exception)
+    {
+        error("NVENC", "Failed to submit frame %llu: %s", (unsigned long long)frameId, exception.what());
+
+        // The viewers still wait for it
+        if (keyFrameRequested)
         {
-            m_firstFrame.resize(packets[0].size());
-            std::memcpy(m_firstFrame.data(), packets[0].data(), packets[0].size());
+            m_keyFrameRequested = true;
         }
 
-        sampleConsumer->onEncodedSampleAvailable(timeStamp, packets[0], frameId, m_firstFrame);
+        return;
     }
 
-    /*
-    static FILE* fp = fopen("E:\\raw.h264", "wb");
+    m_startsSequence = false;
+
+    Trace::Encode_FrameSubmitted(frameId, uint32_t(submitted + 1 - m_completedCount.load(std::memory_order_relaxed)));
+
+    m_submittedCount.store(submitted + 1, std::memory_order_release);
 
-    if (packets.size() > 0)
+    m_submitSignal.fetch_add(1, std::memory_order_release);
+    m_submitSignal.notify_one();
+}
+
+void NVEnc::flush()
+{
+    waitForInFlightFrames();
+}
+
+void NVEnc::waitForInFlightFrames()
+{
+    const uint64_t submitted = m_submittedCount.load(std::memory_order_relaxed);
+    for (uint64_t completed = m_completedCount.load(std::memory_order_acquire); completed != submitted; completed = m_completedCount.load(std::memory_order_acquire))
     {
-        fwrite(packets[0].data(), sizeof(std::byte), packets[0].size(), fp);
-        fflush(fp);
-    }*/
+        m_completedCount.wait(completed, std::memory_order_acquire);
+    }
+}
+
+void NVEnc::stopCompletionThread()
+{
+    if (!m_completionThread.joinable())
+    {
+        return;
+    }
+
+    waitForInFlightFrames();
+
+    m_stopCompletion = true;
+    m_submitSignal.fetch_add(1, std::memory_order_release);
+    m_submitSignal.notify_one();
+
+    m_completionThread.join();
+    m_stopCompletion = false;
+}
+
+void NVEnc::completionThread()
+{
+    while (true)
+    {
+        const uint32_t signal = m_submitSignal.load(std::memory_order_acquire);
+        const uint64_t completed = m_completedCount.load(std::memory_order_relaxed);
+
+        if (m_submittedCount.load(std::memory_order_acquire) == completed)
+        {
+            if (m_stopCompletion)
+            {
+                return;
+            }
+
+            m_submitSignal.wait(signal, std::memory_order_acquire);
+            continue;
+        }
+
+        const InFlightFrame& inFlight = m_inFlightFrames[completed % m_inFlightFrames.size()];
+
+        // Waits for the hardware, meanwhile the next frame is uploaded
+        try
+        {
+            m_nvencInstance->GetNextEncodedPacket(m_packet);
+        }
+        catch (const NVENCException& exception)
+        {
+            error("NVENC", "Failed to retrieve frame %llu: %s", (unsigned long long)inFlight.frameId, exception.what());
+            m_packet.clear();
+        }
+
+        const auto completeTime = std::chrono::steady_clock::now();
+
+        Trace::Encode_FrameCompleted(inFlight.frameId, completeTime - inFlight.submitTime);
+        Trace::Encode_EncodeFrameFinished(inFlight.frameId, m_packet.size());
+
+        // Includes the time the frame waited behind the previous one, which is part of the latency the viewers see
+        const auto encodeTime = std::chrono::duration_cast<std::chrono::nanoseconds>(completeTime - inFlight.encodeStartTime);
+        m_latency->encodeNs.store(encodeTime.count(), std::memory_order_relaxed);
+
+        if (m_repeatedFrameFilter)
+        {
+            m_repeatedFrameFilter->onFrameEncoded(inFlight.uploadBytes, m_packet.size(), encodeTime);
+        }
+
+        if (inFlight.idr)
+        {
+            m_firstFrame.clear();
+        }
+
+        if (!m_packet.empty())
+        {
+            if (m_firstFrame.empty())
+            {
+                m_firstFrame = m_packet;
+            }
+
+            inFlight.sampleConsumer->onEncodedSampleAvailable(inFlight.timeStamp, m_packet, inFlight.frameId, m_firstFrame);
+        }
+
+        // Hands the slot and its input buffer back to the submitting thread
+        m_completedCount.store(completed + 1, std::memory_order_release);
+        m_completedCount.notify_all();
+    }
 }
@@ -1,7 +1,7 @@
 
 #pragma once
 
-#include "video_input/device.h"
+#include "encoding/video_encoder.h"
 
 struct ID3D11Device5;
 struct ID3D11DeviceContext4;
@@ -11,21 +11,80 @@ struct IDXGIAdapter4;
 
 class NvEncoderD3D11;
 class RGBToNV12ConverterD3D11;
-
-class IVideoStreamSampleConsumer;
-
-class NVEnc : public IDeviceSampleHandler
+class NV12Converter;
+class NV12Scaler;
+class RepeatedFrameFilter;
+// Encodes on NVIDIA GPUs. Frames are uploaded through a D3D11 staging texture, RGB formats are converted to NV12 on the GPU
+// unless the CPU conversion is enabled. Fails to initialize on machines without NVENC.
+//
+// Encoding is pipelined: onSample() only uploads and submits a frame, a completion thread waits for the hardware and hands
+// the bitstreams to the consumers in order. So the upload of the next frame overlaps the encode of the previous one.
+class NVEnc : public IVideoEncoder
 {
   public:
     NVEnc();
     ~NVEnc();
 
-    bool init(uint32_t width, uint32_t height, IDevice::VideoFormat videoFormat, Ratio fps);
-    void shutdown();
+    virtual bool init(uint32_t width, uint32_t height, IDevice::VideoFormat videoFormat, Ratio fps, const Options& options) override;
+    virtual void shutdown() override;
+
+    virtual const char* getName() const override
+    {
+        return "nvenc";
+    }
+
+    virtual void onSample(const FrameRef& frame, IVideoStreamSampleConsumer* sampleConsumer) override;
+
+    // Waits until the frames which are still being encoded were delivered
+    virtual void flush() override;
+
+    // Reports how many repeated frames were skipped, if that is enabled
+    virtual void logStatistics() const override;
+
+    // Takes effect with the next frame. A region which is streamed at its own size reconfigures the encoder,
+    // the viewers stay connected and continue with an IDR frame of the new size.
+    virtual bool setRegionOfInterest(const RegionOfInterest& regionOfInterest) override;
 
-    virtual void onSample(std::chrono::nanoseconds timeStamp, const void* data, uint32_t dataSize, uint64_t frameId, IVideoStreamSampleConsumer* sampleConsumer) override;
+    // The overlay is drawn by the conversion into the upload texture, so it costs no pass over the frame of its own
+    virtual bool setOverlay(bool enabled) override;
+
+    // The next submitted frame is encoded as an IDR frame
+    virtual void requestKeyFrame() override;
 
   private:
+    // A frame between its submission and the delivery of its bitstream by the completion thread
+    struct InFlightFrame
+    {
+        uint64_t frameId = 0;
+        std::chrono::nanoseconds timeStamp = {};
+        std::chrono::steady_clock::time_point encodeStartTime;
+        std::chrono::steady_clock::time_point submitTime;
+        IVideoStreamSampleConsumer* sampleConsumer = nullptr;
+        size_t uploadBytes = 0;
+
+        // Forced by a size change or a key frame request, viewers which connect later start with the latest one
+        bool idr = false;
+    };
+
+    // Retrieves the bitstreams in the order the frames were submitted and hands them to the consumers
+    void completionThread();
+    void stopCompletionThread();
+
+    // Blocks until the completion thread delivered every submitted frame
+    void waitForInFlightFrames();
+
+    // YUV formats and CPU converted RGB are uploaded into an NV12 texture, everything else needs a conversion on the GPU
+    bool uploadsNV12() const;
+
+    // Changes the encoded frame size, which can't be larger than the size the encoder was created with
+    bool reconfigure(uint32_t width, uint32_t height);
+
+    // Scales a cropped frame up to the full frame size while writing it into the upload texture
+    bool zoom(const Frame& region, std::byte* dstY, std::byte* dstUV, size_t dstPitch, const TextOverlay* overlay);
+
+    // Lays out the overlay text for the frame, returns null while the overlay is off
+    const TextOverlay* updateOverlay(const Frame& frame);
+
     ComPtr<IDXGIFactory7> m_dxgiFactory;
     ComPtr<IDXGIAdapter4> m_dxgiAdapter;
 
@@ -35,14 +94,52 @@ class NVEnc : public IDeviceSampleHandler
 
     std::unique_ptr<NvEncoderD3D11> m_nvencInstance;
     std::unique_ptr<RGBToNV12ConverterD3D11> m_rgbToNV12Converter;
+    std::unique_ptr<NV12Converter> m_nv12Converter;
+    std::unique_ptr<NV12Scaler> m_zoomScaler;
+    std::unique_ptr<RepeatedFrameFilter> m_repeatedFrameFilter;
+    std::unique_ptr<TextOverlay> m_overlay;
+    std::vector<std::byte> m_zoomBuffer;
 
     std::vector<std::byte> m_sequenceParameters;
+
+    // Only touched by the completion thread
     std::vector<std::byte> m_firstFrame;
+    std::vector<std::byte> m_packet;
+
+    // One slot per input buffer of the encoder, the counters select the slots and tell how many frames are in flight.
+    // Only the submitting thread increases m_submittedCount and only the completion thread m_completedCount.
+    std::vector<InFlightFrame> m_inFlightFrames;
+    std::atomic<uint64_t> m_submittedCount = 0;
+    std::atomic<uint64_t> m_completedCount = 0;
+    std::atomic<uint32_t> m_submitSignal = 0;
+    std::atomic<bool> m_stopCompletion = false;
+    std::thread m_completionThread;
+
+    // Set by a size change for the next submitted frame
+    bool m_startsSequence = false;
+
+    std::atomic<bool> m_keyFrameRequested = false;
 
     uint32_t m_width = 0;
     uint32_t m_height = 0;
 
+    // Smaller than the frame size while a region of interest is streamed at its own size
+    uint32_t m_encodeWidth = 0;
+    uint32_t m_encodeHeight = 0;
+
+    uint32_t m_cpuConversionThreads = 0;
+
     IDevice::VideoFormat m_videoFormat = IDevice::VideoFormat::Unknown;
+    Orientation m_orientation;
+
+    std::mutex m_regionOfInterestMutex;
+    RegionOfInterest m_regionOfInterest;
+
+    std::atomic<bool> m_overlayEnabled = false;
+    std::shared_ptr<StreamLatency> m_latency;
+
+    // Views of the captured frames for cropping
+    std::shared_ptr<FramePool> m_framePool;
 
     Ratio m_fps;
 };
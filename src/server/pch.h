@@ -1,22 +1,34 @@
 
 #pragma once
 
+// The Windows SDK and D3D11, which media foundation capture and NVENC build on
+#ifdef _WIN32
+#define NOMINMAX
 #include <Windows.h>
 #include <d3d11.h>
 #include <d3d11_4.h>
 #include <dxgi1_6.h>
 #include <wrl/client.h>
 template <typename T> using ComPtr = Microsoft::WRL::ComPtr<T>;
+#endif
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
 #include <chrono>
+#include <cstdarg>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <span>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -31,4 +43,10 @@ struct Ratio
     {
         return numerator / static_cast<float>(denominator);
     }
+
+    // Compares the values, so 60/2 equals 30/1
+    bool operator==(const Ratio& other) const
+    {
+        return uint64_t(numerator) * other.denominator == uint64_t(other.numerator) * denominator;
+    }
 };
@@ -0,0 +1,86 @@
+#include "deinterlaced_device.h"
+#include "video_input/video_format.h"
+
+DeinterlacedDevice::DeinterlacedDevice(std::shared_ptr<IDevice> device, const Deinterlacer::Options& options)
+    : m_device(std::move(device)), m_deinterlacer(options), m_framePool(FramePool::create())
+{
+}
+
+DeinterlacedDevice::~DeinterlacedDevice() = default;
+
+std::string DeinterlacedDevice::getName() const
+{
+    return m_device->getName();
+}
+
+std::vector<IDevice::VideoMode> DeinterlacedDevice::enumerateVideoModes() const
+{
+    return m_device->enumerateVideoModes();
+}
+
+bool DeinterlacedDevice::setVideoMode(const VideoMode& mode)
+{
+    return m_device->setVideoMode(mode);
+}
+
+bool DeinterlacedDevice::prepareStreaming()
+{
+    return m_device->prepareStreaming();
+}
+
+void DeinterlacedDevice::stream(std::atomic<bool>& run, IDeviceSampleHandler* sampleHandler, IVideoStreamSampleConsumer* sampleConsumer)
+{
+    m_sampleHandler = sampleHandler;
+    m_device->stream(run, this, sampleConsumer);
+
+    m_previousFrame.reset();
+    m_sampleHandler = nullptr;
+}
+
+void DeinterlacedDevice::getFrameSize(uint32_t& width, uint32_t& height) const
+{
+    m_device->getFrameSize(width, height);
+}
+
+Ratio DeinterlacedDevice::getFrameRate() const
+{
+    return m_device->getFrameRate();
+}
+
+IDevice::VideoFormat DeinterlacedDevice::getVideoFormat() const
+{
+    return m_device->getVideoFormat();
+}
+
+void DeinterlacedDevice::onSample(const FrameRef& frame, IVideoStreamSampleConsumer* sampleConsumer)
+{
+    FrameRef progressive = acquireFrame(*frame);
+
+    if (progressive && m_deinterlacer.deinterlace(*frame, m_previousFrame.get(), *progressive))
+    {
+        m_sampleHandler->onSample(progressive, sampleConsumer);
+    }
+
+    m_previousFrame = frame;
+}
+
+FrameRef DeinterlacedDevice::acquireFrame(const Frame& source)
+{
+    FrameRef frame = m_framePool->acquire();
+
+    std::vector<std::byte>& buffer = m_buffers.acquire(*frame);
+    buffer.resize(GetVideoFormatInfo(source.videoFormat).getPackedSize(source.width, source.height));
+
+    frame->timeStamp = source.timeStamp;
+    frame->frameId = source.frameId;
+    frame->videoFormat = source.videoFormat;
+    frame->width = source.width;
+    frame->height = source.height;
+    if (!frame->setPackedData(buffer.data(), buffer.size()))
+    {
+        error("DEINTERLACE", "Can't lay out a %d x %d %s frame.", source.width, source.height, GetVideoFormatInfo(source.videoFormat).name);
+        return {};
+    }
+
+    return frame;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "conversion/deinterlace.h"
+#include "video_input/device.h"
+
+// Wraps a device which delivers interlaced frames and hands progressive frames to the sample handler instead, so that
+// the pipelines and the simulcast stage don't need to know about it. Deinterlacing runs on the capture thread
+// and the frames keep the format of the device.
+//
+// The previous captured frame is held for motion adaptive deinterlacing, so the device has one frame less in flight.
+class DeinterlacedDevice : public IDevice, private IDeviceSampleHandler
+{
+  public:
+    DeinterlacedDevice(std::shared_ptr<IDevice> device, const Deinterlacer::Options& options);
+    ~DeinterlacedDevice();
+
+    virtual std::string getName() const override;
+
+    virtual std::vector<VideoMode> enumerateVideoModes() const override;
+    virtual bool setVideoMode(const VideoMode& mode) override;
+    virtual bool prepareStreaming() override;
+
+    virtual void stream(std::atomic<bool>& run, IDeviceSampleHandler* sampleHandler, IVideoStreamSampleConsumer* sampleConsumer) override;
+
+    virtual void getFrameSize(uint32_t& width, uint32_t& height) const override;
+    virtual Ratio getFrameRate() const override;
+    virtual VideoFormat getVideoFormat() const override;
+
+  private:
+    virtual void onSample(const FrameRef& frame, IVideoStreamSampleConsumer* sampleConsumer) override;
+
+    // Returns a frame in the layout of the source backed by a free buffer, the buffer is handed back once the frame is released
+    FrameRef acquireFrame(const Frame& source);
+
+    std::shared_ptr<IDevice> m_device;
+    Deinterlacer m_deinterlacer;
+
+    BufferPool<std::vector<std::byte>> m_buffers;
+    std::shared_ptr<FramePool> m_framePool;
+
+    FrameRef m_previousFrame;
+
+    // Only set while streaming
+    IDeviceSampleHandler* m_sampleHandler = nullptr;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "video_input/frame.h"
+
+// Single slot handoff where the newest frame always wins.
+//
+// Posting a frame while the previous one hasn't been taken yet replaces (drops) the old frame, so the
+// consumer always continues with the most recent frame instead of working through a backlog.
+class FrameMailbox
+{
+  public:
+    FrameMailbox() = default;
+    FrameMailbox(const FrameMailbox&) = delete;
+    FrameMailbox& operator=(const FrameMailbox&) = delete;
+
+    ~FrameMailbox()
+    {
+        FrameRef::adopt(m_slot.exchange(nullptr, std::memory_order_acquire));
+    }
+
+    // Producer side: returns the frame id of the replaced frame if an unconsumed frame got dropped
+    std::optional<uint64_t> post(FrameRef frame)
+    {
+        m_posted.fetch_add(1, std::memory_order_relaxed);
+
+        FrameRef replaced = FrameRef::adopt(m_slot.exchange(frame.detach(), std::memory_order_acq_rel));
+
+        m_signal.fetch_add(1, std::memory_order_release);
+        m_signal.notify_one();
+
+        if (replaced)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return replaced->frameId;
+        }
+
+        return std::nullopt;
+    }
+
+    // Consumer side: blocks until a frame was posted, returns an empty reference once the mailbox was closed and is empty
+    FrameRef take()
+    {
+        while (true)
+        {
+            const uint32_t signal = m_signal.load(std::memory_order_acquire);
+
+            if (Frame* frame = m_slot.exchange(nullptr, std::memory_order_acq_rel))
+            {
+                return FrameRef::adopt(frame);
+            }
+
+            if (m_closed.load(std::memory_order_acquire))
+            {
+                return {};
+            }
+
+            m_signal.wait(signal, std::memory_order_acquire);
+        }
+    }
+
+    void close()
+    {
+        m_closed.store(true, std::memory_order_release);
+
+        m_signal.fetch_add(1, std::memory_order_release);
+        m_signal.notify_all();
+    }
+
+    uint64_t getPostedCount() const
+    {
+        return m_posted.load(std::memory_order_relaxed);
+    }
+
+    uint64_t getDroppedCount() const
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<Frame*> m_slot = nullptr;
+
+    std::atomic<uint32_t> m_signal = 0;
+    std::atomic<bool> m_closed = false;
+
+    std::atomic<uint64_t> m_posted = 0;
+    std::atomic<uint64_t> m_dropped = 0;
+};
@@ -0,0 +1,162 @@
+#include "frame_pipeline.h"
+#include "trace_logging.h"
+
+FramePipeline::FramePipeline() : m_encodedSampleSink(*this)
+{
+}
+
+FramePipeline::~FramePipeline()
+{
+    stop();
+}
+
+bool FramePipeline::start(std::shared_ptr<IDevice> device, IDeviceSampleHandler* encoder, IVideoStreamSampleConsumer* sampleConsumer, const Options& options)
+{
+    if (!device || !encoder || !sampleConsumer)
+    {
+        error("PIPELINE", "Pipeline needs a device, an encoder and a sample consumer.");
+        return false;
+    }
+
+    m_device = device;
+    m_encoder = encoder;
+    m_sampleConsumer = sampleConsumer;
+    m_latency = options.latency;
+
+    m_captureMailbox = std::make_unique<FrameMailbox>();
+    m_encodedRing = std::make_unique<RingBuffer<EncodedFrame>>(options.encodedRingSize);
+
+    m_run = true;
+
+    // Start the consumers first so that they are ready once the first frame is captured
+    m_sendThread = std::thread(&FramePipeline::sendThread, this);
+    m_encodeThread = std::thread(&FramePipeline::encodeThread, this);
+    m_captureThread = std::thread(&FramePipeline::captureThread, this);
+
+    return true;
+}
+
+void FramePipeline::stop()
+{
+    if (!m_captureThread.joinable())
+    {
+        return;
+    }
+
+    // Shut down front to back, every stage drains its input before it exits
+    m_run = false;
+    m_captureThread.join();
+
+    m_captureMailbox->close();
+    m_encodeThread.join();
+
+    m_encodedRing->close();
+    m_sendThread.join();
+
+    logStatistics();
+}
+
+FramePipeline::Statistics FramePipeline::getStatistics() const
+{
+    Statistics statistics;
+
+    if (m_captureMailbox)
+    {
+        statistics.capture.dropped = m_captureMailbox->getDroppedCount();
+        statistics.capture.processed = m_captureMailbox->getPostedCount() - statistics.capture.dropped;
+    }
+
+    if (m_encodedRing)
+    {
+        statistics.encodedRing = m_encodedRing->getStatistics();
+        statistics.encode.processed = statistics.encodedRing.pushed;
+    }
+
+    statistics.send.processed = m_sentFrames.load(std::memory_order_relaxed);
+
+    return statistics;
+}
+
+void FramePipeline::logStatistics() const
+{
+    auto statistics = getStatistics();
+
+    info("PIPELINE", "Capture: %d frames encoded, %d dropped. Encode: %d frames queued for sending. Send: %d frames sent.", int(statistics.capture.processed),
+         int(statistics.capture.dropped), int(statistics.encode.processed), int(statistics.send.processed));
+    info("PIPELINE", "Encoded ring: %d slots, %d occupied, high watermark %d, encoder waited %d times for the sender.", int(statistics.encodedRing.capacity),
+         int(statistics.encodedRing.occupancy), int(statistics.encodedRing.highWatermark), int(statistics.encodedRing.full));
+}
+
+void FramePipeline::onSample(const FrameRef& frame, [[maybe_unused]] IVideoStreamSampleConsumer* sampleConsumer)
+{
+    // If the encoder didn't pick up the previous frame yet it is replaced, an old frame is worse than a skipped one
+    if (auto droppedFrameId = m_captureMailbox->post(frame))
+    {
+        Trace::Pipeline_FrameDropped("Capture", *droppedFrameId, m_captureMailbox->getDroppedCount());
+    }
+}
+
+void FramePipeline::EncodedSampleSink::onEncodedSampleAvailable(std::chrono::nanoseconds originalTimeStamp, const std::vector<std::byte>& sample, uint64_t frameId,
+                                                                const std::vector<std::byte>& sequenceParameters)
+{
+    EncodedFrame* frame = m_pipeline.m_encodedRing->beginPush();
+
+    // The following frames reference this one, so the encoder waits for the sender instead of breaking the stream for every viewer
+    if (!frame)
+    {
+        Trace::Pipeline_RingFull("Encoded", frameId, m_pipeline.m_encodedRing->getStatistics().full);
+
+        if (!m_pipeline.m_encodedRing->waitForSpace())
+        {
+            return;
+        }
+
+        frame = m_pipeline.m_encodedRing->beginPush();
+    }
+
+    frame->timeStamp = originalTimeStamp;
+    frame->queuedTime = std::chrono::steady_clock::now();
+    frame->frameId = frameId;
+    frame->sample.assign(sample.begin(), sample.end());
+    frame->sequenceParameters.assign(sequenceParameters.begin(), sequenceParameters.end());
+
+    size_t occupancy = m_pipeline.m_encodedRing->endPush();
+
+    Trace::Pipeline_RingPush("Encoded", frameId, static_cast<uint32_t>(occupancy));
+}
+
+void FramePipeline::captureThread()
+{
+    m_device->stream(m_run, this, nullptr);
+}
+
+void FramePipeline::encodeThread()
+{
+    while (FrameRef frame = m_captureMailbox->take())
+    {
+        m_encoder->onSample(frame, &m_encodedSampleSink);
+    }
+
+    // Frames the encoder still works on are pushed before the ring closes
+    m_encoder->flush();
+}
+
+void FramePipeline::sendThread()
+{
+    while (m_encodedRing->waitForData())
+    {
+        EncodedFrame* frame = m_encodedRing->beginPop();
+
+        m_sampleConsumer->onEncodedSampleAvailable(frame->timeStamp, frame->sample, frame->frameId, frame->sequenceParameters);
+
+        if (m_latency)
+        {
+            const auto sendTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - frame->queuedTime);
+            m_latency->sendNs.store(sendTime.count(), std::memory_order_relaxed);
+        }
+
+        m_encodedRing->endPop();
+
+        m_sentFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "pipeline/frame_mailbox.h"
+#include "pipeline/ring_buffer.h"
+#include "pipeline/stream_latency.h"
+#include "streaming/streaming.h"
+#include "video_input/device.h"
+#include "video_input/frame.h"
+
+// Runs capture, encode and the fan-out to the viewers on three separate threads.
+//
+// Capture hands frames to the encoder through a mailbox where the newest frame wins, so a slow encoder
+// skips frames instead of building up latency. Encode and fan-out are joined by a bounded ring, when it is
+// full the encoder waits for the sender: every encoded frame is referenced by the next ones, so none of them
+// may get lost. Capture drops and encoder waits are counted.
+class FramePipeline : public IDeviceSampleHandler
+{
+  public:
+    struct Options
+    {
+        size_t encodedRingSize = 8;
+
+        // Receives the send latency of every frame, e.g. for the encoder's overlay
+        std::shared_ptr<StreamLatency> latency;
+    };
+
+    struct StageStatistics
+    {
+        uint64_t processed = 0; // Frames the stage handed on to the next one
+        uint64_t dropped = 0;   // Frames the stage produced but which never made it into the next one, only capture drops frames
+    };
+
+    struct Statistics
+    {
+        StageStatistics capture;
+        StageStatistics encode;
+        StageStatistics send;
+        RingStatistics encodedRing;
+    };
+
+    FramePipeline();
+    ~FramePipeline();
+
+    bool start(std::shared_ptr<IDevice> device, IDeviceSampleHandler* encoder, IVideoStreamSampleConsumer* sampleConsumer, const Options& options);
+    void stop();
+
+    Statistics getStatistics() const;
+    void logStatistics() const;
+
+    // Called on the capture thread by the device, posts a reference to the frame to the encoder mailbox
+    virtual void onSample(const FrameRef& frame, IVideoStreamSampleConsumer* sampleConsumer) override;
+
+  private:
+    struct EncodedFrame
+    {
+        std::chrono::nanoseconds timeStamp;
+        std::chrono::steady_clock::time_point queuedTime;
+        uint64_t frameId = 0;
+        std::vector<std::byte> sample;
+        std::vector<std::byte> sequenceParameters;
+    };
+
+    // Receives the encoder output on the encode thread and pushes it into the encoded ring
+    class EncodedSampleSink : public IVideoStreamSampleConsumer
+    {
+      public:
+        EncodedSampleSink(FramePipeline& pipeline) : m_pipeline(pipeline)
+        {
+        }
+
+        virtual void onEncodedSampleAvailable(std::chrono::nanoseconds originalTimeStamp, const std::vector<std::byte>& sample, uint64_t frameId,
+                                              const std::vector<std::byte>& sequenceParameters) override;
+
+      private:
+        FramePipeline& m_pipeline;
+    };
+
+    void captureThread();
+    void encodeThread();
+    void sendThread();
+
+    std::shared_ptr<IDevice> m_device;
+    IDeviceSampleHandler* m_encoder = nullptr;
+    IVideoStreamSampleConsumer* m_sampleConsumer = nullptr;
+    std::shared_ptr<StreamLatency> m_latency;
+
+    EncodedSampleSink m_encodedSampleSink;
+
+    std::unique_ptr<FrameMailbox> m_captureMailbox;
+    std::unique_ptr<RingBuffer<EncodedFrame>> m_encodedRing;
+    std::atomic<uint64_t> m_sentFrames = 0;
+
+    std::atomic<bool> m_run = false;
+
+    std::thread m_captureThread;
+    std::thread m_encodeThread;
+    std::thread m_sendThread;
+};
@@ -0,0 +1,237 @@
+#include "mjpeg_decoded_device.h"
+#include "conversion/jpeg_decoder.h"
+#include "conversion/scaler.h"
+#include "video_input/video_format.h"
+
+MJPEGDecodedDevice::MJPEGDecodedDevice(std::shared_ptr<IDevice> device, const Options& options)
+    : m_device(std::move(device)), m_options(options), m_framePool(FramePool::create())
+{
+    m_options.threadCount = std::max(m_options.threadCount, 1u);
+}
+
+MJPEGDecodedDevice::~MJPEGDecodedDevice() = default;
+
+std::string MJPEGDecodedDevice::getName() const
+{
+    return m_device->getName();
+}
+
+std::vector<IDevice::VideoMode> MJPEGDecodedDevice::enumerateVideoModes() const
+{
+    return m_device->enumerateVideoModes();
+}
+
+bool MJPEGDecodedDevice::setVideoMode(const VideoMode& mode)
+{
+    return m_device->setVideoMode(mode);
+}
+
+bool MJPEGDecodedDevice::prepareStreaming()
+{
+    return m_device->prepareStreaming();
+}
+
+void MJPEGDecodedDevice::stream(std::atomic<bool>& run, IDeviceSampleHandler* sampleHandler, IVideoStreamSampleConsumer* sampleConsumer)
+{
+    m_sampleHandler = sampleHandler;
+    m_sampleConsumer = sampleConsumer;
+    m_stopping = false;
+
+    for (uint32_t i = 0; i < m_options.threadCount; ++i)
+    {
+        m_threads.emplace_back([this]() { decodeThread(); });
+    }
+
+    m_device->stream(run, this, sampleConsumer);
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_jobSignal.fetch_add(1, std::memory_order_release);
+    m_jobSignal.notify_all();
+
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+
+    m_threads.clear();
+
+    // Frames which were still queued when the device stopped are dropped
+    m_droppedCount += m_jobs.size();
+    m_jobs.clear();
+
+    info("MJPEG", "Input '%s': %d frames decoded, %d dropped.", m_device->getName().c_str(), int(m_decodedCount), int(m_droppedCount));
+
+    m_sampleHandler = nullptr;
+    m_sampleConsumer = nullptr;
+}
+
+void MJPEGDecodedDevice::getFrameSize(uint32_t& width, uint32_t& height) const
+{
+    m_device->getFrameSize(width, height);
+}
+
+Ratio MJPEGDecodedDevice::getFrameRate() const
+{
+    return m_device->getFrameRate();
+}
+
+IDevice::VideoFormat MJPEGDecodedDevice::getVideoFormat() const
+{
+    return VideoFormat::NV12;
+}
+
+IDevice::FieldOrder MJPEGDecodedDevice::getFieldOrder() const
+{
+    return m_device->getFieldOrder();
+}
+
+void MJPEGDecodedDevice::onSample(const FrameRef& frame, [[maybe_unused]] IVideoStreamSampleConsumer* sampleConsumer)
+{
+    std::vector<std::byte> compressed;
+
+    {
+        std::lock_guard lock(m_mutex);
+
+        // Every worker is busy and another frame already waits for one
+        if (m_jobs.size() > m_options.threadCount)
+        {
+            ++m_droppedCount;
+            return;
+        }
+
+        if (!m_spareCompressed.empty())
+        {
+            compressed = std::move(m_spareCompressed.back());
+            m_spareCompressed.pop_back();
+        }
+    }
+
+    // Copied outside of the lock, only the capture thread adds jobs
+    const Frame::Plane& plane = frame->planes[0];
+    compressed.assign(plane.data, plane.data + plane.rowSize);
+
+    {
+        std::lock_guard lock(m_mutex);
+
+        Job& job = m_jobs.emplace_back();
+        job.compressed = std::move(compressed);
+        job.timeStamp = frame->timeStamp;
+        job.frameId = frame->frameId;
+        job.width = frame->width;
+        job.height = frame->height;
+    }
+
+    m_jobSignal.fetch_add(1, std::memory_order_release);
+    m_jobSignal.notify_one();
+}
+
+void MJPEGDecodedDevice::decodeThread()
+{
+    JpegDecoder decoder;
+
+    while (true)
+    {
+        const uint32_t signal = m_jobSignal.load(std::memory_order_acquire);
+
+        std::unique_lock lock(m_mutex);
+
+        if (m_stopping)
+        {
+            return;
+        }
+
+        const auto pending = std::find_if(m_jobs.begin(), m_jobs.end(), [](const Job& candidate) { return candidate.state == Job::State::Pending; });
+
+        if (pending == m_jobs.end())
+        {
+            lock.unlock();
+            m_jobSignal.wait(signal, std::memory_order_acquire);
+            continue;
+        }
+
+        // Only this worker touches the job until it is finished
+        Job& job = *pending;
+        job.state = Job::State::Decoding;
+
+        NV12Planes planes;
+        job.decoded = acquireFrame(job, planes);
+
+        lock.unlock();
+
+        if (job.decoded && !decoder.decode(job.compressed.data(), job.compressed.size(), job.width, job.height, planes))
+        {
+            job.decoded.reset();
+        }
+
+        lock.lock();
+
+        job.state = Job::State::Finished;
+        m_decodedCount += job.decoded ? 1 : 0;
+
+        lock.unlock();
+
+        deliverFinishedJobs();
+    }
+}
+
+void MJPEGDecodedDevice::deliverFinishedJobs()
+{
+    std::unique_lock lock(m_mutex);
+
+    // The delivering worker checks the front again after every frame, so it also picks up the jobs of the others
+    if (m_delivering)
+    {
+        return;
+    }
+
+    m_delivering = true;
+
+    while (!m_jobs.empty() && m_jobs.front().state == Job::State::Finished)
+    {
+        FrameRef decoded = std::move(m_jobs.front().decoded);
+
+        m_spareCompressed.push_back(std::move(m_jobs.front().compressed));
+        m_jobs.pop_front();
+
+        lock.unlock();
+
+        if (decoded)
+        {
+            m_sampleHandler->onSample(decoded, m_sampleConsumer);
+            decoded.reset();
+        }
+
+        lock.lock();
+    }
+
+    m_delivering = false;
+}
+
+FrameRef MJPEGDecodedDevice::acquireFrame(const Job& job, NV12Planes& planes)
+{
+    FrameRef frame = m_framePool->acquire();
+
+    // Buffers are acquired under the job lock, so only one worker at a time takes one
+    std::vector<std::byte>& buffer = m_buffers.acquire(*frame);
+    buffer.resize(GetVideoFormatInfo(VideoFormat::NV12).getPackedSize(job.width, job.height));
+
+    frame->timeStamp = job.timeStamp;
+    frame->frameId = job.frameId;
+    frame->videoFormat = VideoFormat::NV12;
+    frame->width = job.width;
+    frame->height = job.height;
+    if (!frame->setPackedData(buffer.data(), buffer.size()))
+    {
+        error("MJPEG", "Can't lay out a decoded %d x %d frame.", job.width, job.height);
+        return {};
+    }
+
+    std::byte* data = buffer.data();
+    planes = {data, frame->planes[0].pitch, data + (frame->planes[1].data - frame->planes[0].data), frame->planes[1].pitch};
+
+    return frame;
+}
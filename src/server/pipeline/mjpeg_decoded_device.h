@@ -0,0 +1,105 @@
+#pragma once
+
+#include "video_input/device.h"
+#include "video_input/frame.h"
+
+#include <deque>
+
+struct NV12Planes;
+
+// Wraps a device which delivers MJPEG frames and hands NV12 frames to the sample handler instead, so that the pipelines
+// and the other stages never see compressed frames.
+//
+// A single thread can't decode 1080p JPEGs at 60 fps, so consecutive frames are decoded in parallel by a pool of worker
+// threads with a decoder each. The decoded frames are delivered in capture order by whichever worker finishes the oldest one.
+// The compressed data is copied out of the capture buffer right away, so that the decoding doesn't hold buffers of the device.
+// If every worker is busy and another frame already waits, new frames are dropped instead of adding latency.
+class MJPEGDecodedDevice : public IDevice, private IDeviceSampleHandler
+{
+  public:
+    struct Options
+    {
+        // Frames decoded at the same time
+        uint32_t threadCount = 3;
+    };
+
+    MJPEGDecodedDevice(std::shared_ptr<IDevice> device, const Options& options);
+    ~MJPEGDecodedDevice();
+
+    virtual std::string getName() const override;
+
+    virtual std::vector<VideoMode> enumerateVideoModes() const override;
+    virtual bool setVideoMode(const VideoMode& mode) override;
+    virtual bool prepareStreaming() override;
+
+    virtual void stream(std::atomic<bool>& run, IDeviceSampleHandler* sampleHandler, IVideoStreamSampleConsumer* sampleConsumer) override;
+
+    virtual void getFrameSize(uint32_t& width, uint32_t& height) const override;
+    virtual Ratio getFrameRate() const override;
+    virtual VideoFormat getVideoFormat() const override;
+    virtual FieldOrder getFieldOrder() const override;
+
+  private:
+    struct Job
+    {
+        enum class State
+        {
+            Pending,
+            Decoding,
+            Finished
+        };
+
+        State state = State::Pending;
+
+        std::vector<std::byte> compressed;
+        std::chrono::nanoseconds timeStamp{0};
+        uint64_t frameId = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        // Empty if decoding failed
+        FrameRef decoded;
+    };
+
+    // Called on the capture thread by the wrapped device
+    virtual void onSample(const FrameRef& frame, IVideoStreamSampleConsumer* sampleConsumer) override;
+
+    void decodeThread();
+
+    // Hands the finished jobs at the front of the queue to the sample handler. Only one thread delivers at a time,
+    // the others leave their jobs to it.
+    void deliverFinishedJobs();
+
+    // Returns an NV12 frame of the job's size backed by a free buffer and the planes to decode into. Needs m_mutex.
+    FrameRef acquireFrame(const Job& job, NV12Planes& planes);
+
+    std::shared_ptr<IDevice> m_device;
+    Options m_options;
+
+    std::shared_ptr<FramePool> m_framePool;
+
+    // Bumped whenever a job was added or the workers should stop
+    std::atomic<uint32_t> m_jobSignal = 0;
+
+    // Guards everything below
+    std::mutex m_mutex;
+
+    // In capture order. Jobs are only removed from the front once finished, so the workers can keep references to theirs.
+    std::deque<Job> m_jobs;
+    bool m_delivering = false;
+    bool m_stopping = false;
+
+    BufferPool<std::vector<std::byte>> m_buffers;
+
+    // Compressed data of finished jobs, reused so that copying a frame doesn't allocate
+    std::vector<std::vector<std::byte>> m_spareCompressed;
+
+    uint64_t m_decodedCount = 0;
+    uint64_t m_droppedCount = 0;
+
+    std::vector<std::thread> m_threads;
+
+    // Only set while streaming
+    IDeviceSampleHandler* m_sampleHandler = nullptr;
+    IVideoStreamSampleConsumer* m_sampleConsumer = nullptr;
+};
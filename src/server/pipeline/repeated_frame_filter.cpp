@@ -0,0 +1,61 @@
+#include "repeated_frame_filter.h"
+#include "conversion/frame_hash.h"
+
+RepeatedFrameFilter::RepeatedFrameFilter(const Options& options) : m_options(options)
+{
+}
+
+bool RepeatedFrameFilter::isRepeat(const Frame& frame, uint64_t seed)
+{
+    const uint64_t hash = HashFrame(frame, seed);
+
+    const bool repeat = m_previousHash == hash && frame.timeStamp - m_lastPassedTimeStamp < m_options.refreshInterval;
+
+    m_previousHash = hash;
+    m_checked.fetch_add(1, std::memory_order_relaxed);
+
+    if (repeat)
+    {
+        m_skipped.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        m_lastPassedTimeStamp = frame.timeStamp;
+    }
+
+    return repeat;
+}
+
+void RepeatedFrameFilter::onFrameEncoded(size_t uploadBytes, size_t encodedBytes, std::chrono::nanoseconds encodeTime)
+{
+    m_encoded.fetch_add(1, std::memory_order_relaxed);
+    m_uploadBytes.fetch_add(uploadBytes, std::memory_order_relaxed);
+    m_encodedBytes.fetch_add(encodedBytes, std::memory_order_relaxed);
+    m_encodeTime.fetch_add(encodeTime.count(), std::memory_order_relaxed);
+}
+
+RepeatedFrameFilter::Statistics RepeatedFrameFilter::getStatistics() const
+{
+    Statistics statistics;
+    statistics.checked = m_checked.load(std::memory_order_relaxed);
+    statistics.skipped = m_skipped.load(std::memory_order_relaxed);
+
+    const uint64_t encoded = m_encoded.load(std::memory_order_relaxed);
+    if (encoded > 0)
+    {
+        statistics.savedUploadBytes = m_uploadBytes.load(std::memory_order_relaxed) / encoded * statistics.skipped;
+        statistics.savedEncodedBytes = m_encodedBytes.load(std::memory_order_relaxed) / encoded * statistics.skipped;
+        statistics.savedEncodeTime = std::chrono::nanoseconds(m_encodeTime.load(std::memory_order_relaxed) / int64_t(encoded) * int64_t(statistics.skipped));
+    }
+
+    return statistics;
+}
+
+void RepeatedFrameFilter::logStatistics() const
+{
+    const Statistics statistics = getStatistics();
+
+    info("PIPELINE", "Repeated frames: %d of %d skipped, saving about %.1f MB of uploads, %.1f ms of encoding and %.1f MB of encoded video.", int(statistics.skipped),
+         int(statistics.checked), statistics.savedUploadBytes / 1e6, std::chrono::duration<double, std::milli>(statistics.savedEncodeTime).count(),
+         statistics.savedEncodedBytes / 1e6);
+}
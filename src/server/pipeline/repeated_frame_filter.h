@@ -0,0 +1,54 @@
+#pragma once
+
+#include "video_input/frame.h"
+
+// Recognizes frames which repeat the previous one, like a 30p camera on a 60p link or a stage which is static between acts,
+// so that the encoder can skip them before uploading. The frames are compared by a hash of their pixels, which only catches
+// exact repeats. Sensor noise of a static camera image still makes every frame differ.
+//
+// The viewers simply keep showing the last frame while frames are skipped. A repeat is still encoded every refresh interval,
+// so that the stream never goes silent and lost packets get repaired.
+class RepeatedFrameFilter
+{
+  public:
+    struct Options
+    {
+        std::chrono::nanoseconds refreshInterval = std::chrono::seconds(1);
+    };
+
+    // What skipping saved, estimated from the average cost of the frames which were encoded
+    struct Statistics
+    {
+        uint64_t checked = 0;
+        uint64_t skipped = 0;
+        uint64_t savedUploadBytes = 0;
+        uint64_t savedEncodedBytes = 0;
+        std::chrono::nanoseconds savedEncodeTime = {};
+    };
+
+    explicit RepeatedFrameFilter(const Options& options);
+
+    // True if the frame repeats the one before it and can be skipped. The seed is mixed into the hash, so that
+    // a change in how the frame is encoded doesn't count as a repeat. Called on the encode thread.
+    bool isRepeat(const Frame& frame, uint64_t seed = 0);
+
+    // Reports the cost of a frame which was encoded instead of skipped
+    void onFrameEncoded(size_t uploadBytes, size_t encodedBytes, std::chrono::nanoseconds encodeTime);
+
+    Statistics getStatistics() const;
+    void logStatistics() const;
+
+  private:
+    Options m_options;
+
+    std::optional<uint64_t> m_previousHash;
+    std::chrono::nanoseconds m_lastPassedTimeStamp = {};
+
+    // Read by the statistics from another thread
+    std::atomic<uint64_t> m_checked = 0;
+    std::atomic<uint64_t> m_skipped = 0;
+    std::atomic<uint64_t> m_encoded = 0;
+    std::atomic<uint64_t> m_uploadBytes = 0;
+    std::atomic<uint64_t> m_encodedBytes = 0;
+    std::atomic<int64_t> m_encodeTime = 0; // In nanoseconds
+};
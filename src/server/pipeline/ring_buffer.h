@@ -0,0 +1,162 @@
+#pragma once
+
+// Bounded lock-free ring for exactly one producer and one consumer thread.
+//
+// Slots are reused in place (beginPush / endPush and beginPop / endPop) so that elements which own
+// memory, e.g. frame buffers, keep their allocations and nothing is allocated per frame.
+// The consumer can block in waitForData() until the producer commits a slot or the ring gets closed, the producer
+// can block in waitForSpace() until the consumer hands a slot back.
+struct RingStatistics
+{
+    size_t capacity = 0;
+    size_t occupancy = 0;
+    size_t highWatermark = 0;
+    uint64_t pushed = 0;
+    uint64_t full = 0; // Push attempts while the ring was full
+};
+
+template <typename T> class RingBuffer
+{
+  public:
+    explicit RingBuffer(size_t capacity) : m_slots(std::bit_ceil(std::max<size_t>(capacity, 1))), m_mask(m_slots.size() - 1)
+    {
+    }
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    // Producer side: returns the next free slot or nullptr if the ring is full
+    T* beginPush()
+    {
+        const uint64_t writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+
+        if (writeIndex - m_readIndex.load(std::memory_order_acquire) >= m_slots.size())
+        {
+            m_full.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        return &m_slots[writeIndex & m_mask];
+    }
+
+    // Producer side: publishes the slot returned by beginPush() and returns the occupancy after the push
+    size_t endPush()
+    {
+        const uint64_t writeIndex = m_writeIndex.load(std::memory_order_relaxed) + 1;
+        m_writeIndex.store(writeIndex, std::memory_order_release);
+
+        const size_t occupancy = static_cast<size_t>(writeIndex - m_readIndex.load(std::memory_order_acquire));
+
+        if (occupancy > m_highWatermark.load(std::memory_order_relaxed))
+        {
+            m_highWatermark.store(occupancy, std::memory_order_relaxed);
+        }
+
+        m_signal.fetch_add(1, std::memory_order_release);
+        m_signal.notify_one();
+
+        return occupancy;
+    }
+
+    // Consumer side: returns the oldest committed slot or nullptr if the ring is empty
+    T* beginPop()
+    {
+        const uint64_t readIndex = m_readIndex.load(std::memory_order_relaxed);
+
+        if (readIndex == m_writeIndex.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+
+        return &m_slots[readIndex & m_mask];
+    }
+
+    // Consumer side: hands the slot returned by beginPop() back to the producer
+    void endPop()
+    {
+        m_readIndex.store(m_readIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+        m_spaceSignal.fetch_add(1, std::memory_order_release);
+        m_spaceSignal.notify_one();
+    }
+
+    // Consumer side: blocks until there is data to pop, returns false if the ring was closed and is drained
+    bool waitForData()
+    {
+        while (true)
+        {
+            const uint32_t signal = m_signal.load(std::memory_order_acquire);
+
+            if (m_readIndex.load(std::memory_order_relaxed) != m_writeIndex.load(std::memory_order_acquire))
+            {
+                return true;
+            }
+
+            if (m_closed.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+
+            m_signal.wait(signal, std::memory_order_acquire);
+        }
+    }
+
+    // Producer side: blocks until there is a free slot, returns false if the ring was closed
+    bool waitForSpace()
+    {
+        while (true)
+        {
+            const uint32_t signal = m_spaceSignal.load(std::memory_order_acquire);
+
+            if (m_writeIndex.load(std::memory_order_relaxed) - m_readIndex.load(std::memory_order_acquire) < m_slots.size())
+            {
+                return true;
+            }
+
+            if (m_closed.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+
+            m_spaceSignal.wait(signal, std::memory_order_acquire);
+        }
+    }
+
+    // Wakes up both sides, waitForData() returns false once the ring is empty and waitForSpace() right away
+    void close()
+    {
+        m_closed.store(true, std::memory_order_release);
+
+        m_signal.fetch_add(1, std::memory_order_release);
+        m_signal.notify_all();
+
+        m_spaceSignal.fetch_add(1, std::memory_order_release);
+        m_spaceSignal.notify_all();
+    }
+
+    RingStatistics getStatistics() const
+    {
+        RingStatistics statistics;
+        statistics.capacity = m_slots.size();
+        statistics.occupancy = static_cast<size_t>(m_writeIndex.load(std::memory_order_acquire) - m_readIndex.load(std::memory_order_acquire));
+        statistics.highWatermark = m_highWatermark.load(std::memory_order_relaxed);
+        statistics.pushed = m_writeIndex.load(std::memory_order_relaxed);
+        statistics.full = m_full.load(std::memory_order_relaxed);
+        return statistics;
+    }
+
+  private:
+    std::vector<T> m_slots;
+    const uint64_t m_mask;
+
+    // Producer and consumer indices live on their own cache lines to avoid false sharing
+    alignas(64) std::atomic<uint64_t> m_writeIndex = 0;
+    alignas(64) std::atomic<uint64_t> m_readIndex = 0;
+
+    alignas(64) std::atomic<uint32_t> m_signal = 0;
+    alignas(64) std::atomic<uint32_t> m_spaceSignal = 0;
+    std::atomic<bool> m_closed = false;
+
+    std::atomic<size_t> m_highWatermark = 0;
+    std::atomic<uint64_t> m_full = 0;
+};
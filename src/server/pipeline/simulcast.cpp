@@ -0,0 +1,266 @@
+#include "simulcast.h"
+#include "conversion/nv12.h"
+#include "conversion/scaler.h"
+#include "trace_logging.h"
+#include "video_input/video_format.h"
+
+// Offers the frames of one layer to a regular pipeline, the frames are produced by the stage's scale thread
+class SimulcastStage::LayerDevice : public IDevice
+{
+  public:
+    LayerDevice(std::string name, uint32_t width, uint32_t height, Ratio fps) : m_name(std::move(name)), m_width(width), m_height(height), m_fps(fps)
+    {
+    }
+
+    virtual std::string getName() const override
+    {
+        return m_name;
+    }
+
+    virtual void stream(std::atomic<bool>& run, IDeviceSampleHandler* sampleHandler, IVideoStreamSampleConsumer* sampleConsumer) override
+    {
+        while (run)
+        {
+            FrameRef frame = m_mailbox.take();
+            if (!frame)
+            {
+                break;
+            }
+
+            if (sampleHandler)
+            {
+                sampleHandler->onSample(frame, sampleConsumer);
+            }
+        }
+    }
+
+    virtual void getFrameSize(uint32_t& width, uint32_t& height) const override
+    {
+        width = m_width;
+        height = m_height;
+    }
+
+    virtual Ratio getFrameRate() const override
+    {
+        return m_fps;
+    }
+
+    virtual VideoFormat getVideoFormat() const override
+    {
+        return VideoFormat::NV12;
+    }
+
+    void post(FrameRef frame)
+    {
+        if (auto droppedFrameId = m_mailbox.post(std::move(frame)))
+        {
+            Trace::Pipeline_FrameDropped("Simulcast", *droppedFrameId, m_mailbox.getDroppedCount());
+        }
+    }
+
+    void close()
+    {
+        m_mailbox.close();
+    }
+
+  private:
+    std::string m_name;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    Ratio m_fps;
+
+    FrameMailbox m_mailbox;
+};
+
+SimulcastStage::SimulcastStage() = default;
+
+SimulcastStage::~SimulcastStage()
+{
+    stop();
+}
+
+bool SimulcastStage::init(std::shared_ptr<IDevice> device, const Options& options)
+{
+    if (!device)
+    {
+        error("SIMULCAST", "Simulcast needs an input device.");
+        return false;
+    }
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    device->getFrameSize(width, height);
+
+    if (width < 2 || height < 2 || (width | height) & 1)
+    {
+        error("SIMULCAST", "Frame size %d x %d is invalid, needs to be even.", width, height);
+        return false;
+    }
+
+    m_device = device;
+    m_orientation = options.orientation;
+
+    const std::string name = device->getName();
+    const Ratio fps = device->getFrameRate();
+
+    m_layerDevices.push_back(std::make_shared<LayerDevice>(name, width, height, fps));
+
+    std::vector<uint32_t> layerHeights = options.layerHeights;
+    std::sort(layerHeights.begin(), layerHeights.end(), std::greater<>());
+    layerHeights.erase(std::unique(layerHeights.begin(), layerHeights.end()), layerHeights.end());
+
+    std::vector<NV12Scaler::Size> layerSizes;
+    for (uint32_t layerHeight : layerHeights)
+    {
+        if (layerHeight >= height || layerHeight < 2)
+        {
+            warning("SIMULCAST", "Skipping layer with a height of %d, it needs to be smaller than the input's height of %d.", layerHeight, height);
+            continue;
+        }
+
+        // Keep the aspect ratio, both dimensions need to be even for the chroma plane
+        NV12Scaler::Size size;
+        size.height = layerHeight & ~1u;
+        size.width = std::max(2u, static_cast<uint32_t>(uint64_t(width) * size.height / height) & ~1u);
+
+        layerSizes.push_back(size);
+        m_layerDevices.push_back(std::make_shared<LayerDevice>(name + "@" + std::to_string(size.height) + "p", size.width, size.height, fps));
+
+        info("SIMULCAST", "Layer %d x %d for '%s'.", size.width, size.height, name.c_str());
+    }
+
+    m_layerBuffers.resize(m_layerDevices.size());
+
+    m_converter = std::make_unique<NV12Converter>(device->getVideoFormat(), options.threadCount);
+    m_scaler = std::make_unique<NV12Scaler>(NV12Scaler::Size{width, height}, layerSizes, options.threadCount);
+    m_framePool = FramePool::create();
+
+    return true;
+}
+
+void SimulcastStage::start()
+{
+    if (m_captureThread.joinable() || !m_device)
+    {
+        return;
+    }
+
+    m_run = true;
+
+    m_scaleThread = std::thread(&SimulcastStage::scaleThread, this);
+    m_captureThread = std::thread(&SimulcastStage::captureThread, this);
+}
+
+void SimulcastStage::stop()
+{
+    if (m_captureThread.joinable())
+    {
+        m_run = false;
+        m_captureThread.join();
+
+        m_captureMailbox.close();
+        m_scaleThread.join();
+    }
+
+    // Lets the pipelines of the layers leave their capture loops, even if the stage never started
+    for (auto& layerDevice : m_layerDevices)
+    {
+        static_cast<LayerDevice*>(layerDevice.get())->close();
+    }
+}
+
+void SimulcastStage::onSample(const FrameRef& frame, [[maybe_unused]] IVideoStreamSampleConsumer* sampleConsumer)
+{
+    if (auto droppedFrameId = m_captureMailbox.post(frame))
+    {
+        Trace::Pipeline_FrameDropped("Simulcast", *droppedFrameId, m_captureMailbox.getDroppedCount());
+    }
+}
+
+void SimulcastStage::captureThread()
+{
+    m_device->stream(m_run, this, nullptr);
+}
+
+void SimulcastStage::scaleThread()
+{
+    std::vector<FrameRef> layerFrames(m_layerDevices.size());
+    std::vector<NV12Planes> layerPlanes(m_layerDevices.size() - 1);
+
+    while (FrameRef frame = m_captureMailbox.take())
+    {
+        FrameRef fullFrame = frame;
+
+        // NV12 in the right orientation is passed on as is, everything else is converted once for all layers
+        if (frame->videoFormat != IDevice::VideoFormat::NV12 || m_orientation != Orientation{})
+        {
+            fullFrame = acquireLayerFrame(0, *frame);
+            if (!fullFrame)
+            {
+                continue;
+            }
+
+            std::byte* y = const_cast<std::byte*>(fullFrame->planes[0].data);
+            std::byte* uv = const_cast<std::byte*>(fullFrame->planes[1].data);
+
+            if (!m_converter->convert(*frame, y, fullFrame->planes[0].pitch, uv, fullFrame->planes[1].pitch, m_orientation))
+            {
+                continue;
+            }
+        }
+
+        bool acquired = true;
+        for (size_t i = 1; i < m_layerDevices.size(); ++i)
+        {
+            layerFrames[i] = acquireLayerFrame(i, *frame);
+            acquired = bool(layerFrames[i]);
+            if (!acquired)
+            {
+                break;
+            }
+
+            NV12Planes& planes = layerPlanes[i - 1];
+            planes.y = const_cast<std::byte*>(layerFrames[i]->planes[0].data);
+            planes.yPitch = layerFrames[i]->planes[0].pitch;
+            planes.uv = const_cast<std::byte*>(layerFrames[i]->planes[1].data);
+            planes.uvPitch = layerFrames[i]->planes[1].pitch;
+        }
+
+        if (!acquired || (!layerPlanes.empty() && !m_scaler->scale(*fullFrame, layerPlanes)))
+        {
+            continue;
+        }
+
+        layerFrames[0] = std::move(fullFrame);
+
+        for (size_t i = 0; i < m_layerDevices.size(); ++i)
+        {
+            static_cast<LayerDevice*>(m_layerDevices[i].get())->post(std::move(layerFrames[i]));
+        }
+    }
+}
+
+FrameRef SimulcastStage::acquireLayerFrame(size_t layer, const Frame& source)
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    m_layerDevices[layer]->getFrameSize(width, height);
+
+    FrameRef frame = m_framePool->acquire();
+
+    std::vector<std::byte>& buffer = m_layerBuffers[layer].acquire(*frame);
+    buffer.resize(GetVideoFormatInfo(IDevice::VideoFormat::NV12).getPackedSize(width, height));
+
+    frame->timeStamp = source.timeStamp;
+    frame->frameId = source.frameId;
+    frame->videoFormat = IDevice::VideoFormat::NV12;
+    frame->width = width;
+    frame->height = height;
+    if (!frame->setPackedData(buffer.data(), buffer.size()))
+    {
+        error("SIMULCAST", "Can't lay out a %d x %d frame for layer %d.", width, height, int(layer));
+        return {};
+    }
+
+    return frame;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "conversion/orientation.h"
+#include "pipeline/frame_mailbox.h"
+#include "video_input/device.h"
+
+class NV12Converter;
+class NV12Scaler;
+
+// Builds simulcast layers from one input device, so that viewers on weak connections can watch a smaller stream.
+//
+// Every captured frame is converted to NV12 once and scaled down to all smaller layers in a single pass. Each layer is
+// offered as a device of its own, which is encoded and sent by a regular FramePipeline. Like the pipeline the stage
+// captures and scales on separate threads with a mailbox in between, so slow scaling skips frames instead of adding latency.
+class SimulcastStage : public IDeviceSampleHandler
+{
+  public:
+    struct Options
+    {
+        // Heights of the smaller layers, their widths keep the aspect ratio. Heights at or above the input's are skipped.
+        std::vector<uint32_t> layerHeights;
+
+        // Threads for the conversion and for the scaling
+        uint32_t threadCount = 2;
+
+        // Applied while converting, so that every layer is flipped the same way
+        Orientation orientation;
+    };
+
+    SimulcastStage();
+    ~SimulcastStage();
+
+    bool init(std::shared_ptr<IDevice> device, const Options& options);
+
+    // The layer devices need to be streaming before the stage starts, otherwise their first frames are dropped
+    void start();
+
+    // Stops capturing and ends the streams of the layer devices, also if the stage was never started
+    void stop();
+
+    // The full size layer first, then the smaller ones from large to small
+    const std::vector<std::shared_ptr<IDevice>>& getLayerDevices() const
+    {
+        return m_layerDevices;
+    }
+
+    // Called on the capture thread by the input device
+    virtual void onSample(const FrameRef& frame, IVideoStreamSampleConsumer* sampleConsumer) override;
+
+  private:
+    class LayerDevice;
+
+    void captureThread();
+    void scaleThread();
+
+    // Returns a frame backed by a free buffer of the layer, the buffer is handed back once the frame is released
+    FrameRef acquireLayerFrame(size_t layer, const Frame& source);
+
+    std::shared_ptr<IDevice> m_device;
+    Orientation m_orientation;
+
+    std::vector<std::shared_ptr<IDevice>> m_layerDevices;
+    std::vector<BufferPool<std::vector<std::byte>>> m_layerBuffers;
+
+    std::unique_ptr<NV12Converter> m_converter;
+    std::unique_ptr<NV12Scaler> m_scaler;
+    std::shared_ptr<FramePool> m_framePool;
+
+    FrameMailbox m_captureMailbox;
+
+    std::atomic<bool> m_run = false;
+
+    std::thread m_captureThread;
+    std::thread m_scaleThread;
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+// Latencies of the most recent frame of a stream. Each stage of the pipeline writes the one it measures and the
+// encoder's overlay reads them, so the values may belong to neighbouring frames.
+struct StreamLatency
+{
+    // From the encoder picking up the frame until the encoded sample is handed on
+    std::atomic<int64_t> encodeNs = 0;
+
+    // From the encoded sample being queued until all viewers got it
+    std::atomic<int64_t> sendNs = 0;
+};
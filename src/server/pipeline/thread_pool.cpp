@@ -0,0 +1,83 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    for (uint32_t i = 1; i < threadCount; ++i)
+    {
+        m_threads.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    m_stop.store(true, std::memory_order_release);
+
+    m_generation.fetch_add(1, std::memory_order_release);
+    m_generation.notify_all();
+
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t index)>& task)
+{
+    if (m_threads.empty() || count <= 1)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            task(i);
+        }
+
+        return;
+    }
+
+    m_task = &task;
+    m_taskCount = count;
+    m_nextIndex.store(0, std::memory_order_relaxed);
+    m_finishedWorkers.store(0, std::memory_order_relaxed);
+
+    m_generation.fetch_add(1, std::memory_order_release);
+    m_generation.notify_all();
+
+    runTasks();
+
+    const uint32_t workerCount = static_cast<uint32_t>(m_threads.size());
+
+    for (uint32_t finished = m_finishedWorkers.load(std::memory_order_acquire); finished != workerCount; finished = m_finishedWorkers.load(std::memory_order_acquire))
+    {
+        m_finishedWorkers.wait(finished, std::memory_order_acquire);
+    }
+
+    m_task = nullptr;
+}
+
+void ThreadPool::workerLoop()
+{
+    uint32_t generation = 0;
+
+    while (true)
+    {
+        m_generation.wait(generation, std::memory_order_acquire);
+        generation = m_generation.load(std::memory_order_acquire);
+
+        if (m_stop.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        runTasks();
+
+        m_finishedWorkers.fetch_add(1, std::memory_order_release);
+        m_finishedWorkers.notify_one();
+    }
+}
+
+void ThreadPool::runTasks()
+{
+    for (uint32_t index = m_nextIndex.fetch_add(1, std::memory_order_relaxed); index < m_taskCount; index = m_nextIndex.fetch_add(1, std::memory_order_relaxed))
+    {
+        (*m_task)(index);
+    }
+}
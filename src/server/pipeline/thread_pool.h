@@ -0,0 +1,37 @@
+#pragma once
+
+// A fixed set of worker threads which run the iterations of a parallel loop.
+// The calling thread takes part in the loop, so a pool for N threads starts N - 1 workers.
+class ThreadPool
+{
+  public:
+    explicit ThreadPool(uint32_t threadCount);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    uint32_t getThreadCount() const
+    {
+        return static_cast<uint32_t>(m_threads.size()) + 1;
+    }
+
+    // Calls the task for every index in [0, count) and returns once all calls finished. Only one loop can run at a time.
+    void parallelFor(uint32_t count, const std::function<void(uint32_t index)>& task);
+
+  private:
+    void workerLoop();
+    void runTasks();
+
+    std::vector<std::thread> m_threads;
+
+    const std::function<void(uint32_t)>* m_task = nullptr;
+    uint32_t m_taskCount = 0;
+    std::atomic<uint32_t> m_nextIndex = 0;
+
+    // Bumped for every loop, workers wait for it to change
+    std::atomic<uint32_t> m_generation = 0;
+    // Workers which are done with the current loop, the loop only returns once all of them are so that none can still pick up an index
+    std::atomic<uint32_t> m_finishedWorkers = 0;
+
+    std::atomic<bool> m_stop = false;
+};
@@ -1,6 +1,7 @@
-
 #pragma once
 
+#include "video_input/frame.h"
+
 class IVideoStreamSampleConsumer
 {
   public:
@@ -8,3 +9,29 @@ class IVideoStreamSampleConsumer
 
     virtual void onEncodedSampleAvailable(std::chrono::nanoseconds originalTimeStamp, const std::vector<std::byte>& sample, uint64_t frameId, const std::vector<std::byte>& sequenceParameters) = 0;
 };
+
+// Part of the captured frame which is streamed, in coordinates of the captured frame. An empty rectangle streams the whole frame.
+struct RegionOfInterest
+{
+    FrameRect rect;
+
+    // Scale the region up to the full frame size (digital zoom), otherwise the stream's frame size changes to the region's
+    bool zoom = false;
+};
+
+// Lets the viewers change how a stream is produced while it is running
+class IVideoStreamControl
+{
+  public:
+    virtual ~IVideoStreamControl() = default;
+
+    // Called on the control plane threads, returns false if the region can't be streamed
+    virtual bool setRegionOfInterest(const RegionOfInterest& regionOfInterest) = 0;
+
+    // Burns the frame id, capture time and latency into the frames, from the next frame on
+    virtual bool setOverlay(bool enabled) = 0;
+
+    // Makes one of the next frames an IDR frame, so that viewers who just joined can start decoding. Requests
+    // which arrive before it was encoded are served by the same frame.
+    virtual void requestKeyFrame() = 0;
+};
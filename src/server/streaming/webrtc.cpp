@@ -10,8 +10,38 @@
 
 #include <ctime>
 
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
 namespace
 {
+// A key frame request which wasn't answered by an IDR frame within this time, e.g. because the encoder was just
+// restarting, is passed on again by the next tick or the next request, whichever comes first
+constexpr std::chrono::milliseconds KeyFrameRequestTimeout(1000);
+
+// True if the first slice of the Annex-B sample belongs to an IDR picture, the parameter sets and SEI in front of it are skipped
+bool IsIDRSample(const std::vector<std::byte>& sample)
+{
+    for (size_t i = 0; i + 3 < sample.size(); ++i)
+    {
+        // Four byte start codes end with a three byte one
+        if (sample[i] == std::byte{0} && sample[i + 1] == std::byte{0} && sample[i + 2] == std::byte{1})
+        {
+            const uint32_t nalType = uint32_t(sample[i + 3]) & 0x1f;
+            if (nalType == 5 || nalType == 1)
+            {
+                return nalType == 5;
+            }
+
+            i += 2;
+        }
+    }
+
+    return false;
+}
+
+#ifdef _WIN32
 // taken from https://stackoverflow.com/questions/10905892/equivalent-of-gettimeday-for-windows
 
 struct timezone
@@ -46,6 +76,7 @@ int gettimeofday(struct timeval* tv, struct timezone* tz)
     }
     return 0;
 }
+#endif
 
 std::chrono::microseconds currentTime()
 {
@@ -69,7 +100,10 @@ class WebRTCConnection
         Disconnected
     };
 
-    WebRTCConnection(uint64_t index, std::chrono::nanoseconds startTimeStamp, double frameTime) : m_index(index), m_startTimeStamp(startTimeStamp), m_frameTime(frameTime)
+    WebRTCConnection(uint64_t index, const std::string& streamName, std::chrono::nanoseconds startTimeStamp, std::function<void(const std::string&)> onControlMessage,
+                     std::function<void()> onVideoTrackOpen)
+        : m_index(index), m_streamName(streamName), m_startTimeStamp(startTimeStamp), m_onControlMessage(std::move(onControlMessage)),
+          m_onVideoTrackOpen(std::move(onVideoTrackOpen))
     {
         rtc::Configuration config = {};
         config.portRangeBegin = 40000;
@@ -104,7 +138,7 @@ class WebRTCConnection
                 {
                     auto localDesc = m_peerConnection->localDescription();
 
-                    json offer = {{"type", localDesc->typeString()}, {"sdp", std::string(localDesc.value())}, {"index", m_index}};
+                    json offer = {{"type", localDesc->typeString()}, {"sdp", std::string(localDesc.value())}, {"index", m_index}, {"stream", m_streamName}};
 
                     m_offer = offer.dump();
                     m_hasOfferAvailable.store(true);
@@ -134,6 +168,8 @@ class WebRTCConnection
                     m_videoSrReporter->startRecording();
 
                     m_videoTrackAvailable = true;
+
+                    m_onVideoTrackOpen();
                 });
 
             auto rtpConfig = std::make_shared<rtc::RtpPacketizationConfig>(ssrc, cname, payloadType, rtc::H264RtpPacketizer::defaultClockRate);
@@ -159,6 +195,9 @@ class WebRTCConnection
                 m_dataChannelAvailable = true;
             });
 
+        // Text messages from the viewer are control requests, e.g. a new region of interest
+        m_dataChannel->onMessage([](rtc::binary) {}, [this](rtc::string message) { m_onControlMessage(message); });
+
         m_peerConnection->setLocalDescription();
     }
 
@@ -233,8 +272,15 @@ class WebRTCConnection
         if (!m_videoTrackAvailable)
             return;
 
-        // First update the time stamps
-        auto elapsedSeconds = m_frameCount * m_frameTime;
+        // A connection created before the stream sent anything starts with its first sample
+        if (m_frameCount == 0 && (m_startTimeStamp.count() == 0 || timeStamp < m_startTimeStamp))
+        {
+            m_startTimeStamp = timeStamp;
+        }
+
+        // First update the time stamps. They follow the capture time, so frames which were skipped or dropped
+        // before encoding leave a gap instead of slowing down the playback.
+        auto elapsedSeconds = std::max(std::chrono::duration<double>(timeStamp - m_startTimeStamp).count(), 0.0);
         auto rtpConfig = m_videoSrReporter->rtpConfig;
         uint32_t elapsedTimeStamp = rtpConfig->secondsToTimestamp(elapsedSeconds);
 
@@ -261,6 +307,7 @@ class WebRTCConnection
 
   private:
     uint64_t m_index = 0;
+    std::string m_streamName;
     std::chrono::nanoseconds m_startTimeStamp;
     std::atomic<State> m_state = State::WaitingForConnection;
     std::atomic<bool> m_hasOfferAvailable = false;
@@ -274,7 +321,9 @@ class WebRTCConnection
     std::shared_ptr<rtc::RtcpSrReporter> m_videoSrReporter;
 
     uint64_t m_frameCount = 0;
-    double m_frameTime = 0;
+
+    std::function<void(const std::string&)> m_onControlMessage;
+    std::function<void()> m_onVideoTrackOpen;
 };
 
 // The signaling web server is used to handle the offer and response
@@ -292,9 +341,11 @@ class SignalingWebServer
         virtual bool handleGet([[maybe_unused]] CivetServer* server, struct mg_connection* connection, int* status_code) override
         {
             char authToken[128] = {0};
+            char streamName[256] = {0};
             if (mg_get_request_info(connection)->query_string)
             {
                 mg_get_var2(mg_get_request_info(connection)->query_string, std::strlen(mg_get_request_info(connection)->query_string), "authToken", authToken, sizeof(authToken), 0);
+                mg_get_var2(mg_get_request_info(connection)->query_string, std::strlen(mg_get_request_info(connection)->query_string), "stream", streamName, sizeof(streamName), 0);
             }
 
             // We make a simple auth against a hard coded token, just to avoid spawning connections which shouldn't be there
@@ -307,8 +358,19 @@ class SignalingWebServer
                 return true;
             }
 
+            auto stream = m_server.m_webRtcServer.getStream(streamName);
+
+            if (!stream)
+            {
+                *status_code = 404;
+                mg_printf(connection, "HTTP/1.1 404 OK\r\nContent-Type: text/json\r\nConnection: close\r\n\r\n");
+                mg_printf(connection, "{}");
+
+                return true;
+            }
+
             // Create a new WebRTC streaming connection
-            auto streamingConnection = m_server.m_webRtcServer.createConnectionInstance();
+            auto streamingConnection = m_server.m_webRtcServer.createConnectionInstance(stream);
 
             // Wait until the WebRTC stack has set up the offer that the browser needs
             // on the remote side.
@@ -384,15 +446,177 @@ class SignalingWebServer
         SignalingWebServer& m_server;
     };
 
+    // Lists the names of all streams, so that the viewer can pick one
+    class StreamsHandler : public CivetHandler
+    {
+      public:
+        StreamsHandler(SignalingWebServer& server) : m_server(server)
+        {
+        }
+
+        virtual bool handleGet([[maybe_unused]] CivetServer* server, struct mg_connection* connection, int* status_code) override
+        {
+            std::string streams = json(m_server.m_webRtcServer.getStreamNames()).dump();
+
+            *status_code = 200;
+            mg_printf(connection, "HTTP/1.1 200 OK\r\nContent-Type: text/json\r\nConnection: close\r\n\r\n");
+            mg_write(connection, streams.c_str(), streams.size());
+
+            return true;
+        }
+
+      private:
+        SignalingWebServer& m_server;
+    };
+
+    // Sets the region of interest of a stream, e.g. /roi?authToken=...&stream=...&x=0&y=0&width=960&height=540&zoom=1.
+    // Leaving out the size streams the whole frame again.
+    class RegionOfInterestHandler : public CivetHandler
+    {
+      public:
+        RegionOfInterestHandler(SignalingWebServer& server) : m_server(server)
+        {
+        }
+
+        virtual bool handleGet([[maybe_unused]] CivetServer* server, struct mg_connection* connection, int* status_code) override
+        {
+            const char* queryString = mg_get_request_info(connection)->query_string;
+
+            char authToken[128] = {0};
+            char streamName[256] = {0};
+            if (queryString)
+            {
+                mg_get_var2(queryString, std::strlen(queryString), "authToken", authToken, sizeof(authToken), 0);
+                mg_get_var2(queryString, std::strlen(queryString), "stream", streamName, sizeof(streamName), 0);
+            }
+
+            if (std::strcmp(authToken, "PPSVideoMirror"))
+            {
+                *status_code = 403;
+                mg_printf(connection, "HTTP/1.1 403 OK\r\nContent-Type: text/json\r\nConnection: close\r\n\r\n");
+                mg_printf(connection, "{}");
+
+                return true;
+            }
+
+            auto stream = m_server.m_webRtcServer.getStream(streamName);
+
+            if (!stream)
+            {
+                *status_code = 404;
+                mg_printf(connection, "HTTP/1.1 404 OK\r\nContent-Type: text/json\r\nConnection: close\r\n\r\n");
+                mg_printf(connection, "{}");
+
+                return true;
+            }
+
+            auto getValue = [queryString](const char* name) -> uint32_t
+            {
+                char value[32] = {0};
+                mg_get_var2(queryString, std::strlen(queryString), name, value, sizeof(value), 0);
+                return static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+            };
+
+            RegionOfInterest regionOfInterest;
+            regionOfInterest.rect = {getValue("x"), getValue("y"), getValue("width"), getValue("height")};
+            regionOfInterest.zoom = getValue("zoom") != 0;
+
+            if (!stream->setRegionOfInterest(regionOfInterest))
+            {
+                *status_code = 400;
+                mg_printf(connection, "HTTP/1.1 400 OK\r\nContent-Type: text/json\r\nConnection: close\r\n\r\n");
+                mg_printf(connection, "{}");
+
+                return true;
+            }
+
+            *status_code = 200;
+            mg_printf(connection, "HTTP/1.1 200 OK\r\nContent-Type: text/json\r\nConnection: close\r\n\r\n");
+            mg_printf(connection, "{}");
+
+            return true;
+        }
+
+      private:
+        SignalingWebServer& m_server;
+    };
+
+    // Turns the overlay of a stream on or off, e.g. /overlay?authToken=...&stream=...&enabled=1
+    class OverlayHandler : public CivetHandler
+    {
+      public:
+        OverlayHandler(SignalingWebServer& server) : m_server(server)
+        {
+        }
+
+        virtual bool handleGet([[maybe_unused]] CivetServer* server, struct mg_connection* connection, int* status_code) override
+        {
+            const char* queryString = mg_get_request_info(connection)->query_string;
+
+            char authToken[128] = {0};
+            char streamName[256] = {0};
+            char enabled[8] = {0};
+            if (queryString)
+            {
+                mg_get_var2(queryString, std::strlen(queryString), "authToken", authToken, sizeof(authToken), 0);
+                mg_get_var2(queryString, std::strlen(queryString), "stream", streamName, sizeof(streamName), 0);
+                mg_get_var2(queryString, std::strlen(queryString), "enabled", enabled, sizeof(enabled), 0);
+            }
+
+            if (std::strcmp(authToken, "PPSVideoMirror"))
+            {
+                *status_code = 403;
+                mg_printf(connection, "HTTP/1.1 403 OK\r\nContent-Type: text/json\r\nConnection: close\r\n\r\n");
+                mg_printf(connection, "{}");
+
+                return true;
+            }
+
+            auto stream = m_server.m_webRtcServer.getStream(streamName);
+
+            if (!stream)
+            {
+                *status_code = 404;
+                mg_printf(connection, "HTTP/1.1 404 OK\r\nContent-Type: text/json\r\nConnection: close\r\n\r\n");
+                mg_printf(connection, "{}");
+
+                return true;
+            }
+
+            if (!stream->setOverlay(std::strtoul(enabled, nullptr, 10) != 0))
+            {
+                *status_code = 400;
+                mg_printf(connection, "HTTP/1.1 400 OK\r\nContent-Type: text/json\r\nConnection: close\r\n\r\n");
+                mg_printf(connection, "{}");
+
+                return true;
+            }
+
+            *status_code = 200;
+            mg_printf(connection, "HTTP/1.1 200 OK\r\nContent-Type: text/json\r\nConnection: close\r\n\r\n");
+            mg_printf(connection, "{}");
+
+            return true;
+        }
+
+      private:
+        SignalingWebServer& m_server;
+    };
+
   public:
-    SignalingWebServer(WebRTCServer& webRtcServer) : m_webRtcServer(webRtcServer), m_offerHandler(*this), m_answerHandler(*this)
+    SignalingWebServer(WebRTCServer& webRtcServer)
+        : m_webRtcServer(webRtcServer), m_offerHandler(*this), m_answerHandler(*this), m_streamsHandler(*this), m_regionOfInterestHandler(*this), m_overlayHandler(*this)
     {
-        const char* serverOptions[] = {"document_root", ".\\src\\server\\www\\", "listening_ports", "8081", nullptr};
+        // Relative to the working directory, which is the repository root. Civetweb takes forward slashes on every platform.
+        const char* serverOptions[] = {"document_root", "src/server/www", "listening_ports", "8081", nullptr};
 
         m_webServer = std::make_unique<CivetServer>(serverOptions);
 
         m_webServer->addHandler("/offer", m_offerHandler);
         m_webServer->addHandler("/answer", m_answerHandler);
+        m_webServer->addHandler("/streams", m_streamsHandler);
+        m_webServer->addHandler("/roi", m_regionOfInterestHandler);
+        m_webServer->addHandler("/overlay", m_overlayHandler);
     }
 
     ~SignalingWebServer()
@@ -404,70 +628,57 @@ class SignalingWebServer
 
   private:
     friend OfferHandler;
+    friend AnswerHandler;
+    friend StreamsHandler;
+    friend RegionOfInterestHandler;
+    friend OverlayHandler;
 
     WebRTCServer& m_webRtcServer;
 
     OfferHandler m_offerHandler;
     AnswerHandler m_answerHandler;
+    StreamsHandler m_streamsHandler;
+    RegionOfInterestHandler m_regionOfInterestHandler;
+    OverlayHandler m_overlayHandler;
 
     std::unique_ptr<CivetServer> m_webServer;
 };
 
-WebRTCServer::WebRTCServer() = default;
-
-WebRTCServer::~WebRTCServer() = default;
-
-bool WebRTCServer::init(Ratio frameRate)
+WebRTCStream::WebRTCStream(const std::string& name) : m_name(name)
 {
-    m_frameRate = frameRate;
-
-    m_signalingWebServer = std::make_unique<SignalingWebServer>(*this);
-
-    rtc::InitLogger(rtc::LogLevel::Info,
-                    [](rtc::LogLevel level, std::string message) -> void
-                    {
-                        switch (level)
-                        {
-                        case rtc::LogLevel::Fatal:
-                        case rtc::LogLevel::Error:
-                            error("WebRTC", message.c_str());
-                            break;
-                        case rtc::LogLevel::Warning:
-                            warning("WebRTC", message.c_str());
-                            break;
-                        case rtc::LogLevel::Info:
-                        case rtc::LogLevel::Verbose:
-                        case rtc::LogLevel::Debug:
-                            info("WebRTC", message.c_str());
-                            break;
-                        }
-                    });
-
-    return true;
 }
 
-void WebRTCServer::shutdown()
-{
-    m_signalingWebServer = nullptr;
+WebRTCStream::~WebRTCStream() = default;
 
+void WebRTCStream::onEncodedSampleAvailable(std::chrono::nanoseconds originalTimeStamp, const std::vector<std::byte>& sample, uint64_t frameId, const std::vector<std::byte>& sequenceParameters)
+{
+    // Cleared before sending, a viewer whose request comes in meanwhile might miss this IDR frame and gets another one
     {
-        std::lock_guard _(m_connectionMutex);
-        m_connections.clear();
+        std::lock_guard _(m_keyFrameMutex);
+
+        if (m_keyFrameRequestTime && ::IsIDRSample(sample))
+        {
+            if (m_coalescedKeyFrameRequests > 0)
+            {
+                info("WebRTC", "IDR frame of stream '%s' also serves %d more new viewers.", m_name.c_str(), int(m_coalescedKeyFrameRequests));
+            }
+
+            m_keyFrameRequestTime.reset();
+            m_coalescedKeyFrameRequests = 0;
+        }
     }
-}
 
-void WebRTCServer::onEncodedSampleAvailable(std::chrono::nanoseconds originalTimeStamp, const std::vector<std::byte>& sample, uint64_t frameId, const std::vector<std::byte>& sequenceParameters)
-{
     broadCastVideoSample(originalTimeStamp, sample, sequenceParameters);
 
     tick();
 }
 
-WebRTCConnection* WebRTCServer::createConnectionInstance()
+WebRTCConnection* WebRTCStream::createConnectionInstance(uint64_t index)
 {
-    double frameTime = 1.0f / m_frameRate.asFloat();
-
-    auto connection = std::make_unique<WebRTCConnection>(m_nextConnectionIndex++, m_lastSentSampleTimeStamp, frameTime);
+    // The viewer's decoder needs an IDR frame to start with. It is requested once the video track is open,
+    // an earlier one would be sent before the viewer can receive it.
+    auto connection = std::make_unique<WebRTCConnection>(
+        index, m_name, m_lastSentSampleTimeStamp.load(), [this](const std::string& message) { handleControlMessage(message); }, [this]() { requestKeyFrame(); });
 
     auto retVal = connection.get();
 
@@ -479,7 +690,7 @@ WebRTCConnection* WebRTCServer::createConnectionInstance()
     return retVal;
 }
 
-WebRTCConnection* WebRTCServer::getConnectionByIndex(uint64_t index) const
+WebRTCConnection* WebRTCStream::getConnectionByIndex(uint64_t index) const
 {
     std::lock_guard _(m_connectionMutex);
 
@@ -493,7 +704,103 @@ WebRTCConnection* WebRTCServer::getConnectionByIndex(uint64_t index) const
     return (*it).second.get();
 }
 
-void WebRTCServer::broadCastJSON(const std::string& json)
+void WebRTCStream::closeConnections()
+{
+    std::lock_guard _(m_connectionMutex);
+    m_connections.clear();
+}
+
+bool WebRTCStream::setRegionOfInterest(const RegionOfInterest& regionOfInterest)
+{
+    IVideoStreamControl* control = m_control;
+
+    if (!control)
+    {
+        warning("WebRTC", "Stream '%s' can't change its region of interest.", m_name.c_str());
+        return false;
+    }
+
+    return control->setRegionOfInterest(regionOfInterest);
+}
+
+bool WebRTCStream::setOverlay(bool enabled)
+{
+    IVideoStreamControl* control = m_control;
+
+    if (!control)
+    {
+        warning("WebRTC", "Stream '%s' can't show an overlay.", m_name.c_str());
+        return false;
+    }
+
+    return control->setOverlay(enabled);
+}
+
+void WebRTCStream::requestKeyFrame()
+{
+    {
+        std::lock_guard _(m_keyFrameMutex);
+
+        // The first request goes to the encoder right away, the ones until its IDR frame is sent are served by the same frame
+        const auto now = std::chrono::steady_clock::now();
+        if (m_keyFrameRequestTime && now - *m_keyFrameRequestTime < KeyFrameRequestTimeout)
+        {
+            ++m_coalescedKeyFrameRequests;
+            return;
+        }
+
+        m_keyFrameRequestTime = now;
+        m_coalescedKeyFrameRequests = 0;
+    }
+
+    if (IVideoStreamControl* control = m_control)
+    {
+        info("WebRTC", "Requesting an IDR frame for a new viewer of stream '%s'.", m_name.c_str());
+        control->requestKeyFrame();
+    }
+}
+
+void WebRTCStream::handleControlMessage(const std::string& message)
+{
+    // Messages look like {"type": "regionOfInterest", "x": 0, "y": 0, "width": 960, "height": 540, "zoom": true}
+    // or {"type": "overlay", "enabled": true}
+    auto request = json::parse(message, nullptr, false);
+
+    // Reading a field of the wrong type throws, so each field is checked first. Missing ones keep their defaults.
+    auto isUnsigned = [&request](const char* key)
+    {
+        auto it = request.find(key);
+        return it == request.end() || it->is_number_unsigned();
+    };
+
+    auto isBoolean = [&request](const char* key)
+    {
+        auto it = request.find(key);
+        return it == request.end() || it->is_boolean();
+    };
+
+    const auto typeField = request.find("type");
+    const std::string type = typeField != request.end() && typeField->is_string() ? typeField->get<std::string>() : "";
+
+    if (type == "regionOfInterest" && isUnsigned("x") && isUnsigned("y") && isUnsigned("width") && isUnsigned("height") && isBoolean("zoom"))
+    {
+        RegionOfInterest regionOfInterest;
+        regionOfInterest.rect = {request.value("x", 0u), request.value("y", 0u), request.value("width", 0u), request.value("height", 0u)};
+        regionOfInterest.zoom = request.value("zoom", false);
+
+        setRegionOfInterest(regionOfInterest);
+    }
+    else if (type == "overlay" && isBoolean("enabled"))
+    {
+        setOverlay(request.value("enabled", false));
+    }
+    else
+    {
+        warning("WebRTC", "Ignoring unknown or malformed control message on stream '%s'.", m_name.c_str());
+    }
+}
+
+void WebRTCStream::broadCastJSON(const std::string& json)
 {
     // Loop through all active connections and send them the JSON data
     // this is used to broadcast POI positions for example.
@@ -507,7 +814,7 @@ void WebRTCServer::broadCastJSON(const std::string& json)
     }
 }
 
-void WebRTCServer::broadCastVideoSample(std::chrono::nanoseconds originalTimeStamp, const std::vector<std::byte>& sample, const std::vector<std::byte>& sequenceParameters)
+void WebRTCStream::broadCastVideoSample(std::chrono::nanoseconds originalTimeStamp, const std::vector<std::byte>& sample, const std::vector<std::byte>& sequenceParameters)
 {
     m_lastSentSampleTimeStamp = originalTimeStamp;
 
@@ -522,8 +829,33 @@ void WebRTCServer::broadCastVideoSample(std::chrono::nanoseconds originalTimeSta
     }
 }
 
-void WebRTCServer::tick()
+void WebRTCStream::tick()
 {
+    // Viewers waiting for the IDR frame, none while no request is pending or it isn't overdue yet
+    uint32_t waitingViewers = 0;
+
+    {
+        std::lock_guard _(m_keyFrameMutex);
+
+        // A request whose IDR frame never came is passed on again, also when it was the only one, since its viewer is
+        // still waiting for it
+        const auto now = std::chrono::steady_clock::now();
+        if (m_keyFrameRequestTime && now - *m_keyFrameRequestTime >= KeyFrameRequestTimeout)
+        {
+            waitingViewers = 1 + std::exchange(m_coalescedKeyFrameRequests, 0);
+            m_keyFrameRequestTime = now;
+        }
+    }
+
+    if (waitingViewers > 0)
+    {
+        if (IVideoStreamControl* control = m_control)
+        {
+            warning("WebRTC", "No IDR frame came for stream '%s', requesting another one for %d waiting viewers.", m_name.c_str(), int(waitingViewers));
+            control->requestKeyFrame();
+        }
+    }
+
     {
         std::lock_guard _(m_connectionMutex);
 
@@ -532,7 +864,7 @@ void WebRTCServer::tick()
         {
             if (it->second->getState() == WebRTCConnection::State::Disconnected)
             {
-                info("WebRTC", "Cleaning up connection %d since it's disconnected.", it->first);
+                info("WebRTC", "Cleaning up connection %d of stream '%s' since it's disconnected.", it->first, m_name.c_str());
                 it = m_connections.erase(it);
             }
             else
@@ -542,3 +874,122 @@ void WebRTCServer::tick()
         }
     }
 }
+
+WebRTCServer::WebRTCServer() = default;
+
+WebRTCServer::~WebRTCServer() = default;
+
+bool WebRTCServer::init()
+{
+    m_signalingWebServer = std::make_unique<SignalingWebServer>(*this);
+
+    rtc::InitLogger(rtc::LogLevel::Info,
+                    [](rtc::LogLevel level, std::string message) -> void
+                    {
+                        switch (level)
+                        {
+                        case rtc::LogLevel::Fatal:
+                        case rtc::LogLevel::Error:
+                            error("WebRTC", message.c_str());
+                            break;
+                        case rtc::LogLevel::Warning:
+                            warning("WebRTC", message.c_str());
+                            break;
+                        case rtc::LogLevel::Info:
+                        case rtc::LogLevel::Verbose:
+                        case rtc::LogLevel::Debug:
+                            info("WebRTC", message.c_str());
+                            break;
+                        }
+                    });
+
+    return true;
+}
+
+void WebRTCServer::shutdown()
+{
+    m_signalingWebServer = nullptr;
+
+    std::lock_guard _(m_streamMutex);
+
+    for (auto& stream : m_streams)
+    {
+        stream->closeConnections();
+    }
+
+    m_streams.clear();
+}
+
+WebRTCStream* WebRTCServer::addStream(const std::string& name)
+{
+    std::lock_guard _(m_streamMutex);
+
+    for (const auto& stream : m_streams)
+    {
+        if (stream->getName() == name)
+        {
+            error("WebRTC", "There already is a stream named '%s'.", name.c_str());
+            return nullptr;
+        }
+    }
+
+    info("WebRTC", "Adding stream '%s'.", name.c_str());
+
+    m_streams.push_back(std::make_unique<WebRTCStream>(name));
+
+    return m_streams.back().get();
+}
+
+WebRTCStream* WebRTCServer::getStream(const std::string& name) const
+{
+    std::lock_guard _(m_streamMutex);
+
+    if (name.empty())
+    {
+        return m_streams.empty() ? nullptr : m_streams.front().get();
+    }
+
+    for (const auto& stream : m_streams)
+    {
+        if (stream->getName() == name)
+        {
+            return stream.get();
+        }
+    }
+
+    return nullptr;
+}
+
+std::vector<std::string> WebRTCServer::getStreamNames() const
+{
+    std::lock_guard _(m_streamMutex);
+
+    std::vector<std::string> retVal;
+
+    for (const auto& stream : m_streams)
+    {
+        retVal.push_back(stream->getName());
+    }
+
+    return retVal;
+}
+
+WebRTCConnection* WebRTCServer::createConnectionInstance(WebRTCStream* stream)
+{
+    return stream->createConnectionInstance(m_nextConnectionIndex++);
+}
+
+WebRTCConnection* WebRTCServer::getConnectionByIndex(uint64_t index) const
+{
+    std::lock_guard _(m_streamMutex);
+
+    for (const auto& stream : m_streams)
+    {
+        if (auto connection = stream->getConnectionByIndex(index))
+        {
+            return connection;
+        }
+    }
+
+    return nullptr;
+}
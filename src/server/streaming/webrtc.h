@@ -1,4 +1,3 @@
-
 #pragma once
 
 #include "streaming.h"
@@ -6,36 +5,95 @@
 class SignalingWebServer;
 class WebRTCConnection;
 
-class WebRTCServer : public IVideoStreamSampleConsumer
+// One named video stream which is fanned out to all of its connected viewers
+class WebRTCStream : public IVideoStreamSampleConsumer
 {
   public:
-    WebRTCServer();
-    ~WebRTCServer();
+    WebRTCStream(const std::string& name);
+    ~WebRTCStream();
 
-    bool init(Ratio frameRate);
-    void shutdown();
+    const std::string& getName() const
+    {
+        return m_name;
+    }
 
     virtual void onEncodedSampleAvailable(std::chrono::nanoseconds originalTimeStamp, const std::vector<std::byte>& sample, uint64_t frameId,
                                           const std::vector<std::byte>& sequenceParameters) override;
 
+    // Receives the requests of the viewers which arrive over HTTP or the data channel
+    void setControl(IVideoStreamControl* control)
+    {
+        m_control = control;
+    }
+
   private:
     friend SignalingWebServer;
+    friend class WebRTCServer;
 
-    WebRTCConnection* createConnectionInstance();
+    WebRTCConnection* createConnectionInstance(uint64_t index);
     WebRTCConnection* getConnectionByIndex(uint64_t index) const;
 
+    void closeConnections();
+
+    bool setRegionOfInterest(const RegionOfInterest& regionOfInterest);
+    bool setOverlay(bool enabled);
+
+    // Called when a viewer can receive video. The first request is passed on to the encoder right away, the ones which arrive
+    // before its IDR frame is sent are served by it, so a burst of viewers joining at once costs a single IDR frame.
+    void requestKeyFrame();
+
+    // Handles a JSON request a viewer sent over the data channel
+    void handleControlMessage(const std::string& message);
+
     void broadCastJSON(const std::string& json);
     void broadCastVideoSample(std::chrono::nanoseconds originalTimeStamp, const std::vector<std::byte>& sample, const std::vector<std::byte>& sequenceParameters);
 
     void tick();
 
-    std::unique_ptr<SignalingWebServer> m_signalingWebServer;
+    std::string m_name;
 
     mutable std::mutex m_connectionMutex;
     std::unordered_map<uint64_t, std::unique_ptr<WebRTCConnection>> m_connections;
-    std::uint64_t m_nextConnectionIndex = 0;
 
-    std::chrono::nanoseconds m_lastSentSampleTimeStamp;
+    // Written by the encoder's thread, read when the web server's thread creates a connection
+    std::atomic<std::chrono::nanoseconds> m_lastSentSampleTimeStamp{std::chrono::nanoseconds{0}};
+
+    std::atomic<IVideoStreamControl*> m_control = nullptr;
+
+    // When the pending IDR frame was requested, empty while none is pending, and the requests it serves in addition
+    std::mutex m_keyFrameMutex;
+    std::optional<std::chrono::steady_clock::time_point> m_keyFrameRequestTime;
+    uint32_t m_coalescedKeyFrameRequests = 0;
+};
+
+// Owns the signaling web server which is shared by all streams, viewers pick a stream by its name
+class WebRTCServer
+{
+  public:
+    WebRTCServer();
+    ~WebRTCServer();
+
+    bool init();
+    void shutdown();
+
+    // Stream names need to be unique, returns nullptr if the name is already taken
+    WebRTCStream* addStream(const std::string& name);
+
+  private:
+    friend SignalingWebServer;
+
+    // Returns the first stream if no name is given
+    WebRTCStream* getStream(const std::string& name) const;
+    std::vector<std::string> getStreamNames() const;
+
+    WebRTCConnection* createConnectionInstance(WebRTCStream* stream);
+    WebRTCConnection* getConnectionByIndex(uint64_t index) const;
+
+    std::unique_ptr<SignalingWebServer> m_signalingWebServer;
+
+    mutable std::mutex m_streamMutex;
+    std::vector<std::unique_ptr<WebRTCStream>> m_streams;
 
-    Ratio m_frameRate;
+    // Connection indices are unique across all streams so that answers can be matched without the stream name
+    std::atomic<uint64_t> m_nextConnectionIndex = 0;
 };
@@ -0,0 +1,126 @@
+// Times the conversion of a 1080p RGB24 frame to BGRA: ConvertToBGRAReference() against every expansion kernel level the
+// CPU supports and against the dispatched ConvertToBGRA(). Every level's output is compared with the reference first,
+// a mismatch makes the benchmark exit with a non-zero code.
+
+#include "conversion/bgra.h"
+#include "conversion/bgra_kernels.h"
+#include "conversion/cpu_features.h"
+
+#include <random>
+
+namespace
+{
+constexpr uint32_t Width = 1920;
+constexpr uint32_t Height = 1080;
+constexpr uint32_t Runs = 50;
+
+// Median duration of the runs, which ignores the outliers of a busy machine
+template <typename Function>
+double MeasureMilliseconds(Function&& function)
+{
+    std::vector<double> durations;
+    durations.reserve(Runs);
+
+    for (uint32_t i = 0; i < Runs; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        durations.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    std::sort(durations.begin(), durations.end());
+    return durations[Runs / 2];
+}
+
+struct Benchmark
+{
+    std::vector<std::byte> expected;
+    std::vector<std::byte> actual;
+    double referenceMilliseconds = 0;
+    uint32_t mismatchCount = 0;
+
+    // Converts with the function, compares the result with the reference and logs the time next to the reference's
+    template <typename Function>
+    void run(const char* name, Function&& convert)
+    {
+        std::fill(actual.begin(), actual.end(), std::byte{0xcd});
+        convert();
+
+        if (actual != expected)
+        {
+            error("BENCH", "%s differs from the reference.", name);
+            ++mismatchCount;
+            return;
+        }
+
+        const double milliseconds = ::MeasureMilliseconds(convert);
+        info("BENCH", "%-28s %7.3f ms per frame, %5.2fx the reference", name, milliseconds, referenceMilliseconds / milliseconds);
+    }
+};
+
+// Runs a kernel on every row of the frame, like ConvertToBGRA() does with the kernel it selected
+void ExpandRows(ExpandRowKernel kernel, const Frame& frame, std::byte* dst, size_t dstPitch)
+{
+    const Frame::Plane& plane = frame.planes[0];
+    for (uint32_t y = 0; y < frame.height; ++y)
+    {
+        kernel(reinterpret_cast<const uint8_t*>(plane.getRow(y)), reinterpret_cast<uint8_t*>(dst + y * dstPitch), frame.width);
+    }
+}
+} // namespace
+
+int main()
+{
+    std::mt19937 random(2024);
+
+    std::vector<uint8_t> data(size_t(Width) * Height * 3);
+    for (auto& byte : data)
+    {
+        byte = uint8_t(random());
+    }
+
+    auto framePool = FramePool::create();
+    FrameRef frame = framePool->acquire();
+    frame->videoFormat = IDevice::VideoFormat::RGB24;
+    frame->width = Width;
+    frame->height = Height;
+    frame->setPackedData(data.data(), data.size());
+
+    const size_t dstPitch = size_t(Width) * 4;
+
+    Benchmark benchmark;
+    benchmark.expected.resize(dstPitch * Height);
+    benchmark.actual.resize(dstPitch * Height);
+
+    ConvertToBGRAReference(*frame, benchmark.expected.data(), dstPitch);
+    benchmark.referenceMilliseconds = ::MeasureMilliseconds([&]() { ConvertToBGRAReference(*frame, benchmark.expected.data(), dstPitch); });
+
+    info("BENCH", "RGB24 to BGRA at %d x %d, median of %d runs:", Width, Height, Runs);
+    info("BENCH", "%-28s %7.3f ms per frame", "ConvertToBGRAReference", benchmark.referenceMilliseconds);
+
+    std::byte* dst = benchmark.actual.data();
+    benchmark.run("RGB24ToBGRARow_C", [&]() { ::ExpandRows(RGB24ToBGRARow_C, *frame, dst, dstPitch); });
+
+#ifdef CPU_X86_64
+    const CpuFeatures& cpu = GetCpuFeatures();
+
+    if (cpu.ssse3)
+    {
+        benchmark.run("RGB24ToBGRARow_SSSE3", [&]() { ::ExpandRows(RGB24ToBGRARow_SSSE3, *frame, dst, dstPitch); });
+    }
+
+    if (cpu.avx2)
+    {
+        benchmark.run("RGB24ToBGRARow_AVX2", [&]() { ::ExpandRows(RGB24ToBGRARow_AVX2, *frame, dst, dstPitch); });
+    }
+
+    if (cpu.avx512bw)
+    {
+        benchmark.run("RGB24ToBGRARow_AVX512", [&]() { ::ExpandRows(RGB24ToBGRARow_AVX512, *frame, dst, dstPitch); });
+    }
+#endif
+
+    benchmark.run("ConvertToBGRA", [&]() { ConvertToBGRA(*frame, dst, dstPitch); });
+
+    return benchmark.mismatchCount > 0 ? 1 : 0;
+}
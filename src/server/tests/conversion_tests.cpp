@@ -0,0 +1,833 @@
+// Checks the conversions to NV12 against their scalar reference: every SIMD kernel the CPU supports against its _C
+// variant, and ConvertToNV12() and NV12Converter against ConvertToNV12Reference() for all formats, odd sizes, padded
+// pitches and orientations, also split into bands on several threads with the overlay drawn per band. ConvertToBGRA()
+// is checked against ConvertToBGRAReference() the same way, NV12Scaler::scale() against scaleReference(),
+// Deinterlacer::deinterlace() against deinterlaceReference() and HashFrame() against HashFrameReference().
+// Exits with a non-zero code if any check fails.
+
+#include "conversion/bgra.h"
+#include "conversion/bgra_kernels.h"
+#include "conversion/cpu_features.h"
+#include "conversion/deinterlace.h"
+#include "conversion/frame_hash.h"
+#include "conversion/frame_hash_kernels.h"
+#include "conversion/nv12.h"
+#include "conversion/nv12_kernels.h"
+#include "conversion/scaler.h"
+#include "conversion/text_overlay.h"
+#include "video_input/video_format.h"
+
+#include <random>
+
+namespace
+{
+uint32_t g_checkCount = 0;
+uint32_t g_failureCount = 0;
+
+void Check(bool condition, const char* msg...)
+{
+    ++g_checkCount;
+    if (condition)
+    {
+        return;
+    }
+
+    ++g_failureCount;
+
+    char buf[1024];
+    va_list args;
+    va_start(args, msg);
+    std::vsnprintf(buf, sizeof(buf), msg, args);
+    va_end(args);
+
+    error("TEST", "%s", buf);
+}
+
+const char* GetOrientationName(Orientation orientation)
+{
+    return orientation.mirror ? (orientation.flip ? "rotated" : "mirrored") : (orientation.flip ? "flipped" : "upright");
+}
+
+constexpr Orientation Orientations[] = {{false, false}, {true, false}, {false, true}, {true, true}};
+
+std::vector<uint8_t> RandomBytes(std::mt19937& random, size_t size)
+{
+    std::vector<uint8_t> bytes(size);
+    for (auto& byte : bytes)
+    {
+        byte = uint8_t(random());
+    }
+
+    return bytes;
+}
+
+// Runs a SIMD kernel and its scalar variant on the same random rows and compares every byte they write
+struct RowPairKernelCase
+{
+    const char* name;
+    RowPairKernel kernel;
+    RowPairKernel reference;
+    uint32_t blockSize;
+    uint32_t bytesPerPixel;
+};
+
+void CheckRowPairKernel(const RowPairKernelCase& test, std::mt19937& random)
+{
+    for (uint32_t blocks : {1u, 2u, 3u, 5u})
+    {
+        const uint32_t width = test.blockSize * blocks;
+        const auto src0 = ::RandomBytes(random, size_t(width) * test.bytesPerPixel);
+        const auto src1 = ::RandomBytes(random, size_t(width) * test.bytesPerPixel);
+
+        // The rows are written back to back, so that writing past the end of one is caught by the next
+        std::vector<uint8_t> expected(width * 3, 0xcd);
+        std::vector<uint8_t> actual(width * 3, 0xcd);
+
+        test.reference(src0.data(), src1.data(), expected.data(), expected.data() + width, expected.data() + width * 2, width);
+        test.kernel(src0.data(), src1.data(), actual.data(), actual.data() + width, actual.data() + width * 2, width);
+
+        ::Check(expected == actual, "%s differs from the scalar kernel at a width of %d.", test.name, width);
+    }
+}
+
+struct RowKernelCase
+{
+    const char* name;
+    MirrorRowKernel kernel;
+    MirrorRowKernel reference;
+    uint32_t blockSize;
+    uint32_t srcElementSize;
+    uint32_t dstElementSize;
+};
+
+void CheckRowKernel(const RowKernelCase& test, std::mt19937& random)
+{
+    for (uint32_t blocks : {1u, 2u, 3u, 5u})
+    {
+        const uint32_t count = test.blockSize * blocks;
+        const auto src = ::RandomBytes(random, size_t(count) * test.srcElementSize);
+
+        std::vector<uint8_t> expected(size_t(count) * test.dstElementSize + 64, 0xcd);
+        std::vector<uint8_t> actual(expected.size(), 0xcd);
+
+        test.reference(src.data(), expected.data(), count);
+        test.kernel(src.data(), actual.data(), count);
+
+        ::Check(expected == actual, "%s differs from the scalar kernel for %d elements.", test.name, count);
+    }
+}
+
+void CheckInterleaveKernel(const char* name, InterleaveRowKernel kernel, InterleaveRowKernel reference, uint32_t blockSize, std::mt19937& random)
+{
+    for (uint32_t blocks : {1u, 2u, 3u, 5u})
+    {
+        const uint32_t chromaWidth = blockSize * blocks;
+        const auto srcU = ::RandomBytes(random, chromaWidth);
+        const auto srcV = ::RandomBytes(random, chromaWidth);
+
+        std::vector<uint8_t> expected(chromaWidth * 2 + 64, 0xcd);
+        std::vector<uint8_t> actual(expected.size(), 0xcd);
+
+        reference(srcU.data(), srcV.data(), expected.data(), chromaWidth);
+        kernel(srcU.data(), srcV.data(), actual.data(), chromaWidth);
+
+        ::Check(expected == actual, "%s differs from the scalar kernel for %d chroma samples.", name, chromaWidth);
+    }
+}
+
+void CheckHashKernel(const char* name, HashBlocksKernel kernel, std::mt19937& random)
+{
+    for (uint32_t blockCount : {1u, 2u, 3u, 17u})
+    {
+        const auto src = ::RandomBytes(random, blockCount * FrameHashBlockSize);
+
+        // Starts from keys and sums which aren't zero, like in the middle of a frame
+        FrameHashState expected;
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            expected.sums[i] = (uint64_t(random()) << 32) | random();
+            expected.keys[i] = (uint64_t(random()) << 32) | random();
+        }
+        FrameHashState actual = expected;
+
+        HashBlocks_C(src.data(), blockCount, expected);
+        kernel(src.data(), blockCount, actual);
+
+        ::Check(std::equal(std::begin(expected.sums), std::end(expected.sums), std::begin(actual.sums)) &&
+                    std::equal(std::begin(expected.keys), std::end(expected.keys), std::begin(actual.keys)),
+                "%s differs from the scalar kernel for %d blocks.", name, blockCount);
+    }
+}
+
+void CheckKernels(std::mt19937& random)
+{
+#ifdef CPU_X86_64
+    const CpuFeatures& cpu = GetCpuFeatures();
+
+    if (cpu.ssse3)
+    {
+        ::CheckRowPairKernel({"Yuy2ToNV12Row_SSSE3", Yuy2ToNV12Row_SSSE3, Yuy2ToNV12Row_C, 16, 2}, random);
+        ::CheckRowPairKernel({"UyvyToNV12Row_SSSE3", UyvyToNV12Row_SSSE3, UyvyToNV12Row_C, 16, 2}, random);
+        ::CheckInterleaveKernel("InterleaveUVRow_SSSE3", InterleaveUVRow_SSSE3, InterleaveUVRow_C, 16, random);
+        ::CheckRowKernel({"RGB24ToBGRARow_SSSE3", RGB24ToBGRARow_SSSE3, RGB24ToBGRARow_C, 16, 3, 4}, random);
+    }
+    else
+    {
+        info("TEST", "Skipping the SSSE3 kernels, the CPU doesn't support them.");
+    }
+
+    if (cpu.avx2)
+    {
+        ::CheckRowPairKernel({"Yuy2ToNV12Row_AVX2", Yuy2ToNV12Row_AVX2, Yuy2ToNV12Row_C, 32, 2}, random);
+        ::CheckRowPairKernel({"UyvyToNV12Row_AVX2", UyvyToNV12Row_AVX2, UyvyToNV12Row_C, 32, 2}, random);
+        ::CheckRowPairKernel({"BGRAToNV12Row_AVX2", BGRAToNV12Row_AVX2, BGRAToNV12Row_C, 32, 4}, random);
+        ::CheckRowPairKernel({"Yuy2ToNV12RowMirror_AVX2", Yuy2ToNV12RowMirror_AVX2, Yuy2ToNV12RowMirror_C, 32, 2}, random);
+        ::CheckRowPairKernel({"UyvyToNV12RowMirror_AVX2", UyvyToNV12RowMirror_AVX2, UyvyToNV12RowMirror_C, 32, 2}, random);
+        ::CheckRowPairKernel({"BGRAToNV12RowMirror_AVX2", BGRAToNV12RowMirror_AVX2, BGRAToNV12RowMirror_C, 32, 4}, random);
+        ::CheckInterleaveKernel("InterleaveUVRow_AVX2", InterleaveUVRow_AVX2, InterleaveUVRow_C, 32, random);
+        ::CheckInterleaveKernel("InterleaveUVRowMirror_AVX2", InterleaveUVRowMirror_AVX2, InterleaveUVRowMirror_C, 32, random);
+        ::CheckRowKernel({"MirrorRow8_AVX2", MirrorRow8_AVX2, MirrorRow8_C, 32, 1, 1}, random);
+        ::CheckRowKernel({"MirrorRow16_AVX2", MirrorRow16_AVX2, MirrorRow16_C, 32, 2, 2}, random);
+        ::CheckRowKernel({"NarrowRow_AVX2", NarrowRow_AVX2, NarrowRow_C, 32, 2, 1}, random);
+        ::CheckRowKernel({"NarrowRowMirror8_AVX2", NarrowRowMirror8_AVX2, NarrowRowMirror8_C, 32, 2, 1}, random);
+        ::CheckRowKernel({"NarrowRowMirror16_AVX2", NarrowRowMirror16_AVX2, NarrowRowMirror16_C, 32, 4, 2}, random);
+        ::CheckRowKernel({"RGB24ToBGRARow_AVX2", RGB24ToBGRARow_AVX2, RGB24ToBGRARow_C, 32, 3, 4}, random);
+        ::CheckRowKernel({"RGB24ToBGRARowMirror_AVX2", RGB24ToBGRARowMirror_AVX2, RGB24ToBGRARowMirror_C, 32, 3, 4}, random);
+        ::CheckRowKernel({"MirrorRow32_AVX2", MirrorRow32_AVX2, MirrorRow32_C, 32, 4, 4}, random);
+        ::CheckHashKernel("HashBlocks_AVX2", HashBlocks_AVX2, random);
+    }
+    else
+    {
+        info("TEST", "Skipping the AVX2 kernels, the CPU doesn't support them.");
+    }
+
+    if (cpu.avx512bw)
+    {
+        ::CheckRowKernel({"RGB24ToBGRARow_AVX512", RGB24ToBGRARow_AVX512, RGB24ToBGRARow_C, 16, 3, 4}, random);
+    }
+    else
+    {
+        info("TEST", "Skipping the AVX-512 kernels, the CPU doesn't support them.");
+    }
+#else
+    (void)random;
+    info("TEST", "Skipping the SIMD kernels, there are none for this CPU.");
+#endif
+}
+
+// A frame with random samples whose rows are padded by the given number of bytes, or packed without any padding
+struct SourceFrame
+{
+    std::vector<uint8_t> data;
+    FrameRef frame;
+};
+
+bool MakeSourceFrame(FramePool& framePool, IDevice::VideoFormat videoFormat, uint32_t width, uint32_t height, uint32_t padding, std::mt19937& random,
+                     SourceFrame& source)
+{
+    const VideoFormatInfo& format = GetVideoFormatInfo(videoFormat);
+
+    source.frame = framePool.acquire();
+    source.frame->videoFormat = videoFormat;
+    source.frame->width = width;
+    source.frame->height = height;
+
+    if (padding == 0)
+    {
+        source.data = ::RandomBytes(random, format.getPackedSize(width, height));
+        return source.frame->setPackedData(source.data.data(), source.data.size());
+    }
+
+    // Chroma planes without a pitch shift of their own share the frame's pitch, their rows are rounded up for odd widths
+    uint32_t pitch = format.planes[0].getRowSize(width);
+    for (uint32_t i = 1; i < format.planeCount; ++i)
+    {
+        if (format.planes[i].pitchShift == 0)
+        {
+            pitch = std::max(pitch, format.planes[i].getRowSize(width));
+        }
+    }
+
+    pitch += padding;
+
+    source.data = ::RandomBytes(random, size_t(pitch) * height * format.planeCount);
+    return source.frame->setData(source.data.data(), source.data.size(), pitch);
+}
+
+// An NV12 destination with padded rows, filled with a marker so that writes past the visible rows show up when comparing
+struct Destination
+{
+    Destination(uint32_t width, uint32_t height) : yPitch(((width + 1) & ~1u) + 16), uvPitch(yPitch + 32), uvOffset(yPitch * height)
+    {
+        data.assign(uvOffset + uvPitch * ((height + 1) / 2), std::byte{0xcd});
+    }
+
+    std::byte* y()
+    {
+        return data.data();
+    }
+
+    std::byte* uv()
+    {
+        return data.data() + uvOffset;
+    }
+
+    size_t yPitch;
+    size_t uvPitch;
+    size_t uvOffset;
+    std::vector<std::byte> data;
+};
+
+void CheckConversions(std::mt19937& random)
+{
+    auto framePool = FramePool::create();
+
+    constexpr IDevice::VideoFormat VideoFormats[] = {IDevice::VideoFormat::NV12, IDevice::VideoFormat::I420, IDevice::VideoFormat::YUY2,
+                                                     IDevice::VideoFormat::UYVY, IDevice::VideoFormat::BGRA, IDevice::VideoFormat::RGB24,
+                                                     IDevice::VideoFormat::P010};
+
+    // Around the block sizes of the kernels, so that both the SIMD loops and the scalar tails run
+    constexpr uint32_t Widths[] = {1, 2, 3, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 1921};
+    constexpr uint32_t Heights[] = {1, 2, 3, 4, 7};
+    constexpr uint32_t Paddings[] = {0, 14, 64};
+
+    for (auto videoFormat : VideoFormats)
+    {
+        const char* formatName = GetVideoFormatInfo(videoFormat).name;
+        NV12Converter converter(videoFormat, 1);
+
+        for (uint32_t width : Widths)
+        {
+            for (uint32_t height : Heights)
+            {
+                for (uint32_t padding : Paddings)
+                {
+                    SourceFrame source;
+                    if (!::MakeSourceFrame(*framePool, videoFormat, width, height, padding, random, source))
+                    {
+                        ::Check(false, "Couldn't set up a %s frame of %d x %d with %d bytes of padding.", formatName, width, height, padding);
+                        continue;
+                    }
+
+                    for (Orientation orientation : Orientations)
+                    {
+                        Destination expected(width, height);
+                        Destination dispatched(width, height);
+                        Destination converted(width, height);
+
+                        const bool referenceResult =
+                            ConvertToNV12Reference(*source.frame, expected.y(), expected.yPitch, expected.uv(), expected.uvPitch, orientation);
+                        const bool dispatchedResult =
+                            ConvertToNV12(*source.frame, dispatched.y(), dispatched.yPitch, dispatched.uv(), dispatched.uvPitch, orientation);
+                        const bool convertedResult =
+                            converter.convert(*source.frame, converted.y(), converted.yPitch, converted.uv(), converted.uvPitch, orientation);
+
+                        ::Check(referenceResult && dispatchedResult && convertedResult, "Converting %s at %d x %d %s failed.", formatName, width, height,
+                                ::GetOrientationName(orientation));
+
+                        ::Check(dispatched.data == expected.data, "ConvertToNV12() differs from the reference for %s at %d x %d with %d bytes of padding, %s.",
+                                formatName, width, height, padding, ::GetOrientationName(orientation));
+
+                        ::Check(converted.data == expected.data, "NV12Converter differs from the reference for %s at %d x %d with %d bytes of padding, %s.",
+                                formatName, width, height, padding, ::GetOrientationName(orientation));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Splits the frames into bands on several threads. The overlay is drawn per band and has to end up the same as when it is
+// drawn over the whole reference conversion, also where its box is cut by the band boundaries.
+void CheckThreadedConversions(std::mt19937& random)
+{
+    auto framePool = FramePool::create();
+
+    constexpr IDevice::VideoFormat VideoFormats[] = {IDevice::VideoFormat::NV12, IDevice::VideoFormat::I420, IDevice::VideoFormat::YUY2,
+                                                     IDevice::VideoFormat::UYVY, IDevice::VideoFormat::BGRA, IDevice::VideoFormat::RGB24,
+                                                     IDevice::VideoFormat::P010};
+
+    // Frames below 32 rows are converted in a single band, the odd heights leave a shorter last band
+    constexpr uint32_t Widths[] = {1, 33, 97, 200};
+    constexpr uint32_t Heights[] = {16, 31, 32, 33, 47, 100, 135};
+    constexpr uint32_t ThreadCounts[] = {2, 3, 8};
+
+    TextOverlay overlay({.x = 5, .y = 9, .scale = 2});
+    overlay.setText("Frame 1234\nLatency 56 ms");
+
+    for (auto videoFormat : VideoFormats)
+    {
+        const char* formatName = GetVideoFormatInfo(videoFormat).name;
+
+        for (uint32_t threadCount : ThreadCounts)
+        {
+            NV12Converter converter(videoFormat, threadCount);
+
+            for (uint32_t width : Widths)
+            {
+                for (uint32_t height : Heights)
+                {
+                    SourceFrame source;
+                    if (!::MakeSourceFrame(*framePool, videoFormat, width, height, 14, random, source))
+                    {
+                        ::Check(false, "Couldn't set up a %s frame of %d x %d.", formatName, width, height);
+                        continue;
+                    }
+
+                    for (Orientation orientation : Orientations)
+                    {
+                        Destination expected(width, height);
+                        Destination converted(width, height);
+
+                        ConvertToNV12Reference(*source.frame, expected.y(), expected.yPitch, expected.uv(), expected.uvPitch, orientation);
+                        const bool result = converter.convert(*source.frame, converted.y(), converted.yPitch, converted.uv(), converted.uvPitch, orientation);
+
+                        ::Check(result && converted.data == expected.data, "NV12Converter on %d threads differs from the reference for %s at %d x %d, %s.",
+                                threadCount, formatName, width, height, ::GetOrientationName(orientation));
+
+                        overlay.drawNV12(expected.y(), expected.yPitch, expected.uv(), expected.uvPitch, width, 0, height);
+                        converter.convert(*source.frame, converted.y(), converted.yPitch, converted.uv(), converted.uvPitch, orientation, &overlay);
+
+                        ::Check(converted.data == expected.data,
+                                "NV12Converter on %d threads draws the overlay differently for %s at %d x %d, %s.", threadCount, formatName, width,
+                                height, ::GetOrientationName(orientation));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// The BGRA and RGB24 frames converted to BGRA with the fastest kernels and with the overlay drawn per row
+void CheckBGRAConversions(std::mt19937& random)
+{
+    auto framePool = FramePool::create();
+
+    constexpr IDevice::VideoFormat VideoFormats[] = {IDevice::VideoFormat::BGRA, IDevice::VideoFormat::RGB24};
+    constexpr uint32_t Widths[] = {1, 2, 3, 15, 16, 17, 31, 32, 33, 47, 63, 64, 65, 127, 1921};
+    constexpr uint32_t Heights[] = {1, 2, 3, 37};
+    constexpr uint32_t Paddings[] = {0, 14, 64};
+
+    TextOverlay overlay({.x = 5, .y = 9, .scale = 2});
+    overlay.setText("Frame 1234");
+
+    for (auto videoFormat : VideoFormats)
+    {
+        const char* formatName = GetVideoFormatInfo(videoFormat).name;
+
+        for (uint32_t width : Widths)
+        {
+            for (uint32_t height : Heights)
+            {
+                for (uint32_t padding : Paddings)
+                {
+                    SourceFrame source;
+                    if (!::MakeSourceFrame(*framePool, videoFormat, width, height, padding, random, source))
+                    {
+                        ::Check(false, "Couldn't set up a %s frame of %d x %d with %d bytes of padding.", formatName, width, height, padding);
+                        continue;
+                    }
+
+                    // Padded, so that writes past the end of a row show up
+                    const size_t dstPitch = size_t(width) * 4 + 32;
+
+                    for (Orientation orientation : Orientations)
+                    {
+                        std::vector<std::byte> expected(dstPitch * height, std::byte{0xcd});
+                        std::vector<std::byte> converted(expected.size(), std::byte{0xcd});
+
+                        const bool referenceResult = ConvertToBGRAReference(*source.frame, expected.data(), dstPitch, orientation);
+                        const bool convertedResult = ConvertToBGRA(*source.frame, converted.data(), dstPitch, orientation);
+
+                        ::Check(referenceResult && convertedResult && converted == expected,
+                                "ConvertToBGRA() differs from the reference for %s at %d x %d with %d bytes of padding, %s.", formatName, width, height,
+                                padding, ::GetOrientationName(orientation));
+
+                        overlay.drawBGRA(expected.data(), dstPitch, width, 0, height);
+                        ConvertToBGRA(*source.frame, converted.data(), dstPitch, orientation, &overlay);
+
+                        ::Check(converted == expected, "ConvertToBGRA() draws the overlay differently for %s at %d x %d, %s.", formatName, width, height,
+                                ::GetOrientationName(orientation));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Scales into downscaled, upscaled and same size layers at once, on several threads with the bands of both planes spread
+// across them. A flat frame has to stay flat in every layer, whatever the filter's weights round to.
+void CheckScaler(std::mt19937& random)
+{
+    auto framePool = FramePool::create();
+
+    struct ScalerCase
+    {
+        NV12Scaler::Size source;
+        std::vector<NV12Scaler::Size> layers;
+    };
+
+    const ScalerCase Cases[] = {
+        {{64, 48}, {{32, 24}, {64, 48}, {128, 96}}},
+        {{202, 134}, {{66, 44}, {100, 66}, {202, 134}, {306, 202}}},
+        {{640, 360}, {{426, 240}, {320, 180}, {160, 90}, {2, 2}}},
+        {{2, 2}, {{2, 2}, {34, 18}}},
+    };
+    constexpr uint32_t ThreadCounts[] = {1, 2, 3, 8};
+    constexpr uint32_t Paddings[] = {0, 14};
+
+    for (const ScalerCase& test : Cases)
+    {
+        for (uint32_t threadCount : ThreadCounts)
+        {
+            NV12Scaler scaler(test.source, test.layers, threadCount);
+
+            for (uint32_t padding : Paddings)
+            {
+                SourceFrame source;
+                if (!::MakeSourceFrame(*framePool, IDevice::VideoFormat::NV12, test.source.width, test.source.height, padding, random, source))
+                {
+                    ::Check(false, "Couldn't set up an NV12 frame of %d x %d with %d bytes of padding.", test.source.width, test.source.height, padding);
+                    continue;
+                }
+
+                std::vector<Destination> expected;
+                std::vector<Destination> scaled;
+                std::vector<NV12Planes> expectedPlanes;
+                std::vector<NV12Planes> scaledPlanes;
+
+                // Reserved, so that the planes keep pointing into the same destinations
+                expected.reserve(test.layers.size());
+                scaled.reserve(test.layers.size());
+
+                for (const NV12Scaler::Size& layer : test.layers)
+                {
+                    Destination& expectedLayer = expected.emplace_back(layer.width, layer.height);
+                    Destination& scaledLayer = scaled.emplace_back(layer.width, layer.height);
+                    expectedPlanes.push_back({expectedLayer.y(), expectedLayer.yPitch, expectedLayer.uv(), expectedLayer.uvPitch});
+                    scaledPlanes.push_back({scaledLayer.y(), scaledLayer.yPitch, scaledLayer.uv(), scaledLayer.uvPitch});
+                }
+
+                const bool referenceResult = scaler.scaleReference(*source.frame, expectedPlanes);
+                const bool scaledResult = scaler.scale(*source.frame, scaledPlanes);
+
+                ::Check(referenceResult && scaledResult, "Scaling %d x %d failed.", test.source.width, test.source.height);
+
+                for (size_t i = 0; i < test.layers.size(); ++i)
+                {
+                    ::Check(scaled[i].data == expected[i].data,
+                            "NV12Scaler differs from the reference scaling %d x %d with %d bytes of padding to %d x %d on %d threads.",
+                            test.source.width, test.source.height, padding, test.layers[i].width, test.layers[i].height, threadCount);
+                }
+            }
+
+            // Flat luma and chroma, with different U and V values so that swapping them shows up
+            const VideoFormatInfo& format = GetVideoFormatInfo(IDevice::VideoFormat::NV12);
+            std::vector<uint8_t> flat(format.getPackedSize(test.source.width, test.source.height), 81);
+            for (size_t i = size_t(test.source.width) * test.source.height; i + 1 < flat.size(); i += 2)
+            {
+                flat[i] = 90;
+                flat[i + 1] = 240;
+            }
+
+            FrameRef frame = framePool->acquire();
+            frame->videoFormat = IDevice::VideoFormat::NV12;
+            frame->width = test.source.width;
+            frame->height = test.source.height;
+            frame->setPackedData(flat.data(), flat.size());
+
+            std::vector<Destination> layers;
+            std::vector<NV12Planes> planes;
+            layers.reserve(test.layers.size());
+
+            for (const NV12Scaler::Size& layer : test.layers)
+            {
+                Destination& destination = layers.emplace_back(layer.width, layer.height);
+                planes.push_back({destination.y(), destination.yPitch, destination.uv(), destination.uvPitch});
+            }
+
+            scaler.scale(*frame, planes);
+
+            for (size_t i = 0; i < test.layers.size(); ++i)
+            {
+                const auto [width, height] = test.layers[i];
+
+                bool isFlat = true;
+                for (uint32_t y = 0; y < height; ++y)
+                {
+                    const auto* row = reinterpret_cast<const uint8_t*>(layers[i].y() + y * layers[i].yPitch);
+                    isFlat = isFlat && std::all_of(row, row + width, [](uint8_t value) { return value == 81; });
+                }
+
+                for (uint32_t y = 0; y < height / 2; ++y)
+                {
+                    const auto* row = reinterpret_cast<const uint8_t*>(layers[i].uv() + y * layers[i].uvPitch);
+                    for (uint32_t x = 0; x < width; x += 2)
+                    {
+                        isFlat = isFlat && row[x] == 90 && row[x + 1] == 240;
+                    }
+                }
+
+                ::Check(isFlat, "A flat %d x %d frame isn't flat any more when scaled to %d x %d on %d threads.", test.source.width, test.source.height,
+                        width, height, threadCount);
+            }
+        }
+    }
+}
+
+// Deinterlaces with both modes and field orders, split into bands on several threads. The previous frame differs from the
+// current one only here and there, so that motion adaptive deinterlacing takes both of its paths.
+void CheckDeinterlacer(std::mt19937& random)
+{
+    auto framePool = FramePool::create();
+
+    constexpr Deinterlacer::Mode Modes[] = {Deinterlacer::Mode::Bob, Deinterlacer::Mode::MotionAdaptive};
+    constexpr IDevice::FieldOrder FieldOrders[] = {IDevice::FieldOrder::TopFieldFirst, IDevice::FieldOrder::BottomFieldFirst};
+    constexpr uint32_t ThreadCounts[] = {1, 2, 3, 8};
+
+    constexpr IDevice::VideoFormat VideoFormats[] = {IDevice::VideoFormat::NV12, IDevice::VideoFormat::I420, IDevice::VideoFormat::YUY2,
+                                                     IDevice::VideoFormat::RGB24, IDevice::VideoFormat::P010};
+    constexpr uint32_t Widths[] = {1, 33, 97, 200};
+    constexpr uint32_t Heights[] = {2, 3, 31, 64, 97, 250};
+    constexpr uint32_t Paddings[] = {0, 14};
+
+    for (auto mode : Modes)
+    {
+        for (auto fieldOrder : FieldOrders)
+        {
+            for (uint32_t threadCount : ThreadCounts)
+            {
+                Deinterlacer deinterlacer({.mode = mode, .fieldOrder = fieldOrder, .threadCount = threadCount});
+
+                const char* modeName = mode == Deinterlacer::Mode::Bob ? "bob" : "motion adaptive";
+                const char* fieldOrderName = fieldOrder == IDevice::FieldOrder::BottomFieldFirst ? "bottom" : "top";
+
+                for (auto videoFormat : VideoFormats)
+                {
+                    const char* formatName = GetVideoFormatInfo(videoFormat).name;
+
+                    for (uint32_t width : Widths)
+                    {
+                        for (uint32_t height : Heights)
+                        {
+                            for (uint32_t padding : Paddings)
+                            {
+                                // The destinations get the same padding, which has to stay untouched
+                                SourceFrame source, previous, expected, deinterlaced;
+                                if (!::MakeSourceFrame(*framePool, videoFormat, width, height, padding, random, source) ||
+                                    !::MakeSourceFrame(*framePool, videoFormat, width, height, padding, random, previous) ||
+                                    !::MakeSourceFrame(*framePool, videoFormat, width, height, padding, random, expected) ||
+                                    !::MakeSourceFrame(*framePool, videoFormat, width, height, padding, random, deinterlaced))
+                                {
+                                    ::Check(false, "Couldn't set up a %s frame of %d x %d with %d bytes of padding.", formatName, width, height, padding);
+                                    continue;
+                                }
+
+                                // Mostly still, with small changes below the motion threshold and large ones above it
+                                for (size_t i = 0; i < previous.data.size(); ++i)
+                                {
+                                    const uint32_t change = random() % 16;
+                                    previous.data[i] = change < 12 ? source.data[i] : change < 14 ? uint8_t(source.data[i] + change) : uint8_t(random());
+                                }
+
+                                std::copy(expected.data.begin(), expected.data.end(), deinterlaced.data.begin());
+
+                                const Frame* previousFrames[] = {previous.frame.get(), nullptr};
+                                for (const Frame* previousFrame : previousFrames)
+                                {
+                                    const bool referenceResult = deinterlacer.deinterlaceReference(*source.frame, previousFrame, *expected.frame);
+                                    const bool deinterlacedResult = deinterlacer.deinterlace(*source.frame, previousFrame, *deinterlaced.frame);
+
+                                    ::Check(referenceResult && deinterlacedResult && deinterlaced.data == expected.data,
+                                            "Deinterlacer differs from the reference for %s at %d x %d with %d bytes of padding, %s, %s field first, "
+                                            "on %d threads%s.",
+                                            formatName, width, height, padding, modeName, fieldOrderName, threadCount,
+                                            previousFrame ? "" : " without a previous frame");
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Hashes frames of every format with odd widths and padded pitches. Changing a single visible byte has to change the hash,
+// changing the padding must not.
+void CheckFrameHash(std::mt19937& random)
+{
+    auto framePool = FramePool::create();
+
+    constexpr IDevice::VideoFormat VideoFormats[] = {IDevice::VideoFormat::NV12, IDevice::VideoFormat::I420, IDevice::VideoFormat::YUY2,
+                                                     IDevice::VideoFormat::UYVY, IDevice::VideoFormat::P010, IDevice::VideoFormat::BGRA,
+                                                     IDevice::VideoFormat::RGB24};
+    constexpr uint32_t Widths[] = {1, 2, 7, 15, 31, 33, 97, 200};
+    constexpr uint32_t Heights[] = {1, 2, 3, 17};
+    constexpr uint32_t Paddings[] = {0, 14, 64};
+
+    for (auto videoFormat : VideoFormats)
+    {
+        const char* formatName = GetVideoFormatInfo(videoFormat).name;
+
+        for (uint32_t width : Widths)
+        {
+            for (uint32_t height : Heights)
+            {
+                for (uint32_t padding : Paddings)
+                {
+                    SourceFrame source;
+                    if (!::MakeSourceFrame(*framePool, videoFormat, width, height, padding, random, source))
+                    {
+                        ::Check(false, "Couldn't set up a %s frame of %d x %d with %d bytes of padding.", formatName, width, height, padding);
+                        continue;
+                    }
+
+                    const Frame& frame = *source.frame;
+                    const uint64_t hash = HashFrame(frame);
+
+                    ::Check(hash == HashFrameReference(frame), "HashFrame() differs from the reference for %s at %d x %d with %d bytes of padding.",
+                            formatName, width, height, padding);
+                    ::Check(HashFrame(frame, 1) == HashFrameReference(frame, 1) && HashFrame(frame, 1) != hash,
+                            "The seed doesn't change the hash of %s at %d x %d.", formatName, width, height);
+
+                    const auto getOffset = [&](const Frame::Plane& plane, uint32_t y) {
+                        return size_t(plane.getRow(y) - reinterpret_cast<const std::byte*>(source.data.data()));
+                    };
+
+                    // The first and last byte of the first, a middle and the last row of every plane, the last one falls into the
+                    // zero padded remainder of the row unless the row is made of whole blocks
+                    for (uint32_t i = 0; i < frame.planeCount; ++i)
+                    {
+                        const Frame::Plane& plane = frame.planes[i];
+
+                        for (uint32_t y : {0u, plane.rows / 2, plane.rows - 1})
+                        {
+                            for (uint32_t x : {0u, plane.rowSize - 1})
+                            {
+                                uint8_t& byte = source.data[getOffset(plane, y) + x];
+                                byte ^= 1;
+
+                                const uint64_t changedHash = HashFrame(frame);
+                                ::Check(changedHash != hash && changedHash == HashFrameReference(frame),
+                                        "Changing byte %d of row %d of plane %d doesn't change the hash of %s at %d x %d.", x, y, i, formatName, width, height);
+
+                                byte ^= 1;
+                            }
+                        }
+
+                        if (padding > 0)
+                        {
+                            source.data[getOffset(plane, 0) + plane.rowSize] ^= 0xff;
+                            ::Check(HashFrame(frame) == hash, "The padding of plane %d changes the hash of %s at %d x %d.", i, formatName, width, height);
+                            source.data[getOffset(plane, 0) + plane.rowSize] ^= 0xff;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Packed frames of any size fit into exactly getPackedSize() bytes, also the NV12 and P010 chroma rows of odd widths which are
+// wider than their luma rows
+void CheckPackedLayouts()
+{
+    auto framePool = FramePool::create();
+
+    constexpr IDevice::VideoFormat VideoFormats[] = {IDevice::VideoFormat::NV12, IDevice::VideoFormat::I420, IDevice::VideoFormat::YUY2,
+                                                     IDevice::VideoFormat::UYVY, IDevice::VideoFormat::BGRA, IDevice::VideoFormat::RGB24,
+                                                     IDevice::VideoFormat::P010};
+
+    for (auto videoFormat : VideoFormats)
+    {
+        const VideoFormatInfo& format = GetVideoFormatInfo(videoFormat);
+
+        for (uint32_t width = 1; width <= 9; ++width)
+        {
+            for (uint32_t height = 1; height <= 5; ++height)
+            {
+                const size_t size = format.getPackedSize(width, height);
+                std::vector<std::byte> data(size);
+
+                FrameRef frame = framePool->acquire();
+                frame->videoFormat = videoFormat;
+                frame->width = width;
+                frame->height = height;
+
+                ::Check(frame->setPackedData(data.data(), size), "%s at %d x %d doesn't fit into its packed size of %d bytes.", format.name, width, height,
+                        int(size));
+
+                const Frame::Plane& lastPlane = frame->planes[frame->planeCount - 1];
+                ::Check(lastPlane.getRow(lastPlane.rows - 1) + lastPlane.rowSize == data.data() + size,
+                        "The planes of %s at %d x %d don't end at its packed size.", format.name, width, height);
+
+                ::Check(!frame->setPackedData(data.data(), size - 1), "%s at %d x %d fits into less than its packed size.", format.name, width, height);
+            }
+        }
+    }
+}
+
+// A few known values, so that the reference itself can't drift along with the kernels
+void CheckKnownValues()
+{
+    auto framePool = FramePool::create();
+
+    auto convert = [&framePool](IDevice::VideoFormat videoFormat, std::vector<uint8_t> data, Destination& destination)
+    {
+        FrameRef frame = framePool->acquire();
+        frame->videoFormat = videoFormat;
+        frame->width = 2;
+        frame->height = 2;
+
+        return frame->setPackedData(data.data(), data.size()) &&
+               ConvertToNV12Reference(*frame, destination.y(), destination.yPitch, destination.uv(), destination.uvPitch);
+    };
+
+    auto getBytes = [](Destination& destination)
+    {
+        auto y = reinterpret_cast<const uint8_t*>(destination.y());
+        auto uv = reinterpret_cast<const uint8_t*>(destination.uv());
+        return std::vector<uint8_t>{y[0], y[1], y[destination.yPitch], y[destination.yPitch + 1], uv[0], uv[1]};
+    };
+
+    // The chroma of the two rows is averaged and rounded up
+    Destination yuy2(2, 2);
+    ::Check(convert(IDevice::VideoFormat::YUY2, {10, 100, 20, 200, 30, 103, 40, 203}, yuy2) &&
+                getBytes(yuy2) == std::vector<uint8_t>{10, 20, 30, 40, 102, 202},
+            "YUY2 isn't repacked to the expected NV12 values.");
+
+    Destination white(2, 2);
+    ::Check(convert(IDevice::VideoFormat::BGRA, std::vector<uint8_t>(16, 255), white) && getBytes(white) == std::vector<uint8_t>{235, 235, 235, 235, 128, 128},
+            "White BGRA doesn't convert to limited range white.");
+
+    Destination black(2, 2);
+    ::Check(convert(IDevice::VideoFormat::BGRA, {0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255}, black) &&
+                getBytes(black) == std::vector<uint8_t>{16, 16, 16, 16, 128, 128},
+            "Black BGRA doesn't convert to limited range black.");
+}
+} // namespace
+
+int main()
+{
+    std::mt19937 random(2024);
+
+    ::CheckKernels(random);
+    ::CheckPackedLayouts();
+    ::CheckConversions(random);
+    ::CheckThreadedConversions(random);
+    ::CheckBGRAConversions(random);
+    ::CheckScaler(random);
+    ::CheckDeinterlacer(random);
+    ::CheckFrameHash(random);
+    ::CheckKnownValues();
+
+    if (g_failureCount > 0)
+    {
+        error("TEST", "%d of %d checks failed.", g_failureCount, g_checkCount);
+        return 1;
+    }
+
+    info("TEST", "All %d checks passed.", g_checkCount);
+    return 0;
+}
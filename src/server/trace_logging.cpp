@@ -1,6 +1,6 @@
-
 #include "trace_logging.h"
 
+#ifdef _WIN32
 #include <TraceLoggingProvider.h>
 #include <winmeta.h>
 
@@ -22,6 +22,10 @@ class ProviderRegistration
 };
 
 static ProviderRegistration s_TLProviderRegistration;
+#else
+// There is no ETW elsewhere, the events compile to nothing
+#define TraceLoggingWrite(...) ((void)0)
+#endif
 
 namespace Trace
 {
@@ -72,6 +76,41 @@ void Encode_EncodeFrameFinished(uint64_t frameId, uint64_t packetSize)
                       TraceLoggingUInt32(static_cast<uint32_t>(packetSize), "PacketSize"));
 }
 
+void Encode_FrameSubmitted(uint64_t frameId, uint32_t framesInFlight)
+{
+    TraceLoggingWrite(g_hTLProvider, "Encode_FrameSubmitted", TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE), TraceLoggingUInt64(frameId, "FrameId"),
+                      TraceLoggingUInt32(framesInFlight, "FramesInFlight"));
+}
+
+void Encode_FrameCompleted(uint64_t frameId, std::chrono::nanoseconds submitToComplete)
+{
+    TraceLoggingWrite(g_hTLProvider, "Encode_FrameCompleted", TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE), TraceLoggingUInt64(frameId, "FrameId"),
+                      TraceLoggingUInt64(submitToComplete.count(), "SubmitToCompleteNS"));
+}
+
+void Encode_FrameSkipped(uint64_t frameId)
+{
+    TraceLoggingWrite(g_hTLProvider, "Encode_FrameSkipped", TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE), TraceLoggingUInt64(frameId, "FrameId"));
+}
+
+void Pipeline_RingPush(const char* ring, uint64_t frameId, uint32_t occupancy)
+{
+    TraceLoggingWrite(g_hTLProvider, "Pipeline_RingPush", TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE), TraceLoggingString(ring, "Ring"), TraceLoggingUInt64(frameId, "FrameId"),
+                      TraceLoggingUInt32(occupancy, "Occupancy"));
+}
+
+void Pipeline_FrameDropped(const char* stage, uint64_t frameId, uint64_t droppedCount)
+{
+    TraceLoggingWrite(g_hTLProvider, "Pipeline_FrameDropped", TraceLoggingLevel(WINEVENT_LEVEL_WARNING), TraceLoggingString(stage, "Stage"), TraceLoggingUInt64(frameId, "FrameId"),
+                      TraceLoggingUInt64(droppedCount, "DroppedCount"));
+}
+
+void Pipeline_RingFull(const char* ring, uint64_t frameId, uint64_t fullCount)
+{
+    TraceLoggingWrite(g_hTLProvider, "Pipeline_RingFull", TraceLoggingLevel(WINEVENT_LEVEL_WARNING), TraceLoggingString(ring, "Ring"), TraceLoggingUInt64(frameId, "FrameId"),
+                      TraceLoggingUInt64(fullCount, "FullCount"));
+}
+
 void WebRTC_ConnectionOffer()
 {
     TraceLoggingWrite(g_hTLProvider, "WebRTC_ConnectionOffer", TraceLoggingLevel(WINEVENT_LEVEL_INFO));
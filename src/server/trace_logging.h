@@ -15,6 +15,14 @@ void Encode_UploadTextureMapped(uint64_t frameId);
 void Encode_UploadTextureUnmapped(uint64_t frameId);
 void Encode_InputFrameTextureUpdated(uint64_t frameId);
 void Encode_EncodeFrameFinished(uint64_t frameId, uint64_t packetSize);
+void Encode_FrameSubmitted(uint64_t frameId, uint32_t framesInFlight);
+void Encode_FrameCompleted(uint64_t frameId, std::chrono::nanoseconds submitToComplete);
+void Encode_FrameSkipped(uint64_t frameId);
+
+// Trace events for the pipeline connecting the stages
+void Pipeline_RingPush(const char* ring, uint64_t frameId, uint32_t occupancy);
+void Pipeline_FrameDropped(const char* stage, uint64_t frameId, uint64_t droppedCount);
+void Pipeline_RingFull(const char* ring, uint64_t frameId, uint64_t fullCount);
 
 // Trace events for the WebRTC portion
 void WebRTC_ConnectionOffer();
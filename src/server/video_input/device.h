@@ -1,6 +1,7 @@
 
 #pragma once
 
+class FrameRef;
 class IVideoStreamSampleConsumer;
 
 class IDeviceSampleHandler
@@ -8,7 +9,14 @@ class IDeviceSampleHandler
   public:
     virtual ~IDeviceSampleHandler() = default;
 
-    virtual void onSample(std::chrono::nanoseconds timeStamp, const void* data, uint32_t dataSize, uint64_t frameId, IVideoStreamSampleConsumer* sampleConsumer) = 0;
+    // The handler may keep a reference to the frame after returning, the frame's memory stays valid until it is released
+    virtual void onSample(const FrameRef& frame, IVideoStreamSampleConsumer* sampleConsumer) = 0;
+
+    // Called after the last frame, on the thread which delivered the frames. Handlers which finish frames asynchronously
+    // hand everything still in flight to the consumer before returning, the consumer may be gone afterwards.
+    virtual void flush()
+    {
+    }
 };
 
 class IDevice
@@ -19,13 +27,55 @@ class IDevice
         Unknown,
         BGRA,
         NV12,
-        RGB24 // Used by some Web cams. Not recommended as uploading it is more involved than other formats.
+        RGB24, // Used by some Web cams. Not recommended as uploading it is more involved than other formats.
+        I420,  // Planar YUV 4:2:0, e.g. from Y4M files. Interleaved to NV12 while uploading.
+        YUY2,  // Packed YUV 4:2:2 as Y0 U Y1 V, offered by many HDMI capture cards. Converted to NV12 while uploading.
+        UYVY,  // Packed YUV 4:2:2 as U Y0 V Y1
+        P010,  // NV12 layout with 16 bit samples holding 10 bits in their upper bits. Narrowed to 8 bit NV12 while uploading.
+        MJPEG  // A JPEG image per frame, the only way most USB web cams reach 1080p30. Decoded to NV12 by MJPEGDecodedDevice.
+    };
+
+    // How the rows of a frame were captured. Interlaced frames carry two fields woven into each other,
+    // the even rows are the top field and the odd rows the bottom one.
+    enum class FieldOrder
+    {
+        Progressive,
+        TopFieldFirst,
+        BottomFieldFirst
+    };
+
+    // One combination of format, frame size and frame rate a device can deliver
+    struct VideoMode
+    {
+        VideoFormat videoFormat = VideoFormat::Unknown;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        Ratio fps;
+
+        bool operator==(const VideoMode& other) const = default;
     };
 
     virtual ~IDevice() = default;
 
     virtual std::string getName() const = 0;
 
+    // Lists every mode the device supports. Devices with a fixed mode only report their current one.
+    virtual std::vector<VideoMode> enumerateVideoModes() const
+    {
+        VideoMode mode;
+        mode.videoFormat = getVideoFormat();
+        getFrameSize(mode.width, mode.height);
+        mode.fps = getFrameRate();
+
+        return {mode};
+    }
+
+    // Switches the device to the mode, must be called before prepareStreaming(). Returns false if the device rejected it.
+    virtual bool setVideoMode(const VideoMode& mode)
+    {
+        return mode == enumerateVideoModes().front();
+    }
+
     virtual bool prepareStreaming()
     {
         return true;
@@ -37,4 +87,9 @@ class IDevice
     virtual Ratio getFrameRate() const = 0;
 
     virtual VideoFormat getVideoFormat() const = 0;
+
+    virtual FieldOrder getFieldOrder() const
+    {
+        return FieldOrder::Progressive;
+    }
 };
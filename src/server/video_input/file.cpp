@@ -0,0 +1,434 @@
+#include "file.h"
+#include "frame.h"
+#include "trace_logging.h"
+#include "video_format.h"
+
+#include <charconv>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+// Read only memory mapping of a whole file
+class MappedFile
+{
+  public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (m_data)
+        {
+            UnmapViewOfFile(m_data);
+        }
+
+        if (m_mapping)
+        {
+            CloseHandle(m_mapping);
+        }
+
+        if (m_file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_file);
+        }
+#else
+        if (m_data)
+        {
+            munmap(const_cast<std::byte*>(m_data), m_size);
+        }
+#endif
+    }
+
+    bool open(const std::string& path)
+    {
+#ifdef _WIN32
+        m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+        {
+            return false;
+        }
+
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_mapping)
+        {
+            return false;
+        }
+
+        m_data = static_cast<const std::byte*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        m_size = static_cast<size_t>(size.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+        {
+            close(fd);
+            return false;
+        }
+
+        void* data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+
+        // The mapping keeps the file alive, so the descriptor isn't needed anymore
+        close(fd);
+
+        if (data == MAP_FAILED)
+        {
+            return false;
+        }
+
+        madvise(data, fileStat.st_size, MADV_SEQUENTIAL);
+
+        m_data = static_cast<const std::byte*>(data);
+        m_size = static_cast<size_t>(fileStat.st_size);
+#endif
+
+        return m_data != nullptr;
+    }
+
+    const std::byte* data() const
+    {
+        return m_data;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+  private:
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#endif
+
+    const std::byte* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+uint32_t ParseUInt(std::string_view str)
+{
+    uint32_t value = 0;
+    std::from_chars(str.data(), str.data() + str.size(), value);
+    return value;
+}
+
+// Parses the stream header of a Y4M file, see https://wiki.multimedia.cx/index.php/YUV4MPEG2
+// Only the 4:2:0 8 bit color spaces are supported since these map directly to I420
+bool ParseY4MHeader(std::string_view header, uint32_t& width, uint32_t& height, Ratio& fps, IDevice::VideoFormat& videoFormat, IDevice::FieldOrder& fieldOrder)
+{
+    constexpr std::string_view signature = "YUV4MPEG2";
+
+    if (header.substr(0, signature.size()) != signature)
+    {
+        error("FILE", "File doesn't start with the Y4M signature.");
+        return false;
+    }
+
+    // If no color space is given the default is 4:2:0 with JPEG chroma siting
+    videoFormat = IDevice::VideoFormat::I420;
+
+    size_t pos = signature.size();
+    while (pos < header.size())
+    {
+        while (pos < header.size() && header[pos] == ' ')
+        {
+            ++pos;
+        }
+
+        size_t end = header.find(' ', pos);
+        if (end == std::string_view::npos)
+        {
+            end = header.size();
+        }
+
+        std::string_view token = header.substr(pos, end - pos);
+        pos = end;
+
+        if (token.empty())
+        {
+            continue;
+        }
+
+        std::string_view value = token.substr(1);
+
+        switch (token[0])
+        {
+        case 'W':
+            width = ParseUInt(value);
+            break;
+        case 'H':
+            height = ParseUInt(value);
+            break;
+        case 'F':
+        {
+            size_t colon = value.find(':');
+            if (colon == std::string_view::npos)
+            {
+                error("FILE", "Invalid Y4M frame rate '%.*s'.", int(value.size()), value.data());
+                return false;
+            }
+
+            fps.numerator = ParseUInt(value.substr(0, colon));
+            fps.denominator = ParseUInt(value.substr(colon + 1));
+            break;
+        }
+        case 'I':
+            // Mixed files are treated as top field first, the deinterlacer leaves static progressive content alone
+            if (value == "t" || value == "m")
+            {
+                fieldOrder = IDevice::FieldOrder::TopFieldFirst;
+            }
+            else if (value == "b")
+            {
+                fieldOrder = IDevice::FieldOrder::BottomFieldFirst;
+            }
+            break;
+        case 'C':
+            if (value.substr(0, 3) != "420" || value == "420p10" || value == "420p12" || value == "420p16")
+            {
+                error("FILE", "Unsupported Y4M color space '%.*s', only 8 bit 4:2:0 is supported.", int(value.size()), value.data());
+                return false;
+            }
+            break;
+        default:
+            // Aspect ratio and extensions don't matter to us
+            break;
+        }
+    }
+
+    return true;
+}
+} // namespace
+
+class FileDevice : public IDevice
+{
+  public:
+    FileDevice(std::shared_ptr<MappedFile> file, const std::string& name, bool realTime)
+        : m_file(std::move(file)), m_name(name), m_realTime(realTime), m_framePool(FramePool::create())
+    {
+    }
+
+    virtual std::string getName() const override
+    {
+        return m_name;
+    }
+
+    bool initRaw(const FileVideoInput::Options& options)
+    {
+        m_videoWidth = options.width;
+        m_videoHeight = options.height;
+        m_fps = options.fps;
+        m_videoFormat = options.videoFormat;
+
+        size_t frameSize = GetVideoFormatInfo(m_videoFormat).getPackedSize(m_videoWidth, m_videoHeight);
+        if (frameSize == 0)
+        {
+            error("FILE", "Raw files need a valid video format and frame size.");
+            return false;
+        }
+
+        for (size_t offset = 0; offset + frameSize <= m_file->size(); offset += frameSize)
+        {
+            m_frames.push_back({m_file->data() + offset, frameSize});
+        }
+
+        if (m_file->size() % frameSize)
+        {
+            warning("FILE", "File size isn't a multiple of the frame size, ignoring %d trailing bytes.", int(m_file->size() % frameSize));
+        }
+
+        return finishInit();
+    }
+
+    bool initY4M()
+    {
+        std::string_view contents(reinterpret_cast<const char*>(m_file->data()), m_file->size());
+
+        size_t headerEnd = contents.find('\n');
+        if (headerEnd == std::string_view::npos || !ParseY4MHeader(contents.substr(0, headerEnd), m_videoWidth, m_videoHeight, m_fps, m_videoFormat, m_fieldOrder))
+        {
+            error("FILE", "Couldn't parse Y4M header.");
+            return false;
+        }
+
+        size_t frameSize = GetVideoFormatInfo(m_videoFormat).getPackedSize(m_videoWidth, m_videoHeight);
+        if (frameSize == 0)
+        {
+            error("FILE", "Y4M header has an invalid frame size.");
+            return false;
+        }
+
+        // Index all frames once up front so that streaming never has to parse anything.
+        // Every frame is preceded by a "FRAME" line which may carry parameters.
+        constexpr std::string_view frameSignature = "FRAME";
+
+        size_t offset = headerEnd + 1;
+        while (offset < contents.size())
+        {
+            if (contents.substr(offset, frameSignature.size()) != frameSignature)
+            {
+                error("FILE", "Y4M frame %d is missing its frame header.", int(m_frames.size()));
+                return false;
+            }
+
+            size_t frameHeaderEnd = contents.find('\n', offset);
+            if (frameHeaderEnd == std::string_view::npos || frameHeaderEnd + 1 + frameSize > contents.size())
+            {
+                warning("FILE", "Y4M file ends with a truncated frame, ignoring it.");
+                break;
+            }
+
+            m_frames.push_back({m_file->data() + frameHeaderEnd + 1, frameSize});
+            offset = frameHeaderEnd + 1 + frameSize;
+        }
+
+        return finishInit();
+    }
+
+    virtual void stream(std::atomic<bool>& run, IDeviceSampleHandler* sampleHandler, IVideoStreamSampleConsumer* sampleConsumer) override
+    {
+        m_frameId = 0;
+
+        const auto startTime = std::chrono::steady_clock::now();
+
+        while (run)
+        {
+            Trace::Capture_WaitForNextSample(m_frameId);
+
+            // The time stamps are continuous over the whole replay, even though the file is looped
+            std::chrono::nanoseconds timeStampNs(static_cast<int64_t>(m_frameId * 1e9 * m_fps.denominator / m_fps.numerator));
+
+            if (m_realTime)
+            {
+                std::this_thread::sleep_until(startTime + timeStampNs);
+            }
+
+            const auto& frame = m_frames[m_frameId % m_frames.size()];
+
+            Trace::Capture_SampleReady(m_frameId, timeStampNs);
+
+            if (sampleHandler)
+            {
+                // Frames point straight into the mapping, which the hook shares so that it outlives the device if the pipeline keeps a frame
+                FrameRef frameRef = m_framePool->acquire();
+                frameRef->setReleaseHook([file = m_file]() {});
+                frameRef->timeStamp = timeStampNs;
+                frameRef->frameId = m_frameId;
+                frameRef->videoFormat = m_videoFormat;
+                frameRef->width = m_videoWidth;
+                frameRef->height = m_videoHeight;
+                frameRef->setPackedData(frame.data(), frame.size());
+
+                sampleHandler->onSample(frameRef, sampleConsumer);
+            }
+
+            m_frameId++;
+        }
+    }
+
+    virtual void getFrameSize(uint32_t& width, uint32_t& height) const override
+    {
+        width = m_videoWidth;
+        height = m_videoHeight;
+    }
+
+    virtual Ratio getFrameRate() const override
+    {
+        return m_fps;
+    }
+
+    virtual VideoFormat getVideoFormat() const override
+    {
+        return m_videoFormat;
+    }
+
+    virtual FieldOrder getFieldOrder() const override
+    {
+        return m_fieldOrder;
+    }
+
+  private:
+    bool finishInit()
+    {
+        if (m_fps.numerator == 0 || m_fps.denominator == 0)
+        {
+            error("FILE", "File has an invalid frame rate.");
+            return false;
+        }
+
+        if (m_frames.empty())
+        {
+            error("FILE", "File doesn't contain a single complete frame.");
+            return false;
+        }
+
+        info("FILE", "Video format %d x %d @ %.2f FPS, format: %d, %d frames%s", m_videoWidth, m_videoHeight, m_fps.asFloat(), (int)m_videoFormat, int(m_frames.size()),
+             m_realTime ? "" : ", unpaced");
+
+        return true;
+    }
+
+    std::shared_ptr<MappedFile> m_file;
+    std::string m_name;
+
+    std::vector<std::span<const std::byte>> m_frames;
+
+    uint32_t m_videoWidth = 0;
+    uint32_t m_videoHeight = 0;
+
+    Ratio m_fps;
+
+    uint64_t m_frameId = 0;
+
+    VideoFormat m_videoFormat = VideoFormat::Unknown;
+    FieldOrder m_fieldOrder = FieldOrder::Progressive;
+
+    bool m_realTime = true;
+
+    std::shared_ptr<FramePool> m_framePool;
+};
+
+FileVideoInput::FileVideoInput() = default;
+FileVideoInput::~FileVideoInput() = default;
+
+std::shared_ptr<IDevice> FileVideoInput::instantiateDevice(const std::string& path, const Options& options)
+{
+    info("FILE", "Trying to open file '%s'", path.c_str());
+
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(path))
+    {
+        error("FILE", "Couldn't map file '%s'.", path.c_str());
+        return nullptr;
+    }
+
+    const bool isY4M = path.size() >= 4 && path.compare(path.size() - 4, 4, ".y4m") == 0;
+
+    auto retVal = std::make_shared<FileDevice>(std::move(file), path, options.realTime);
+
+    if (!(isY4M ? retVal->initY4M() : retVal->initRaw(options)))
+    {
+        return nullptr;
+    }
+
+    return retVal;
+}
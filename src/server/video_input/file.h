@@ -0,0 +1,26 @@
+#pragma once
+
+#include "device.h"
+
+// Replays frames from a raw (headerless NV12 / BGRA) or Y4M file as if it was a capture device.
+// The file is memory mapped and frames are handed to the sample handler straight from the mapping.
+class FileVideoInput
+{
+  public:
+    struct Options
+    {
+        // Only used for raw files, Y4M files carry this information in their header
+        IDevice::VideoFormat videoFormat = IDevice::VideoFormat::NV12;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        Ratio fps = {60, 1};
+
+        // Pace the frames to the frame rate of the file, otherwise frames are delivered as fast as possible
+        bool realTime = true;
+    };
+
+    FileVideoInput();
+    ~FileVideoInput();
+
+    std::shared_ptr<IDevice> instantiateDevice(const std::string& path, const Options& options);
+};
@@ -0,0 +1,255 @@
+#include "frame.h"
+#include "video_format.h"
+
+FrameRef::FrameRef(const FrameRef& other) : m_frame(other.m_frame)
+{
+    if (m_frame)
+    {
+        m_frame->addRef();
+    }
+}
+
+FrameRef::FrameRef(FrameRef&& other) noexcept : m_frame(other.m_frame)
+{
+    other.m_frame = nullptr;
+}
+
+FrameRef::~FrameRef()
+{
+    reset();
+}
+
+FrameRef& FrameRef::operator=(const FrameRef& other)
+{
+    if (other.m_frame)
+    {
+        other.m_frame->addRef();
+    }
+
+    reset();
+    m_frame = other.m_frame;
+
+    return *this;
+}
+
+FrameRef& FrameRef::operator=(FrameRef&& other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        m_frame = other.m_frame;
+        other.m_frame = nullptr;
+    }
+
+    return *this;
+}
+
+void FrameRef::reset()
+{
+    if (m_frame)
+    {
+        m_frame->release();
+        m_frame = nullptr;
+    }
+}
+
+Frame* FrameRef::detach()
+{
+    Frame* frame = m_frame;
+    m_frame = nullptr;
+    return frame;
+}
+
+FrameRef FrameRef::adopt(Frame* frame)
+{
+    return FrameRef(frame);
+}
+
+void Frame::Plane::copyTo(void* destination, size_t destinationPitch) const
+{
+    std::byte* destinationBytes = static_cast<std::byte*>(destination);
+
+    if (rows == 0)
+    {
+        return;
+    }
+
+    if (pitch == destinationPitch)
+    {
+        std::memcpy(destinationBytes, data, size_t(pitch) * (rows - 1) + rowSize);
+        return;
+    }
+
+    for (uint32_t y = 0; y < rows; ++y)
+    {
+        std::memcpy(destinationBytes + y * destinationPitch, getRow(y), rowSize);
+    }
+}
+
+bool Frame::setData(const void* data, size_t dataSize, uint32_t pitch)
+{
+    const VideoFormatInfo& format = GetVideoFormatInfo(videoFormat);
+    const std::byte* planeData = static_cast<const std::byte*>(data);
+
+    // The whole buffer is the image, its size is all that is known before decoding it
+    if (format.compressed)
+    {
+        planeCount = 1;
+        planes[0] = {planeData, uint32_t(dataSize), uint32_t(dataSize), 1};
+        return dataSize > 0;
+    }
+
+    planeCount = format.planeCount;
+    if (planeCount == 0)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < planeCount; ++i)
+    {
+        const PlaneFormat& planeFormat = format.planes[i];
+        const uint32_t rowSize = planeFormat.getRowSize(width);
+
+        // Packed chroma rows have their own size, which is rounded up for odd widths and can exceed the luma rows of NV12.
+        // Padded ones are the luma pitch or a fraction of it.
+        uint32_t planePitch = pitch;
+        if (i > 0 && pitch == planes[0].rowSize)
+        {
+            planePitch = rowSize;
+        }
+        else if (planeFormat.pitchShift > 0)
+        {
+            planePitch = pitch >> planeFormat.pitchShift;
+        }
+
+        planes[i] = {planeData, planePitch, rowSize, planeFormat.getRows(height)};
+
+        if (planes[i].pitch < planes[i].rowSize)
+        {
+            return false;
+        }
+
+        planeData = planes[i].getRow(planes[i].rows);
+    }
+
+    const Plane& lastPlane = planes[planeCount - 1];
+    return lastPlane.getRow(lastPlane.rows - 1) + lastPlane.rowSize <= static_cast<const std::byte*>(data) + dataSize;
+}
+
+bool Frame::setPackedData(const void* data, size_t dataSize)
+{
+    return setData(data, dataSize, GetVideoFormatInfo(videoFormat).planes[0].getRowSize(width));
+}
+
+bool Frame::crop(const FrameRect& rect)
+{
+    const VideoFormatInfo& format = GetVideoFormatInfo(videoFormat);
+
+    if (format.planeCount == 0 || rect.isEmpty() || (rect.x | rect.y | rect.width | rect.height) & 1 || rect.x + rect.width > width || rect.y + rect.height > height)
+    {
+        return false;
+    }
+
+    // Even coordinates never split a sample, the formats subsample by at most two
+    for (uint32_t i = 0; i < planeCount; ++i)
+    {
+        const PlaneFormat& planeFormat = format.planes[i];
+
+        Plane& plane = planes[i];
+        plane.data = plane.getRow(rect.y >> planeFormat.shiftY) + size_t(rect.x >> planeFormat.shiftX) * planeFormat.bytesPerSample;
+        plane.rowSize = planeFormat.getRowSize(rect.width);
+        plane.rows = planeFormat.getRows(rect.height);
+    }
+
+    width = rect.width;
+    height = rect.height;
+
+    // The exported buffer still holds the whole frame
+    dmaBufFd = -1;
+
+    return true;
+}
+
+void Frame::release()
+{
+    if (m_refCount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+
+    if (m_releaseHook)
+    {
+        m_releaseHook();
+        m_releaseHook = nullptr;
+    }
+
+    // Keep the pool alive until the frame is recycled, this might be the last reference to it
+    auto pool = std::move(m_pool);
+    pool->recycle(this);
+}
+
+std::shared_ptr<FramePool> FramePool::create()
+{
+    return std::shared_ptr<FramePool>(new FramePool());
+}
+
+FramePool::~FramePool() = default;
+
+FrameRef FramePool::acquire()
+{
+    std::unique_ptr<Frame> frame;
+
+    {
+        std::lock_guard _(m_mutex);
+
+        if (!m_freeFrames.empty())
+        {
+            frame = std::move(m_freeFrames.back());
+            m_freeFrames.pop_back();
+        }
+    }
+
+    if (!frame)
+    {
+        frame = std::make_unique<Frame>();
+    }
+
+    frame->timeStamp = std::chrono::nanoseconds(0);
+    frame->frameId = 0;
+    frame->videoFormat = IDevice::VideoFormat::Unknown;
+    frame->width = 0;
+    frame->height = 0;
+    frame->planes = {};
+    frame->planeCount = 0;
+    frame->dmaBufFd = -1;
+
+    frame->m_pool = shared_from_this();
+    frame->m_refCount.store(1, std::memory_order_relaxed);
+
+    return FrameRef(frame.release());
+}
+
+FrameRef FramePool::acquireView(const FrameRef& source)
+{
+    FrameRef frame = acquire();
+
+    frame->timeStamp = source->timeStamp;
+    frame->frameId = source->frameId;
+    frame->videoFormat = source->videoFormat;
+    frame->width = source->width;
+    frame->height = source->height;
+    frame->planes = source->planes;
+    frame->planeCount = source->planeCount;
+    frame->dmaBufFd = source->dmaBufFd;
+
+    // The hook holds a reference to the source, which is dropped when the hook is cleared after the view's release
+    frame->setReleaseHook([source]() {});
+
+    return frame;
+}
+
+void FramePool::recycle(Frame* frame)
+{
+    std::lock_guard _(m_mutex);
+    m_freeFrames.emplace_back(frame);
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include "device.h"
+
+class Frame;
+class FramePool;
+
+// A rectangle within a frame in pixels
+struct FrameRect
+{
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    bool isEmpty() const
+    {
+        return width == 0 || height == 0;
+    }
+
+    bool operator==(const FrameRect& other) const = default;
+};
+
+// Intrusive reference to a pooled frame, the frame goes back to its pool once the last reference is gone
+class FrameRef
+{
+  public:
+    FrameRef() = default;
+    FrameRef(const FrameRef& other);
+    FrameRef(FrameRef&& other) noexcept;
+    ~FrameRef();
+
+    FrameRef& operator=(const FrameRef& other);
+    FrameRef& operator=(FrameRef&& other) noexcept;
+
+    void reset();
+
+    // Gives up ownership of the reference without releasing it, adopt() turns it back into a FrameRef
+    Frame* detach();
+    static FrameRef adopt(Frame* frame);
+
+    Frame* get() const
+    {
+        return m_frame;
+    }
+
+    Frame* operator->() const
+    {
+        return m_frame;
+    }
+
+    Frame& operator*() const
+    {
+        return *m_frame;
+    }
+
+    explicit operator bool() const
+    {
+        return m_frame != nullptr;
+    }
+
+  private:
+    friend FramePool;
+
+    // Adopts the reference, doesn't increment the reference count
+    explicit FrameRef(Frame* frame) : m_frame(frame)
+    {
+    }
+
+    Frame* m_frame = nullptr;
+};
+
+// A captured video frame. Unlike the data passed to the old raw pointer interface a frame can be kept
+// by a sample handler after onSample() returned, the memory stays valid until the last FrameRef is gone.
+// The source buffer (e.g. a locked media foundation buffer) is handed back through the release hook.
+class Frame
+{
+  public:
+    static constexpr size_t MaxPlanes = 3;
+
+    // Rows can be padded, the pitch is the distance between the starts of two rows in bytes
+    struct Plane
+    {
+        const std::byte* data = nullptr;
+        uint32_t pitch = 0;
+        uint32_t rowSize = 0; // Bytes of visible data per row
+        uint32_t rows = 0;
+
+        const std::byte* getRow(uint32_t y) const
+        {
+            return data + size_t(y) * pitch;
+        }
+
+        // Copies the visible part of the plane, uses a single copy if the pitches match
+        void copyTo(void* destination, size_t destinationPitch) const;
+    };
+
+    std::chrono::nanoseconds timeStamp{0};
+    uint64_t frameId = 0;
+
+    IDevice::VideoFormat videoFormat = IDevice::VideoFormat::Unknown;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    std::array<Plane, MaxPlanes> planes;
+    uint32_t planeCount = 0;
+
+    // DMABUF file descriptor of the capture buffer if the source exported one (V4L2), -1 otherwise.
+    // Owned by the source, lets a consumer import the frame into the GPU instead of reading the planes.
+    int dmaBufFd = -1;
+
+    // Fills in the planes for data in the frame's video format and size, with the planes stored one after another.
+    // The pitch is the one of the first plane, the chroma planes of I420 use half of it. A pitch equal to the first plane's row size
+    // means packed data, whose chroma rows are rounded up for odd widths like in getPackedSize(). Returns false if the data is too small.
+    // Sources with separately allocated planes fill in the planes directly instead.
+    bool setData(const void* data, size_t dataSize, uint32_t pitch);
+
+    // Same as setData() for rows without padding
+    bool setPackedData(const void* data, size_t dataSize);
+
+    // Narrows the frame to the rectangle by moving the start of every plane, no pixels are copied.
+    // The rectangle needs to lie within the frame and start and end on even pixels, so that no chroma sample is split.
+    bool crop(const FrameRect& rect);
+
+    // Called once the last reference to the frame is released, before the frame goes back to the pool.
+    // Frames can outlive the device which captured them, so the hook has to own what it touches, e.g. through a shared_ptr.
+    void setReleaseHook(std::function<void()> releaseHook)
+    {
+        m_releaseHook = std::move(releaseHook);
+    }
+
+  private:
+    friend FrameRef;
+    friend FramePool;
+
+    void addRef()
+    {
+        m_refCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release();
+
+    std::atomic<uint32_t> m_refCount = 0;
+    std::function<void()> m_releaseHook;
+
+    // Keeps the pool alive as long as the frame is in use
+    std::shared_ptr<FramePool> m_pool;
+};
+
+// Recycles frame objects so that capturing doesn't allocate per frame. Frames can be released on any thread.
+class FramePool : public std::enable_shared_from_this<FramePool>
+{
+  public:
+    static std::shared_ptr<FramePool> create();
+
+    ~FramePool();
+
+    // Returns a reset frame with a reference count of one
+    FrameRef acquire();
+
+    // Returns a frame describing the same pixels as the source, which keeps the source alive until the view is released.
+    // Lets a consumer crop a frame without changing it for the others.
+    FrameRef acquireView(const FrameRef& source);
+
+  private:
+    friend Frame;
+
+    FramePool() = default;
+
+    void recycle(Frame* frame);
+
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<Frame>> m_freeFrames;
+};
+
+// Recycles the buffers which a source writes its frames into, e.g. std::vector<std::byte>. A buffer is handed out again
+// once the last reference to the frame using it is released. The frame's release hook shares the buffer, so that a frame
+// kept by the pipeline stays valid after the source and its pool are gone. Acquiring isn't thread safe, frames can be released on any thread.
+template <typename Buffer>
+class BufferPool
+{
+  public:
+    // Returns a buffer which no frame uses anymore, or a new default constructed one if all of them are still in use.
+    // The buffer keeps its contents from its last use and belongs to the frame until the frame is released.
+    Buffer& acquire(Frame& frame)
+    {
+        std::shared_ptr<Slot> slot;
+        for (auto& candidate : m_slots)
+        {
+            if (!candidate->inUse.load(std::memory_order_acquire))
+            {
+                slot = candidate;
+                break;
+            }
+        }
+
+        if (!slot)
+        {
+            slot = std::make_shared<Slot>();
+            m_slots.push_back(slot);
+        }
+
+        slot->inUse.store(true, std::memory_order_relaxed);
+        frame.setReleaseHook([slot]() { slot->inUse.store(false, std::memory_order_release); });
+
+        return slot->buffer;
+    }
+
+  private:
+    struct Slot
+    {
+        Buffer buffer;
+        std::atomic<bool> inUse = false;
+    };
+
+    std::vector<std::shared_ptr<Slot>> m_slots;
+};
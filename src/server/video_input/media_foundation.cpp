@@ -1,5 +1,6 @@
 
 #include "media_foundation.h"
+#include "frame.h"
 #include "trace_logging.h"
 
 #include <mfapi.h>
@@ -82,6 +83,80 @@ std::string GetDeviceName(IMFActivate* device)
 
     return {};
 }
+
+struct SubTypeMapping
+{
+    GUID subType;
+    IDevice::VideoFormat videoFormat;
+};
+
+const SubTypeMapping SubTypeMappings[] = {
+    {MFVideoFormat_NV12, IDevice::VideoFormat::NV12},
+    {MFVideoFormat_I420, IDevice::VideoFormat::I420},
+    {MFVideoFormat_IYUV, IDevice::VideoFormat::I420},
+    {MFVideoFormat_YUY2, IDevice::VideoFormat::YUY2},
+    {MFVideoFormat_UYVY, IDevice::VideoFormat::UYVY},
+    {MFVideoFormat_ARGB32, IDevice::VideoFormat::BGRA},
+    {MFVideoFormat_RGB24, IDevice::VideoFormat::RGB24},
+    {MFVideoFormat_P010, IDevice::VideoFormat::P010},
+    {MFVideoFormat_MJPG, IDevice::VideoFormat::MJPEG},
+};
+
+IDevice::VideoFormat GetVideoFormat(const GUID& subType)
+{
+    for (const auto& mapping : SubTypeMappings)
+    {
+        if (mapping.subType == subType)
+        {
+            return mapping.videoFormat;
+        }
+    }
+
+    return IDevice::VideoFormat::Unknown;
+}
+
+GUID GetSubType(IDevice::VideoFormat videoFormat)
+{
+    for (const auto& mapping : SubTypeMappings)
+    {
+        if (mapping.videoFormat == videoFormat)
+        {
+            return mapping.subType;
+        }
+    }
+
+    return GUID_NULL;
+}
+
+IDevice::VideoMode GetVideoMode(IMFMediaType* mediaType)
+{
+    IDevice::VideoMode mode;
+
+    {
+        UINT64 frameSize = 0;
+        mediaType->GetUINT64(MF_MT_FRAME_SIZE, &frameSize);
+
+        mode.width = HI32(frameSize);
+        mode.height = LO32(frameSize);
+    }
+
+    {
+        UINT64 frameRate = 0;
+        mediaType->GetUINT64(MF_MT_FRAME_RATE, &frameRate);
+
+        mode.fps.numerator = HI32(frameRate);
+        mode.fps.denominator = LO32(frameRate);
+    }
+
+    {
+        GUID format = GUID_NULL;
+        mediaType->GetGUID(MF_MT_SUBTYPE, &format);
+
+        mode.videoFormat = GetVideoFormat(format);
+    }
+
+    return mode;
+}
 } // namespace
 
 MediaFoundationVideoInput::MediaFoundationVideoInput()
@@ -114,7 +189,7 @@ std::vector<std::string> MediaFoundationVideoInput::enumerateDevices()
 class Device : public IDevice
 {
   public:
-    Device(ComPtr<IMFMediaSource> device, const std::string& name) : m_device(device), m_name(name)
+    Device(ComPtr<IMFMediaSource> device, const std::string& name) : m_device(device), m_name(name), m_framePool(FramePool::create())
     {
     }
 
@@ -139,81 +214,47 @@ class Device : public IDevice
             return false;
         }
 
-        // Build a new media type which uses NV12 as the format (YUV 4:2:0) so that we can natively pass
-        // the buffers to nvenc
-        ComPtr<IMFMediaType> newMediaType;
-        MFCreateMediaType(&newMediaType);
+        // Start with whatever the device is configured for, SelectVideoMode() picks the best mode later
+        return readCurrentMediaType();
+    }
 
-        newMediaType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+    virtual std::vector<VideoMode> enumerateVideoModes() const override
+    {
+        std::vector<VideoMode> retVal;
 
-        switch (m_videoFormat)
+        ComPtr<IMFMediaType> mediaType;
+        for (DWORD i = 0; SUCCEEDED(m_sourceReader->GetNativeMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, i, &mediaType)); ++i)
         {
-        case VideoFormat::BGRA:
-            newMediaType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_ARGB32);
-            break;
-        case VideoFormat::NV12:
-            newMediaType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_NV12);
-            break;
-        default:
-            error("MF", "Can't set 'Unknown' as the video format.");
-            return false;
+            retVal.push_back(::GetVideoMode(mediaType.Get()));
+            mediaType = nullptr;
         }
 
-        // Try to set the media type
-        if (FAILED(m_sourceReader->SetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, nullptr, newMediaType.Get())))
-        {
-            warning("MF", "Failed to set media type with NV12 as the format. Will need to perform a conversion to NV12 on a per frame basis.");
-        }
+        return retVal;
+    }
 
-        // Get the media type after we made the change.
-        ComPtr<IMFMediaType> mediaType;
-        if (FAILED(m_sourceReader->GetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, &mediaType)))
+    virtual bool setVideoMode(const VideoMode& mode) override
+    {
+        GUID subType = ::GetSubType(mode.videoFormat);
+        if (subType == GUID_NULL)
         {
-            error("MF", "Failed to get media type.");
             return false;
         }
 
-        {
-            UINT64 frameSize = 0;
-            mediaType->GetUINT64(MF_MT_FRAME_SIZE, &frameSize);
-
-            m_videoWidth = HI32(frameSize);
-            m_videoHeight = LO32(frameSize);
-        }
-
-        {
-            UINT64 frameRate = 0;
-            mediaType->GetUINT64(MF_MT_FRAME_RATE, &frameRate);
+        // Build the media type directly instead of looking up the native one, so that a cached mode doesn't need probing
+        ComPtr<IMFMediaType> newMediaType;
+        MFCreateMediaType(&newMediaType);
 
-            m_fps.numerator = HI32(frameRate);
-            m_fps.denominator = LO32(frameRate);
-        }
+        newMediaType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+        newMediaType->SetGUID(MF_MT_SUBTYPE, subType);
+        MFSetAttributeSize(newMediaType.Get(), MF_MT_FRAME_SIZE, mode.width, mode.height);
+        MFSetAttributeRatio(newMediaType.Get(), MF_MT_FRAME_RATE, mode.fps.numerator, mode.fps.denominator);
 
+        if (FAILED(m_sourceReader->SetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, nullptr, newMediaType.Get())))
         {
-            GUID format;
-            mediaType->GetGUID(MF_MT_SUBTYPE, &format);
-
-            if (format == MFVideoFormat_ARGB32)
-            {
-                m_videoFormat = VideoFormat::BGRA;
-            }
-            else if (format == MFVideoFormat_NV12)
-            {
-                m_videoFormat = VideoFormat::NV12;
-            }
-            else if (format == MFVideoFormat_RGB24)
-            {
-                m_videoFormat = VideoFormat::RGB24;
-            }
-            else
-            {
-                m_videoFormat = VideoFormat::Unknown;
-            }
+            return false;
         }
 
-        info("MF", "Video format %d x %d @ %.2f FPS, format: %d", m_videoWidth, m_videoHeight, m_fps.asFloat(), (int)m_videoFormat);
-
-        return true;
+        return readCurrentMediaType();
     }
 
     virtual void stream(std::atomic<bool>& run, IDeviceSampleHandler* sampleHandler, IVideoStreamSampleConsumer* sampleConsumer) override
@@ -252,13 +293,23 @@ class Device : public IDevice
 
                     if (buffer && sampleHandler)
                     {
-                        BYTE* data = nullptr;
-                        DWORD maxLength = 0, currentLength = 0;
-                        if (SUCCEEDED(buffer->Lock(&data, &maxLength, &currentLength)))
-                        {
-                            sampleHandler->onSample(timeStampNs, data, currentLength, m_frameId, sampleConsumer);
+                        FrameRef frame = m_framePool->acquire();
 
-                            buffer->Unlock();
+                        frame->timeStamp = timeStampNs;
+                        frame->frameId = m_frameId;
+                        frame->videoFormat = m_videoFormat;
+                        frame->width = m_videoWidth;
+                        frame->height = m_videoHeight;
+
+                        // The buffer stays locked until the sample handler releases the frame
+                        if (lockBuffer(buffer, *frame))
+                        {
+                            sampleHandler->onSample(frame, sampleConsumer);
+                        }
+                        else
+                        {
+                            error("MF", "Failed to lock sample buffer or it is too small for the video format.");
+                            Trace::Capture_SampleFailed(m_frameId);
                         }
                     }
                 }
@@ -289,11 +340,96 @@ class Device : public IDevice
         return m_videoFormat;
     }
 
+    virtual FieldOrder getFieldOrder() const override
+    {
+        return m_fieldOrder;
+    }
+
   private:
+    // Locks the buffer and points the frame's planes at it. 2D buffers are locked without making them contiguous,
+    // so padded rows are passed along as they are instead of being repacked by media foundation.
+    bool lockBuffer(ComPtr<IMFMediaBuffer> buffer, Frame& frame)
+    {
+        ComPtr<IMF2DBuffer2> buffer2D;
+        if (SUCCEEDED(buffer.As(&buffer2D)))
+        {
+            BYTE* scanLine0 = nullptr;
+            BYTE* bufferStart = nullptr;
+            LONG pitch = 0;
+            DWORD bufferLength = 0;
+
+            if (SUCCEEDED(buffer2D->Lock2DSize(MF2DBuffer_LockFlags_Read, &scanLine0, &pitch, &bufferStart, &bufferLength)))
+            {
+                if (pitch > 0)
+                {
+                    frame.setReleaseHook([buffer2D]() { buffer2D->Unlock2D(); });
+                    return frame.setData(scanLine0, bufferLength - (scanLine0 - bufferStart), pitch);
+                }
+
+                // Bottom up images have a negative pitch, which the frame doesn't support. Their contiguous copy is
+                // streamed instead, like before 2D buffers were locked directly.
+                buffer2D->Unlock2D();
+            }
+        }
+
+        BYTE* data = nullptr;
+        DWORD maxLength = 0, currentLength = 0;
+        if (FAILED(buffer->Lock(&data, &maxLength, &currentLength)))
+        {
+            return false;
+        }
+
+        frame.setReleaseHook([buffer]() { buffer->Unlock(); });
+
+        return frame.setPackedData(data, currentLength);
+    }
+
+    bool readCurrentMediaType()
+    {
+        ComPtr<IMFMediaType> mediaType;
+        if (FAILED(m_sourceReader->GetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, &mediaType)))
+        {
+            error("MF", "Failed to get media type.");
+            return false;
+        }
+
+        const VideoMode mode = ::GetVideoMode(mediaType.Get());
+
+        m_videoWidth = mode.width;
+        m_videoHeight = mode.height;
+        m_fps = mode.fps;
+        m_videoFormat = mode.videoFormat;
+
+        // Mixed content is treated as top field first, the deinterlacer leaves static progressive content alone
+        UINT32 interlaceMode = MFVideoInterlace_Progressive;
+        mediaType->GetUINT32(MF_MT_INTERLACE_MODE, &interlaceMode);
+
+        switch (interlaceMode)
+        {
+        case MFVideoInterlace_FieldInterleavedUpperFirst:
+        case MFVideoInterlace_MixedInterlaceOrProgressive:
+            m_fieldOrder = FieldOrder::TopFieldFirst;
+            break;
+        case MFVideoInterlace_FieldInterleavedLowerFirst:
+            m_fieldOrder = FieldOrder::BottomFieldFirst;
+            break;
+        default:
+            m_fieldOrder = FieldOrder::Progressive;
+            break;
+        }
+
+        info("MF", "Video format %d x %d @ %.2f FPS, format: %d%s", m_videoWidth, m_videoHeight, m_fps.asFloat(), (int)m_videoFormat,
+             m_fieldOrder != FieldOrder::Progressive ? ", interlaced" : "");
+
+        return true;
+    }
+
     ComPtr<IMFMediaSource> m_device;
     ComPtr<IMFSourceReader> m_sourceReader;
     std::string m_name;
 
+    std::shared_ptr<FramePool> m_framePool;
+
     uint32_t m_videoWidth = 0;
     uint32_t m_videoHeight = 0;
 
@@ -302,6 +438,7 @@ class Device : public IDevice
     uint64_t m_frameId = 0;
 
     VideoFormat m_videoFormat = VideoFormat::NV12;
+    FieldOrder m_fieldOrder = FieldOrder::Progressive;
 };
 
 std::shared_ptr<IDevice> MediaFoundationVideoInput::instantiateDevice(const std::string& name)
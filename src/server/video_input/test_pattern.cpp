@@ -0,0 +1,419 @@
+#include "test_pattern.h"
+#include "frame.h"
+#include "trace_logging.h"
+#include "video_format.h"
+
+#include <bit>
+#include <thread>
+
+namespace
+{
+// Describes where a plane lives inside a frame and how it is subsampled
+struct Plane
+{
+    size_t offset = 0;
+    uint32_t pitch = 0;
+    uint32_t bytesPerSample = 0;
+    uint32_t shiftX = 0;
+    uint32_t shiftY = 0;
+};
+
+struct Rect
+{
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+struct RGB
+{
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+};
+
+std::vector<Plane> GetPlaneLayout(IDevice::VideoFormat videoFormat, uint32_t width, uint32_t height)
+{
+    const VideoFormatInfo& format = GetVideoFormatInfo(videoFormat);
+
+    std::vector<Plane> planes;
+    size_t offset = 0;
+
+    for (uint32_t i = 0; i < format.planeCount; ++i)
+    {
+        const PlaneFormat& planeFormat = format.planes[i];
+        const uint32_t pitch = planeFormat.getRowSize(width);
+
+        planes.push_back({offset, pitch, planeFormat.bytesPerSample, planeFormat.shiftX, planeFormat.shiftY});
+        offset += size_t(pitch) * planeFormat.getRows(height);
+    }
+
+    return planes;
+}
+
+// Returns the bytes of one sample of the given color for every plane of the format (BT.709 limited range for YUV)
+std::vector<std::array<uint8_t, 4>> GetPlaneSamples(IDevice::VideoFormat videoFormat, RGB color)
+{
+    const float y = 16.0f + 0.1826f * color.r + 0.6142f * color.g + 0.0620f * color.b;
+    const float u = 128.0f - 0.1006f * color.r - 0.3386f * color.g + 0.4392f * color.b;
+    const float v = 128.0f + 0.4392f * color.r - 0.3989f * color.g - 0.0403f * color.b;
+
+    const uint8_t y8 = static_cast<uint8_t>(y + 0.5f);
+    const uint8_t u8 = static_cast<uint8_t>(u + 0.5f);
+    const uint8_t v8 = static_cast<uint8_t>(v + 0.5f);
+
+    switch (videoFormat)
+    {
+    case IDevice::VideoFormat::BGRA:
+        return {{color.b, color.g, color.r, 255}};
+    case IDevice::VideoFormat::RGB24:
+        return {{color.b, color.g, color.r, 0}};
+    case IDevice::VideoFormat::NV12:
+        return {{y8, 0, 0, 0}, {u8, v8, 0, 0}};
+    case IDevice::VideoFormat::I420:
+        return {{y8, 0, 0, 0}, {u8, 0, 0, 0}, {v8, 0, 0, 0}};
+    case IDevice::VideoFormat::YUY2:
+        return {{y8, u8, y8, v8}};
+    case IDevice::VideoFormat::UYVY:
+        return {{u8, y8, v8, y8}};
+    case IDevice::VideoFormat::P010:
+    {
+        // Little endian 16 bit samples with the 10 bit value in the upper bits
+        const uint16_t y16 = uint16_t(uint16_t(y * 4.0f + 0.5f) << 6);
+        const uint16_t u16 = uint16_t(uint16_t(u * 4.0f + 0.5f) << 6);
+        const uint16_t v16 = uint16_t(uint16_t(v * 4.0f + 0.5f) << 6);
+
+        return {{uint8_t(y16), uint8_t(y16 >> 8), 0, 0}, {uint8_t(u16), uint8_t(u16 >> 8), uint8_t(v16), uint8_t(v16 >> 8)}};
+    }
+    default:
+        return {};
+    }
+}
+
+// A solid color prepared as one full width row per plane, so that filling any rectangle
+// is just a memcpy per row and plane.
+class ColorTile
+{
+  public:
+    ColorTile(IDevice::VideoFormat videoFormat, const std::vector<Plane>& planes, uint32_t width, RGB color)
+    {
+        auto samples = GetPlaneSamples(videoFormat, color);
+
+        for (size_t i = 0; i < planes.size(); ++i)
+        {
+            const uint32_t sampleCount = width >> planes[i].shiftX;
+
+            std::vector<std::byte> row(size_t(sampleCount) * planes[i].bytesPerSample);
+            for (uint32_t x = 0; x < sampleCount; ++x)
+            {
+                std::memcpy(row.data() + x * planes[i].bytesPerSample, samples[i].data(), planes[i].bytesPerSample);
+            }
+
+            m_rows.push_back(std::move(row));
+        }
+    }
+
+    const std::byte* row(size_t plane) const
+    {
+        return m_rows[plane].data();
+    }
+
+  private:
+    std::vector<std::vector<std::byte>> m_rows;
+};
+
+uint32_t AlignDown2(uint32_t value)
+{
+    return value & ~1u;
+}
+} // namespace
+
+class TestPatternDevice : public IDevice
+{
+  public:
+    TestPatternDevice(const TestPatternVideoInput::Options& options)
+        : m_videoWidth(options.width), m_videoHeight(options.height), m_fps(options.fps), m_videoFormat(options.videoFormat), m_realTime(options.realTime),
+          m_framePool(FramePool::create())
+    {
+    }
+
+    virtual std::string getName() const override
+    {
+        return "Test Pattern";
+    }
+
+    bool init()
+    {
+        // All rectangles are aligned to two pixels so that the chroma planes of the subsampled formats line up
+        if (m_videoWidth < TestPatternVideoInput::BarcodeCellCount * 2 || m_videoHeight < TestPatternVideoInput::BarcodeHeight * 4 || (m_videoWidth | m_videoHeight) & 1)
+        {
+            error("PATTERN", "Frame size %d x %d is invalid, needs to be even and at least %d x %d.", m_videoWidth, m_videoHeight, TestPatternVideoInput::BarcodeCellCount * 2,
+                  TestPatternVideoInput::BarcodeHeight * 4);
+            return false;
+        }
+
+        if (m_fps.numerator == 0 || m_fps.denominator == 0)
+        {
+            error("PATTERN", "Invalid frame rate.");
+            return false;
+        }
+
+        m_planes = GetPlaneLayout(m_videoFormat, m_videoWidth, m_videoHeight);
+        if (m_planes.empty())
+        {
+            error("PATTERN", "Unsupported video format %d.", (int)m_videoFormat);
+            return false;
+        }
+
+        const Plane& lastPlane = m_planes.back();
+        m_frameSize = lastPlane.offset + size_t(lastPlane.pitch) * (m_videoHeight >> lastPlane.shiftY);
+
+        m_blackTile = std::make_unique<ColorTile>(m_videoFormat, m_planes, m_videoWidth, RGB{0, 0, 0});
+        m_whiteTile = std::make_unique<ColorTile>(m_videoFormat, m_planes, m_videoWidth, RGB{255, 255, 255});
+        m_boxTile = std::make_unique<ColorTile>(m_videoFormat, m_planes, m_videoWidth, RGB{255, 128, 0});
+
+        m_cellWidth = AlignDown2(m_videoWidth / TestPatternVideoInput::BarcodeCellCount);
+        m_boxSize = AlignDown2(m_videoHeight / 6);
+
+        // The box crosses the frame in roughly two seconds
+        m_boxSpeed = std::max(2u, AlignDown2(static_cast<uint32_t>((m_videoWidth - m_boxSize) / (2 * m_fps.asFloat()))));
+
+        renderBackground();
+
+        info("PATTERN", "Video format %d x %d @ %.2f FPS, format: %d%s", m_videoWidth, m_videoHeight, m_fps.asFloat(), (int)m_videoFormat, m_realTime ? "" : ", unpaced");
+
+        return true;
+    }
+
+    virtual void stream(std::atomic<bool>& run, IDeviceSampleHandler* sampleHandler, IVideoStreamSampleConsumer* sampleConsumer) override
+    {
+        m_frameId = 0;
+
+        const auto startTime = std::chrono::steady_clock::now();
+
+        while (run)
+        {
+            Trace::Capture_WaitForNextSample(m_frameId);
+
+            if (m_realTime)
+            {
+                std::this_thread::sleep_until(startTime + std::chrono::nanoseconds(static_cast<int64_t>(m_frameId * 1e9 * m_fps.denominator / m_fps.numerator)));
+            }
+
+            // The wall clock is used so that the time stamp can be compared against the clock of the viewer
+            std::chrono::nanoseconds timeStampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());
+
+            FrameRef frame = m_framePool->acquire();
+
+            PatternBuffer& buffer = acquireBuffer(*frame);
+            updateBuffer(buffer, m_frameId, static_cast<uint64_t>(timeStampNs.count()));
+
+            Trace::Capture_SampleReady(m_frameId, timeStampNs);
+
+            frame->timeStamp = timeStampNs;
+            frame->frameId = m_frameId;
+            frame->videoFormat = m_videoFormat;
+            frame->width = m_videoWidth;
+            frame->height = m_videoHeight;
+            frame->setPackedData(buffer.data.data(), buffer.data.size());
+
+            if (sampleHandler)
+            {
+                sampleHandler->onSample(frame, sampleConsumer);
+            }
+
+            m_frameId++;
+        }
+    }
+
+    virtual void getFrameSize(uint32_t& width, uint32_t& height) const override
+    {
+        width = m_videoWidth;
+        height = m_videoHeight;
+    }
+
+    virtual Ratio getFrameRate() const override
+    {
+        return m_fps;
+    }
+
+    virtual VideoFormat getVideoFormat() const override
+    {
+        return m_videoFormat;
+    }
+
+  private:
+    // A frame buffer which remembers what was drawn into it, so that only the changed parts need to be redrawn when it is reused
+    struct PatternBuffer
+    {
+        std::vector<std::byte> data;
+
+        Rect box;
+        bool boxDrawn = false;
+        uint64_t barcodeFrameId = 0;
+        uint64_t barcodeTimeStamp = 0;
+    };
+
+    PatternBuffer& acquireBuffer(Frame& frame)
+    {
+        PatternBuffer& buffer = m_buffers.acquire(frame);
+
+        // All buffers were held by the sample handler, so a new one starts from the background
+        if (buffer.data.empty())
+        {
+            buffer.data = m_background;
+            drawBarcodeGuard(buffer.data.data());
+        }
+
+        return buffer;
+    }
+
+    void fillRect(std::byte* frame, const Rect& rect, const ColorTile& tile) const
+    {
+        for (size_t i = 0; i < m_planes.size(); ++i)
+        {
+            const Plane& plane = m_planes[i];
+            const size_t rowSize = size_t(rect.width >> plane.shiftX) * plane.bytesPerSample;
+
+            std::byte* dst = frame + plane.offset + size_t(rect.x >> plane.shiftX) * plane.bytesPerSample;
+
+            for (uint32_t y = rect.y >> plane.shiftY; y < (rect.y + rect.height) >> plane.shiftY; ++y)
+            {
+                std::memcpy(dst + size_t(y) * plane.pitch, tile.row(i), rowSize);
+            }
+        }
+    }
+
+    void restoreRect(std::byte* frame, const Rect& rect) const
+    {
+        for (const Plane& plane : m_planes)
+        {
+            const size_t rowSize = size_t(rect.width >> plane.shiftX) * plane.bytesPerSample;
+            const size_t rowOffset = plane.offset + size_t(rect.x >> plane.shiftX) * plane.bytesPerSample;
+
+            for (uint32_t y = rect.y >> plane.shiftY; y < (rect.y + rect.height) >> plane.shiftY; ++y)
+            {
+                std::memcpy(frame + rowOffset + size_t(y) * plane.pitch, m_background.data() + rowOffset + size_t(y) * plane.pitch, rowSize);
+            }
+        }
+    }
+
+    Rect getBarcodeCell(uint32_t cell) const
+    {
+        return {cell * m_cellWidth, 0, m_cellWidth, TestPatternVideoInput::BarcodeHeight};
+    }
+
+    void renderBackground()
+    {
+        m_background.resize(m_frameSize);
+
+        // 75% color bars below the barcode strip
+        const RGB bars[] = {{191, 191, 191}, {191, 191, 0}, {0, 191, 191}, {0, 191, 0}, {191, 0, 191}, {191, 0, 0}, {0, 0, 191}, {0, 0, 0}};
+        const uint32_t barCount = static_cast<uint32_t>(std::size(bars));
+
+        for (uint32_t i = 0; i < barCount; ++i)
+        {
+            const uint32_t x0 = AlignDown2(m_videoWidth * i / barCount);
+            const uint32_t x1 = AlignDown2(m_videoWidth * (i + 1) / barCount);
+
+            ColorTile tile(m_videoFormat, m_planes, m_videoWidth, bars[i]);
+            fillRect(m_background.data(), {x0, TestPatternVideoInput::BarcodeHeight, x1 - x0, m_videoHeight - TestPatternVideoInput::BarcodeHeight}, tile);
+        }
+
+        fillRect(m_background.data(), {0, 0, m_videoWidth, TestPatternVideoInput::BarcodeHeight}, *m_blackTile);
+    }
+
+    void drawBarcodeGuard(std::byte* frame) const
+    {
+        for (uint32_t cell = 0; cell < TestPatternVideoInput::BarcodeGuardCells; ++cell)
+        {
+            fillRect(frame, getBarcodeCell(cell), cell % 2 == 0 ? *m_whiteTile : *m_blackTile);
+        }
+    }
+
+    // Only redraws the cells of the bits which changed since the last frame
+    void drawBarcodeValue(std::byte* frame, uint32_t firstCell, uint64_t value, uint64_t previousValue) const
+    {
+        uint64_t changedBits = value ^ previousValue;
+
+        while (changedBits)
+        {
+            const uint32_t bit = static_cast<uint32_t>(std::countr_zero(changedBits));
+            changedBits &= changedBits - 1;
+
+            fillRect(frame, getBarcodeCell(firstCell + 63 - bit), (value >> bit) & 1 ? *m_whiteTile : *m_blackTile);
+        }
+    }
+
+    void updateBuffer(PatternBuffer& buffer, uint64_t frameId, uint64_t timeStamp)
+    {
+        // Move the box, it bounces between the left and right edge of the frame
+        const uint32_t range = m_videoWidth - m_boxSize;
+        const uint64_t position = (frameId * m_boxSpeed) % (2 * uint64_t(range));
+
+        Rect box;
+        box.x = AlignDown2(static_cast<uint32_t>(position < range ? position : 2 * range - position));
+        box.y = AlignDown2((m_videoHeight - m_boxSize) / 2);
+        box.width = m_boxSize;
+        box.height = m_boxSize;
+
+        if (buffer.boxDrawn)
+        {
+            restoreRect(buffer.data.data(), buffer.box);
+        }
+
+        fillRect(buffer.data.data(), box, *m_boxTile);
+        buffer.box = box;
+        buffer.boxDrawn = true;
+
+        drawBarcodeValue(buffer.data.data(), TestPatternVideoInput::BarcodeGuardCells, frameId, buffer.barcodeFrameId);
+        drawBarcodeValue(buffer.data.data(), TestPatternVideoInput::BarcodeGuardCells + 64, timeStamp, buffer.barcodeTimeStamp);
+
+        buffer.barcodeFrameId = frameId;
+        buffer.barcodeTimeStamp = timeStamp;
+    }
+
+    uint32_t m_videoWidth = 0;
+    uint32_t m_videoHeight = 0;
+
+    Ratio m_fps;
+
+    uint64_t m_frameId = 0;
+
+    VideoFormat m_videoFormat = VideoFormat::Unknown;
+
+    bool m_realTime = true;
+
+    std::vector<Plane> m_planes;
+    size_t m_frameSize = 0;
+
+    std::unique_ptr<ColorTile> m_blackTile;
+    std::unique_ptr<ColorTile> m_whiteTile;
+    std::unique_ptr<ColorTile> m_boxTile;
+
+    uint32_t m_cellWidth = 0;
+    uint32_t m_boxSize = 0;
+    uint32_t m_boxSpeed = 0;
+
+    // The untouched pattern which is used to erase the box from its previous position
+    std::vector<std::byte> m_background;
+
+    BufferPool<PatternBuffer> m_buffers;
+    std::shared_ptr<FramePool> m_framePool;
+};
+
+TestPatternVideoInput::TestPatternVideoInput() = default;
+TestPatternVideoInput::~TestPatternVideoInput() = default;
+
+std::shared_ptr<IDevice> TestPatternVideoInput::instantiateDevice(const Options& options)
+{
+    auto retVal = std::make_shared<TestPatternDevice>(options);
+
+    if (!retVal->init())
+    {
+        return nullptr;
+    }
+
+    return retVal;
+}
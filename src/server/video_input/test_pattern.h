@@ -0,0 +1,36 @@
+#pragma once
+
+#include "device.h"
+
+// Generates a moving test pattern (color bars with a bouncing box) in any of the supported video formats.
+//
+// The top of every frame carries a barcode strip which can be read back on the viewer side to measure
+// latency and frame loss. The strip is BarcodeHeight pixels high and consists of BarcodeCellCount cells
+// of equal width (frame width / BarcodeCellCount, rounded down to an even number), starting at x = 0:
+//  - 4 guard cells: white, black, white, black
+//  - 64 cells holding the frame id, most significant bit first
+//  - 64 cells holding the capture time stamp in nanoseconds since the unix epoch, most significant bit first
+// A set bit is white (luma 235), a cleared bit black (luma 16).
+class TestPatternVideoInput
+{
+  public:
+    static constexpr uint32_t BarcodeHeight = 16;
+    static constexpr uint32_t BarcodeGuardCells = 4;
+    static constexpr uint32_t BarcodeCellCount = BarcodeGuardCells + 64 + 64;
+
+    struct Options
+    {
+        IDevice::VideoFormat videoFormat = IDevice::VideoFormat::NV12;
+        uint32_t width = 1920;
+        uint32_t height = 1080;
+        Ratio fps = {60, 1};
+
+        // Pace the frames to the frame rate, otherwise frames are generated as fast as possible
+        bool realTime = true;
+    };
+
+    TestPatternVideoInput();
+    ~TestPatternVideoInput();
+
+    std::shared_ptr<IDevice> instantiateDevice(const Options& options);
+};
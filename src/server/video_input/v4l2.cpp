@@ -0,0 +1,661 @@
+#include "v4l2.h"
+#include "frame.h"
+#include "trace_logging.h"
+#include "video_format.h"
+
+#include <cerrno>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+// ioctl which retries if it got interrupted by a signal
+int xioctl(int fd, unsigned long request, void* arg)
+{
+    int result;
+
+    do
+    {
+        result = ioctl(fd, request, arg);
+    } while (result == -1 && errno == EINTR);
+
+    return result;
+}
+
+struct DeviceNode
+{
+    std::string path;
+    std::string cardName;
+};
+
+// Lists all device nodes which are capable of streaming video capture
+std::vector<DeviceNode> EnumerateDeviceNodes()
+{
+    std::vector<DeviceNode> retVal;
+
+    std::error_code errorCode;
+    for (const auto& entry : std::filesystem::directory_iterator("/dev", errorCode))
+    {
+        const std::string path = entry.path().string();
+
+        if (entry.path().filename().string().rfind("video", 0) != 0)
+        {
+            continue;
+        }
+
+        int fd = open(path.c_str(), O_RDWR | O_NONBLOCK);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        v4l2_capability capability = {};
+        if (xioctl(fd, VIDIOC_QUERYCAP, &capability) == 0)
+        {
+            const uint32_t capabilities = capability.capabilities & V4L2_CAP_DEVICE_CAPS ? capability.device_caps : capability.capabilities;
+
+            if ((capabilities & V4L2_CAP_VIDEO_CAPTURE) && (capabilities & V4L2_CAP_STREAMING))
+            {
+                retVal.push_back({path, reinterpret_cast<const char*>(capability.card)});
+            }
+        }
+
+        close(fd);
+    }
+
+    std::sort(retVal.begin(), retVal.end(), [](const DeviceNode& a, const DeviceNode& b) { return a.path < b.path; });
+
+    return retVal;
+}
+
+IDevice::VideoFormat GetVideoFormat(uint32_t pixelFormat)
+{
+    switch (pixelFormat)
+    {
+    case V4L2_PIX_FMT_NV12:
+        return IDevice::VideoFormat::NV12;
+    case V4L2_PIX_FMT_YUV420:
+        return IDevice::VideoFormat::I420;
+    case V4L2_PIX_FMT_YUYV:
+        return IDevice::VideoFormat::YUY2;
+    case V4L2_PIX_FMT_UYVY:
+        return IDevice::VideoFormat::UYVY;
+    case V4L2_PIX_FMT_ABGR32:
+    case V4L2_PIX_FMT_XBGR32:
+        return IDevice::VideoFormat::BGRA;
+    case V4L2_PIX_FMT_BGR24:
+        return IDevice::VideoFormat::RGB24;
+    case V4L2_PIX_FMT_MJPEG:
+        return IDevice::VideoFormat::MJPEG;
+#ifdef V4L2_PIX_FMT_P010
+    case V4L2_PIX_FMT_P010:
+        return IDevice::VideoFormat::P010;
+#endif
+    default:
+        return IDevice::VideoFormat::Unknown;
+    }
+}
+
+// All pixel formats GetVideoFormat() knows, used to map a video format back to the device's pixel format
+constexpr uint32_t SupportedPixelFormats[] = {V4L2_PIX_FMT_NV12, V4L2_PIX_FMT_YUV420, V4L2_PIX_FMT_YUYV, V4L2_PIX_FMT_UYVY, V4L2_PIX_FMT_XBGR32, V4L2_PIX_FMT_ABGR32, V4L2_PIX_FMT_BGR24,
+                                              V4L2_PIX_FMT_MJPEG,
+#ifdef V4L2_PIX_FMT_P010
+                                              V4L2_PIX_FMT_P010,
+#endif
+};
+
+constexpr uint32_t BufferCount = 4;
+
+// Maps the field layout of the device's images to the order of their fields. Frames with a single field, or no fields at all,
+// are progressive. Alternating fields come as separate half height images, which nothing downstream can put together.
+bool GetFieldOrder(uint32_t field, bool is525Lines, IDevice::FieldOrder& fieldOrder)
+{
+    switch (field)
+    {
+    case V4L2_FIELD_INTERLACED:
+        // The order depends on the video standard, NTSC sends the bottom field first
+        fieldOrder = is525Lines ? IDevice::FieldOrder::BottomFieldFirst : IDevice::FieldOrder::TopFieldFirst;
+        return true;
+    case V4L2_FIELD_INTERLACED_TB:
+    case V4L2_FIELD_SEQ_TB:
+        fieldOrder = IDevice::FieldOrder::TopFieldFirst;
+        return true;
+    case V4L2_FIELD_INTERLACED_BT:
+    case V4L2_FIELD_SEQ_BT:
+        fieldOrder = IDevice::FieldOrder::BottomFieldFirst;
+        return true;
+    case V4L2_FIELD_ALTERNATE:
+        return false;
+    default:
+        fieldOrder = IDevice::FieldOrder::Progressive;
+        return true;
+    }
+}
+
+// The device node and its mapped capture buffers. Frames hold on to them through their release hook, so that a frame which is
+// kept by the sample handler stays mapped and can still be queued back after the device is gone.
+struct CaptureBuffers
+{
+    struct Buffer
+    {
+        void* data = nullptr;
+        size_t length = 0;
+        int dmaBufFd = -1;
+    };
+
+    explicit CaptureBuffers(int fd) : fd(fd)
+    {
+    }
+
+    ~CaptureBuffers()
+    {
+        for (auto& buffer : buffers)
+        {
+            if (buffer.dmaBufFd >= 0)
+            {
+                close(buffer.dmaBufFd);
+            }
+
+            if (buffer.data)
+            {
+                munmap(buffer.data, buffer.length);
+            }
+        }
+
+        buffers.clear();
+
+        v4l2_requestbuffers request = {};
+        request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        request.memory = V4L2_MEMORY_MMAP;
+        request.count = 0;
+        xioctl(fd, VIDIOC_REQBUFS, &request);
+
+        close(fd);
+    }
+
+    void queue(uint32_t index)
+    {
+        v4l2_buffer buffer = {};
+        buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buffer.memory = V4L2_MEMORY_MMAP;
+        buffer.index = index;
+
+        if (xioctl(fd, VIDIOC_QBUF, &buffer) != 0)
+        {
+            error("V4L2", "Failed to queue buffer %d.", index);
+        }
+    }
+
+    const int fd;
+    std::vector<Buffer> buffers;
+};
+} // namespace
+
+V4L2VideoInput::V4L2VideoInput() = default;
+V4L2VideoInput::~V4L2VideoInput() = default;
+
+std::vector<std::string> V4L2VideoInput::enumerateDevices()
+{
+    std::vector<std::string> retVal;
+
+    for (const auto& deviceNode : ::EnumerateDeviceNodes())
+    {
+        retVal.push_back(deviceNode.cardName);
+    }
+
+    return retVal;
+}
+
+class V4L2Device : public IDevice
+{
+  public:
+    V4L2Device(int fd, const std::string& name) : m_fd(fd), m_name(name), m_captureBuffers(std::make_shared<CaptureBuffers>(fd)), m_framePool(FramePool::create())
+    {
+    }
+
+    virtual std::string getName() const override
+    {
+        return m_name;
+    }
+
+    // Reads the format the device is currently configured for
+    bool readCurrentFormat()
+    {
+        v4l2_format format = {};
+        format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+        if (xioctl(m_fd, VIDIOC_G_FMT, &format) != 0)
+        {
+            error("V4L2", "Failed to get the current format.");
+            return false;
+        }
+
+        m_videoWidth = format.fmt.pix.width;
+        m_videoHeight = format.fmt.pix.height;
+        m_videoFormat = GetVideoFormat(format.fmt.pix.pixelformat);
+        m_bytesPerLine = format.fmt.pix.bytesperline;
+        m_sequentialFields = format.fmt.pix.field == V4L2_FIELD_SEQ_TB || format.fmt.pix.field == V4L2_FIELD_SEQ_BT;
+
+        v4l2_std_id standard = 0;
+        const bool is525Lines = xioctl(m_fd, VIDIOC_G_STD, &standard) == 0 && (standard & V4L2_STD_525_60);
+
+        // Treated like an unsupported pixel format, so that streaming fails unless a mode with whole frames is set
+        if (!GetFieldOrder(format.fmt.pix.field, is525Lines, m_fieldOrder))
+        {
+            warning("V4L2", "Device '%s' delivers alternating fields, which aren't supported.", m_name.c_str());
+            m_videoFormat = VideoFormat::Unknown;
+        }
+
+        v4l2_streamparm streamParameters = {};
+        streamParameters.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+        if (xioctl(m_fd, VIDIOC_G_PARM, &streamParameters) == 0 && streamParameters.parm.capture.timeperframe.numerator != 0)
+        {
+            // The device reports the time per frame, so the frame rate is the inverse
+            m_fps.numerator = streamParameters.parm.capture.timeperframe.denominator;
+            m_fps.denominator = streamParameters.parm.capture.timeperframe.numerator;
+        }
+        else
+        {
+            warning("V4L2", "Device doesn't report its frame rate, assuming 30 FPS.");
+            m_fps = {30, 1};
+        }
+
+        info("V4L2", "Video format %d x %d @ %.2f FPS, format: %d%s", m_videoWidth, m_videoHeight, m_fps.asFloat(), (int)m_videoFormat,
+             m_fieldOrder != FieldOrder::Progressive ? ", interlaced" : "");
+
+        return true;
+    }
+
+    virtual std::vector<VideoMode> enumerateVideoModes() const override
+    {
+        std::vector<VideoMode> retVal;
+
+        v4l2_fmtdesc formatDescription = {};
+        formatDescription.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+        for (; xioctl(m_fd, VIDIOC_ENUM_FMT, &formatDescription) == 0; formatDescription.index++)
+        {
+            const VideoFormat videoFormat = GetVideoFormat(formatDescription.pixelformat);
+            if (videoFormat == VideoFormat::Unknown)
+            {
+                continue;
+            }
+
+            v4l2_frmsizeenum frameSize = {};
+            frameSize.pixel_format = formatDescription.pixelformat;
+
+            for (; xioctl(m_fd, VIDIOC_ENUM_FRAMESIZES, &frameSize) == 0; frameSize.index++)
+            {
+                VideoMode mode;
+                mode.videoFormat = videoFormat;
+
+                // Stepwise and continuous ranges are only reported once, we just offer their largest size
+                const bool discreteSize = frameSize.type == V4L2_FRMSIZE_TYPE_DISCRETE;
+                mode.width = discreteSize ? frameSize.discrete.width : frameSize.stepwise.max_width;
+                mode.height = discreteSize ? frameSize.discrete.height : frameSize.stepwise.max_height;
+
+                v4l2_frmivalenum frameInterval = {};
+                frameInterval.pixel_format = formatDescription.pixelformat;
+                frameInterval.width = mode.width;
+                frameInterval.height = mode.height;
+
+                bool hasInterval = false;
+                for (; xioctl(m_fd, VIDIOC_ENUM_FRAMEINTERVALS, &frameInterval) == 0; frameInterval.index++)
+                {
+                    // Same for the intervals, the shortest one of a range gives the highest frame rate
+                    const bool discreteInterval = frameInterval.type == V4L2_FRMIVAL_TYPE_DISCRETE;
+                    const v4l2_fract& interval = discreteInterval ? frameInterval.discrete : frameInterval.stepwise.min;
+
+                    if (interval.numerator != 0)
+                    {
+                        mode.fps = {interval.denominator, interval.numerator};
+                        retVal.push_back(mode);
+                        hasInterval = true;
+                    }
+
+                    if (!discreteInterval)
+                    {
+                        break;
+                    }
+                }
+
+                if (!hasInterval)
+                {
+                    mode.fps = m_fps;
+                    retVal.push_back(mode);
+                }
+
+                if (!discreteSize)
+                {
+                    break;
+                }
+            }
+        }
+
+        return retVal;
+    }
+
+    virtual bool setVideoMode(const VideoMode& mode) override
+    {
+        for (uint32_t pixelFormat : SupportedPixelFormats)
+        {
+            if (GetVideoFormat(pixelFormat) != mode.videoFormat)
+            {
+                continue;
+            }
+
+            v4l2_format format = {};
+            format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            format.fmt.pix.width = mode.width;
+            format.fmt.pix.height = mode.height;
+            format.fmt.pix.pixelformat = pixelFormat;
+            format.fmt.pix.field = V4L2_FIELD_ANY;
+
+            // Drivers which picked alternating fields are asked for whole interlaced frames instead, the deinterlacer needs both fields
+            bool formatSet = xioctl(m_fd, VIDIOC_S_FMT, &format) == 0;
+            if (formatSet && format.fmt.pix.field == V4L2_FIELD_ALTERNATE)
+            {
+                format.fmt.pix.field = V4L2_FIELD_INTERLACED;
+                formatSet = xioctl(m_fd, VIDIOC_S_FMT, &format) == 0;
+            }
+
+            // The driver adjusts the format to the closest one it supports, so check what we actually got
+            if (!formatSet || format.fmt.pix.pixelformat != pixelFormat || format.fmt.pix.width != mode.width || format.fmt.pix.height != mode.height ||
+                format.fmt.pix.field == V4L2_FIELD_ALTERNATE)
+            {
+                continue;
+            }
+
+            v4l2_streamparm streamParameters = {};
+            streamParameters.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            streamParameters.parm.capture.timeperframe = {mode.fps.denominator, mode.fps.numerator};
+
+            if (xioctl(m_fd, VIDIOC_S_PARM, &streamParameters) != 0)
+            {
+                warning("V4L2", "Device doesn't support setting the frame rate.");
+            }
+
+            return readCurrentFormat() && m_videoFormat == mode.videoFormat;
+        }
+
+        return false;
+    }
+
+    virtual bool prepareStreaming() override
+    {
+        if (m_videoFormat == VideoFormat::Unknown)
+        {
+            error("V4L2", "Device '%s' isn't set to a supported pixel format.", m_name.c_str());
+            return false;
+        }
+
+        v4l2_requestbuffers request = {};
+        request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        request.memory = V4L2_MEMORY_MMAP;
+        request.count = BufferCount;
+
+        if (xioctl(m_fd, VIDIOC_REQBUFS, &request) != 0 || request.count < 2)
+        {
+            error("V4L2", "Failed to allocate capture buffers.");
+            return false;
+        }
+
+        auto& buffers = m_captureBuffers->buffers;
+        buffers.resize(request.count);
+
+        for (uint32_t i = 0; i < request.count; ++i)
+        {
+            v4l2_buffer buffer = {};
+            buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            buffer.memory = V4L2_MEMORY_MMAP;
+            buffer.index = i;
+
+            if (xioctl(m_fd, VIDIOC_QUERYBUF, &buffer) != 0)
+            {
+                error("V4L2", "Failed to query capture buffer %d.", i);
+                return false;
+            }
+
+            void* data = mmap(nullptr, buffer.length, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, buffer.m.offset);
+            if (data == MAP_FAILED)
+            {
+                error("V4L2", "Failed to map capture buffer %d.", i);
+                return false;
+            }
+
+            buffers[i].data = data;
+            buffers[i].length = buffer.length;
+
+            // Also export the buffer as DMABUF, so that consumers which can import it don't need to touch the CPU mapping.
+            // Not every driver supports this, so it is optional.
+            v4l2_exportbuffer exportBuffer = {};
+            exportBuffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            exportBuffer.index = i;
+            exportBuffer.flags = O_RDONLY | O_CLOEXEC;
+
+            if (xioctl(m_fd, VIDIOC_EXPBUF, &exportBuffer) == 0)
+            {
+                buffers[i].dmaBufFd = exportBuffer.fd;
+            }
+        }
+
+        return true;
+    }
+
+    virtual void stream(std::atomic<bool>& run, IDeviceSampleHandler* sampleHandler, IVideoStreamSampleConsumer* sampleConsumer) override
+    {
+        m_frameId = 0;
+
+        for (uint32_t i = 0; i < m_captureBuffers->buffers.size(); ++i)
+        {
+            m_captureBuffers->queue(i);
+        }
+
+        v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        if (xioctl(m_fd, VIDIOC_STREAMON, &type) != 0)
+        {
+            error("V4L2", "Failed to start streaming.");
+            return;
+        }
+
+        while (run)
+        {
+            Trace::Capture_WaitForNextSample(m_frameId);
+
+            // Wait with a timeout, so that we notice when we should stop
+            pollfd pollDescriptor = {m_fd, POLLIN, 0};
+            int pollResult = poll(&pollDescriptor, 1, 100);
+
+            if (pollResult == 0 || (pollResult < 0 && errno == EINTR))
+            {
+                continue;
+            }
+
+            v4l2_buffer buffer = {};
+            buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            buffer.memory = V4L2_MEMORY_MMAP;
+
+            if (pollResult < 0 || xioctl(m_fd, VIDIOC_DQBUF, &buffer) != 0)
+            {
+                if (errno == EAGAIN)
+                {
+                    continue;
+                }
+
+                error("V4L2", "Dequeuing a buffer failed.");
+                Trace::Capture_SampleFailed(m_frameId);
+                m_frameId++;
+                continue;
+            }
+
+            std::chrono::nanoseconds timeStampNs = std::chrono::seconds(buffer.timestamp.tv_sec) + std::chrono::microseconds(buffer.timestamp.tv_usec);
+
+            Trace::Capture_SampleReady(m_frameId, timeStampNs);
+
+            // The buffer goes back to the driver once the sample handler releases the frame
+            const uint32_t bufferIndex = buffer.index;
+            const CaptureBuffers::Buffer& captureBuffer = m_captureBuffers->buffers[bufferIndex];
+
+            FrameRef frame = m_framePool->acquire();
+            frame->setReleaseHook([captureBuffers = m_captureBuffers, bufferIndex]() { captureBuffers->queue(bufferIndex); });
+
+            frame->timeStamp = timeStampNs;
+            frame->frameId = m_frameId;
+            frame->videoFormat = m_videoFormat;
+            frame->width = m_videoWidth;
+            frame->height = m_videoHeight;
+            frame->dmaBufFd = captureBuffer.dmaBufFd;
+
+            if ((buffer.flags & V4L2_BUF_FLAG_ERROR) || !frame->setData(captureBuffer.data, buffer.bytesused, m_bytesPerLine))
+            {
+                error("V4L2", "Captured buffer is corrupt or too small for the video format.");
+                Trace::Capture_SampleFailed(m_frameId);
+            }
+            else if (m_sequentialFields && !(frame = weaveFields(*frame)))
+            {
+                Trace::Capture_SampleFailed(m_frameId);
+            }
+            else if (sampleHandler)
+            {
+                sampleHandler->onSample(frame, sampleConsumer);
+            }
+
+            m_frameId++;
+        }
+
+        xioctl(m_fd, VIDIOC_STREAMOFF, &type);
+    }
+
+    virtual void getFrameSize(uint32_t& width, uint32_t& height) const override
+    {
+        width = m_videoWidth;
+        height = m_videoHeight;
+    }
+
+    virtual Ratio getFrameRate() const override
+    {
+        return m_fps;
+    }
+
+    virtual VideoFormat getVideoFormat() const override
+    {
+        return m_videoFormat;
+    }
+
+    virtual FieldOrder getFieldOrder() const override
+    {
+        return m_fieldOrder;
+    }
+
+  private:
+    // Some drivers store the rows of the older field in the first half of each plane and the other field's rows in the second
+    // half. The deinterlacer expects them woven together, so they are copied into a frame of their own.
+    FrameRef weaveFields(const Frame& source)
+    {
+        FrameRef frame = m_framePool->acquire();
+
+        std::vector<std::byte>& buffer = m_wovenBuffers.acquire(*frame);
+        buffer.resize(GetVideoFormatInfo(source.videoFormat).getPackedSize(source.width, source.height));
+
+        frame->timeStamp = source.timeStamp;
+        frame->frameId = source.frameId;
+        frame->videoFormat = source.videoFormat;
+        frame->width = source.width;
+        frame->height = source.height;
+        if (!frame->setPackedData(buffer.data(), buffer.size()))
+        {
+            error("V4L2", "Can't lay out a %d x %d %s frame.", source.width, source.height, GetVideoFormatInfo(source.videoFormat).name);
+            return {};
+        }
+
+        // The top field holds the even rows, with one more than the bottom field for an odd number of rows
+        const uint32_t firstParity = m_fieldOrder == FieldOrder::BottomFieldFirst ? 1 : 0;
+
+        for (uint32_t i = 0; i < source.planeCount; ++i)
+        {
+            const Frame::Plane& sourcePlane = source.planes[i];
+            const Frame::Plane& plane = frame->planes[i];
+            const uint32_t firstFieldRows = (plane.rows + 1 - firstParity) / 2;
+
+            for (uint32_t y = 0; y < plane.rows; ++y)
+            {
+                const uint32_t sourceRow = y % 2 == firstParity ? y / 2 : firstFieldRows + y / 2;
+                std::memcpy(const_cast<std::byte*>(plane.getRow(y)), sourcePlane.getRow(sourceRow), plane.rowSize);
+            }
+        }
+
+        return frame;
+    }
+
+    // Owned by the capture buffers
+    int m_fd = -1;
+    std::string m_name;
+
+    std::shared_ptr<CaptureBuffers> m_captureBuffers;
+
+    uint32_t m_videoWidth = 0;
+    uint32_t m_videoHeight = 0;
+    uint32_t m_bytesPerLine = 0;
+
+    Ratio m_fps;
+
+    uint64_t m_frameId = 0;
+
+    VideoFormat m_videoFormat = VideoFormat::Unknown;
+    FieldOrder m_fieldOrder = FieldOrder::Progressive;
+
+    // Set when the fields are stored one after the other and have to be woven together
+    bool m_sequentialFields = false;
+
+    std::shared_ptr<FramePool> m_framePool;
+    BufferPool<std::vector<std::byte>> m_wovenBuffers;
+};
+
+std::shared_ptr<IDevice> V4L2VideoInput::instantiateDevice(const std::string& name)
+{
+    info("V4L2", "Trying to instantiate device '%s'", name.c_str());
+
+    std::string path;
+    std::string cardName;
+
+    for (const auto& deviceNode : ::EnumerateDeviceNodes())
+    {
+        if (deviceNode.cardName == name || deviceNode.path == name)
+        {
+            path = deviceNode.path;
+            cardName = deviceNode.cardName;
+            break;
+        }
+    }
+
+    if (path.empty())
+    {
+        error("V4L2", "Didn't find device '%s', can't instantiate it.", name.c_str());
+        return nullptr;
+    }
+
+    // Non blocking, so that a spurious poll() wakeup can't stall the capture thread in DQBUF
+    int fd = open(path.c_str(), O_RDWR | O_NONBLOCK);
+    if (fd < 0)
+    {
+        error("V4L2", "Failed to open '%s'.", path.c_str());
+        return nullptr;
+    }
+
+    auto retVal = std::make_shared<V4L2Device>(fd, cardName);
+
+    // Start with whatever the device is configured for, SelectVideoMode() picks the best mode later
+    if (!retVal->readCurrentFormat())
+    {
+        return nullptr;
+    }
+
+    return retVal;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "device.h"
+
+// Video capture through Video4Linux2, the Linux counterpart to MediaFoundationVideoInput.
+// Devices can be instantiated by their card name or by their device node (e.g. /dev/video0).
+class V4L2VideoInput
+{
+  public:
+    V4L2VideoInput();
+    ~V4L2VideoInput();
+
+    std::vector<std::string> enumerateDevices();
+
+    std::shared_ptr<IDevice> instantiateDevice(const std::string& name);
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "device.h"
+
+// Layout of one plane of a video format, relative to the frame size
+struct PlaneFormat
+{
+    uint32_t bytesPerSample = 0;
+    uint32_t shiftX = 0; // A sample covers 1 << shiftX pixels of a row
+    uint32_t shiftY = 0; // A row of samples covers 1 << shiftY rows of pixels
+
+    // Chroma planes of planar formats are narrower than the luma plane, their pitch is the frame's pitch shifted by this
+    uint32_t pitchShift = 0;
+
+    constexpr uint32_t getRowSize(uint32_t width) const
+    {
+        return ((width + (1u << shiftX) - 1) >> shiftX) * bytesPerSample;
+    }
+
+    constexpr uint32_t getRows(uint32_t height) const
+    {
+        return (height + (1u << shiftY) - 1) >> shiftY;
+    }
+};
+
+// Describes how a video format stores its pixels, known at compile time so that conversions can be specialized per format
+struct VideoFormatInfo
+{
+    IDevice::VideoFormat videoFormat = IDevice::VideoFormat::Unknown;
+
+    // Used on the command line and in the video mode cache
+    const char* name = "unknown";
+
+    bool yuv = false;
+
+    uint32_t planeCount = 0;
+    std::array<PlaneFormat, 3> planes = {};
+
+    // Significant bits of a sample, formats above 8 bits store them in the upper bits of 16 bit samples
+    uint32_t bitDepth = 8;
+
+    // Frames hold a compressed image of varying size in a single plane instead of rows of pixels, so there are no plane formats
+    bool compressed = false;
+
+    // Size of a frame with its planes stored one after another without padding
+    constexpr size_t getPackedSize(uint32_t width, uint32_t height) const
+    {
+        size_t size = 0;
+        for (uint32_t i = 0; i < planeCount; ++i)
+        {
+            size += size_t(planes[i].getRowSize(width)) * planes[i].getRows(height);
+        }
+
+        return size;
+    }
+};
+
+template <IDevice::VideoFormat Format>
+struct VideoFormatTraits
+{
+    static constexpr VideoFormatInfo info = {};
+};
+
+template <>
+struct VideoFormatTraits<IDevice::VideoFormat::BGRA>
+{
+    static constexpr VideoFormatInfo info = {IDevice::VideoFormat::BGRA, "bgra", false, 1, {{{4, 0, 0, 0}}}};
+};
+
+template <>
+struct VideoFormatTraits<IDevice::VideoFormat::NV12>
+{
+    static constexpr VideoFormatInfo info = {IDevice::VideoFormat::NV12, "nv12", true, 2, {{{1, 0, 0, 0}, {2, 1, 1, 0}}}};
+};
+
+template <>
+struct VideoFormatTraits<IDevice::VideoFormat::RGB24>
+{
+    static constexpr VideoFormatInfo info = {IDevice::VideoFormat::RGB24, "rgb24", false, 1, {{{3, 0, 0, 0}}}};
+};
+
+template <>
+struct VideoFormatTraits<IDevice::VideoFormat::I420>
+{
+    static constexpr VideoFormatInfo info = {IDevice::VideoFormat::I420, "i420", true, 3, {{{1, 0, 0, 0}, {1, 1, 1, 1}, {1, 1, 1, 1}}}};
+};
+
+// A sample of the packed 4:2:2 formats is a macro pixel covering two pixels
+template <>
+struct VideoFormatTraits<IDevice::VideoFormat::YUY2>
+{
+    static constexpr VideoFormatInfo info = {IDevice::VideoFormat::YUY2, "yuy2", true, 1, {{{4, 1, 0, 0}}}};
+};
+
+template <>
+struct VideoFormatTraits<IDevice::VideoFormat::UYVY>
+{
+    static constexpr VideoFormatInfo info = {IDevice::VideoFormat::UYVY, "uyvy", true, 1, {{{4, 1, 0, 0}}}};
+};
+
+template <>
+struct VideoFormatTraits<IDevice::VideoFormat::P010>
+{
+    static constexpr VideoFormatInfo info = {IDevice::VideoFormat::P010, "p010", true, 2, {{{2, 0, 0, 0}, {4, 1, 1, 0}}}, 10};
+};
+
+template <>
+struct VideoFormatTraits<IDevice::VideoFormat::MJPEG>
+{
+    static constexpr VideoFormatInfo info = {IDevice::VideoFormat::MJPEG, "mjpeg", false, 0, {}, 8, true};
+};
+
+constexpr size_t VideoFormatCount = size_t(IDevice::VideoFormat::MJPEG) + 1;
+
+// Calls the function with a std::integral_constant of every video format and returns the results as an array indexed by the format,
+// which builds lookup tables out of templates specialized per format
+template <typename Function>
+constexpr auto MakeVideoFormatTable(Function&& function)
+{
+    return [&]<size_t... Index>(std::index_sequence<Index...>)
+    { return std::array{function(std::integral_constant<IDevice::VideoFormat, IDevice::VideoFormat(Index)>{})...}; }(std::make_index_sequence<VideoFormatCount>{});
+}
+
+constexpr auto VideoFormatInfos = MakeVideoFormatTable([](auto format) { return VideoFormatTraits<format.value>::info; });
+
+constexpr const VideoFormatInfo& GetVideoFormatInfo(IDevice::VideoFormat videoFormat)
+{
+    const size_t index = size_t(videoFormat);
+    return index < VideoFormatCount ? VideoFormatInfos[index] : VideoFormatInfos[0];
+}
+
+// Returns Unknown for names of no video format
+constexpr IDevice::VideoFormat GetVideoFormatByName(std::string_view name)
+{
+    for (const VideoFormatInfo& format : VideoFormatInfos)
+    {
+        if (format.videoFormat != IDevice::VideoFormat::Unknown && name == format.name)
+        {
+            return format.videoFormat;
+        }
+    }
+
+    return IDevice::VideoFormat::Unknown;
+}
+
+static_assert(
+    []
+    {
+        for (size_t i = 0; i < VideoFormatCount; ++i)
+        {
+            if (size_t(VideoFormatInfos[i].videoFormat) != i)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }(),
+    "Every video format needs its traits");
+
+static_assert(GetVideoFormatInfo(IDevice::VideoFormat::NV12).getPackedSize(1920, 1080) == 1920 * 1080 * 3 / 2);
+static_assert(GetVideoFormatInfo(IDevice::VideoFormat::YUY2).planes[0].getRowSize(1919) == 960 * 4);
+static_assert(GetVideoFormatInfo(IDevice::VideoFormat::P010).getPackedSize(1920, 1080) == 1920 * 1080 * 3);
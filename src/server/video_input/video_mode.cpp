@@ -0,0 +1,249 @@
+#include "video_mode.h"
+#include "video_format.h"
+
+#include "nlohmann/json.hpp"
+
+#include <fstream>
+
+using nlohmann::json;
+
+namespace
+{
+void LogVideoMode(const char* message, const std::string& deviceName, const IDevice::VideoMode& mode)
+{
+    info("MODE", "%s '%s': %d x %d @ %.2f FPS, %s", message, deviceName.c_str(), mode.width, mode.height, mode.fps.asFloat(), GetVideoFormatInfo(mode.videoFormat).name);
+}
+
+// Compares the frame rates without dividing
+bool IsFaster(const IDevice::VideoMode& a, const IDevice::VideoMode& b)
+{
+    return uint64_t(a.fps.numerator) * b.fps.denominator > uint64_t(b.fps.numerator) * a.fps.denominator;
+}
+
+bool ReachesFps(const IDevice::VideoMode& mode, Ratio fps)
+{
+    return uint64_t(mode.fps.numerator) * fps.denominator >= uint64_t(fps.numerator) * mode.fps.denominator;
+}
+
+bool MatchesPinned(const IDevice::VideoMode& mode, const VideoModeConstraints& constraints)
+{
+    return (constraints.width == 0 || mode.width == constraints.width) && (constraints.height == 0 || mode.height == constraints.height) &&
+           (constraints.fps.numerator == 0 || mode.fps == constraints.fps);
+}
+} // namespace
+
+uint32_t GetConversionCost(IDevice::VideoFormat videoFormat)
+{
+    switch (videoFormat)
+    {
+    case IDevice::VideoFormat::NV12:
+        return 0; // Uploaded as is
+    case IDevice::VideoFormat::I420:
+    case IDevice::VideoFormat::YUY2:
+    case IDevice::VideoFormat::UYVY:
+        return 1; // Repacked to NV12 on the CPU with SIMD kernels
+    case IDevice::VideoFormat::P010:
+        return 2; // Narrowed to NV12 on the CPU while repacking, but twice the size to read
+    case IDevice::VideoFormat::BGRA:
+        return 3; // Twice the upload size and a color conversion on the GPU
+    case IDevice::VideoFormat::RGB24:
+        return 4; // Expanded to BGRA per pixel on the CPU
+    case IDevice::VideoFormat::MJPEG:
+        return 5; // Decoded on several CPU threads
+    default:
+        return UINT32_MAX;
+    }
+}
+
+std::vector<IDevice::VideoMode> RankVideoModes(std::vector<IDevice::VideoMode> modes, const VideoModeConstraints& constraints)
+{
+    std::erase_if(modes,
+                  [&constraints](const IDevice::VideoMode& mode)
+                  { return GetConversionCost(mode.videoFormat) == UINT32_MAX || mode.width == 0 || mode.height == 0 || !::MatchesPinned(mode, constraints); });
+
+    std::stable_sort(modes.begin(), modes.end(),
+                     [&constraints](const IDevice::VideoMode& a, const IDevice::VideoMode& b)
+                     {
+                         const bool fastA = ::ReachesFps(a, constraints.minimumFps);
+                         const bool fastB = ::ReachesFps(b, constraints.minimumFps);
+                         if (fastA != fastB)
+                         {
+                             return fastA;
+                         }
+
+                         // Below the minimum every frame counts more than its size
+                         if (!fastA && !(a.fps == b.fps))
+                         {
+                             return ::IsFaster(a, b);
+                         }
+
+                         const uint64_t pixelsA = uint64_t(a.width) * a.height;
+                         const uint64_t pixelsB = uint64_t(b.width) * b.height;
+                         if (pixelsA != pixelsB)
+                         {
+                             return pixelsA > pixelsB;
+                         }
+
+                         const uint32_t costA = GetConversionCost(a.videoFormat);
+                         const uint32_t costB = GetConversionCost(b.videoFormat);
+                         if (costA != costB)
+                         {
+                             return costA < costB;
+                         }
+
+                         return ::IsFaster(a, b);
+                     });
+
+    // Web cams often only reach their full frame rate compressed, which is worth the decoding. Compressed modes which are
+    // faster than every uncompressed mode of their size move to the front of the modes of that size, on either side of the minimum frame rate.
+    for (auto first = modes.begin(); first != modes.end();)
+    {
+        const uint64_t pixels = uint64_t(first->width) * first->height;
+        const bool fast = ::ReachesFps(*first, constraints.minimumFps);
+        const auto last = std::find_if(first, modes.end(),
+                                       [&](const IDevice::VideoMode& mode)
+                                       { return uint64_t(mode.width) * mode.height != pixels || ::ReachesFps(mode, constraints.minimumFps) != fast; });
+
+        const auto fastestUncompressed = std::find_if(first, last, [](const IDevice::VideoMode& mode) { return !GetVideoFormatInfo(mode.videoFormat).compressed; });
+
+        std::stable_partition(first, last,
+                              [&](const IDevice::VideoMode& mode)
+                              { return GetVideoFormatInfo(mode.videoFormat).compressed && (fastestUncompressed == last || ::IsFaster(mode, *fastestUncompressed)); });
+
+        first = last;
+    }
+
+    return modes;
+}
+
+VideoModeCache::VideoModeCache(const std::string& path) : m_path(path)
+{
+    std::ifstream file(m_path);
+    if (!file)
+    {
+        return;
+    }
+
+    // Parse without exceptions, a broken cache is simply ignored and rebuilt
+    auto root = json::parse(file, nullptr, false);
+    if (root.is_discarded() || !root.is_object())
+    {
+        warning("MODE", "Ignoring invalid video mode cache '%s'.", m_path.c_str());
+        return;
+    }
+
+    for (const auto& [deviceName, entry] : root.items())
+    {
+        if (!entry.is_object() || !entry.contains("format") || !entry["format"].is_string())
+        {
+            continue;
+        }
+
+        auto getNumber = [&entry](const char* key) -> uint32_t { return entry.contains(key) && entry[key].is_number_unsigned() ? entry[key].get<uint32_t>() : 0; };
+
+        IDevice::VideoMode mode;
+        mode.videoFormat = GetVideoFormatByName(entry["format"].get<std::string>());
+        mode.width = getNumber("width");
+        mode.height = getNumber("height");
+        mode.fps.numerator = getNumber("fpsNumerator");
+        mode.fps.denominator = getNumber("fpsDenominator");
+
+        if (mode.videoFormat != IDevice::VideoFormat::Unknown && mode.width && mode.height && mode.fps.denominator)
+        {
+            m_modes[deviceName] = mode;
+        }
+    }
+}
+
+std::optional<IDevice::VideoMode> VideoModeCache::get(const std::string& deviceName) const
+{
+    auto it = m_modes.find(deviceName);
+    if (it == m_modes.end())
+    {
+        return std::nullopt;
+    }
+
+    return it->second;
+}
+
+void VideoModeCache::set(const std::string& deviceName, const IDevice::VideoMode& mode)
+{
+    m_modes[deviceName] = mode;
+    save();
+}
+
+void VideoModeCache::save() const
+{
+    json root = json::object();
+
+    for (const auto& [deviceName, mode] : m_modes)
+    {
+        root[deviceName] = {
+            {"format", GetVideoFormatInfo(mode.videoFormat).name},
+            {"width", mode.width},
+            {"height", mode.height},
+            {"fpsNumerator", mode.fps.numerator},
+            {"fpsDenominator", mode.fps.denominator},
+        };
+    }
+
+    std::ofstream file(m_path, std::ios::trunc);
+    if (!file)
+    {
+        warning("MODE", "Couldn't write video mode cache '%s'.", m_path.c_str());
+        return;
+    }
+
+    file << root.dump(4);
+}
+
+bool SelectVideoMode(IDevice& device, VideoModeCache* cache, const VideoModeConstraints& constraints)
+{
+    const std::string deviceName = device.getName();
+
+    if (cache)
+    {
+        // A cached mode from before the constraints changed is probed again
+        auto cachedMode = cache->get(deviceName);
+        if (cachedMode && (!::MatchesPinned(*cachedMode, constraints) || !::ReachesFps(*cachedMode, constraints.minimumFps)))
+        {
+            ::LogVideoMode("Cached mode doesn't satisfy the constraints for", deviceName, *cachedMode);
+            cachedMode = std::nullopt;
+        }
+
+        if (cachedMode)
+        {
+            if (device.setVideoMode(*cachedMode))
+            {
+                ::LogVideoMode("Using cached mode for", deviceName, *cachedMode);
+                return true;
+            }
+
+            warning("MODE", "Device '%s' rejected its cached mode, probing again.", deviceName.c_str());
+        }
+    }
+
+    const auto modes = RankVideoModes(device.enumerateVideoModes(), constraints);
+
+    for (const auto& mode : modes)
+    {
+        if (device.setVideoMode(mode))
+        {
+            ::LogVideoMode("Selected mode for", deviceName, mode);
+
+            if (cache)
+            {
+                cache->set(deviceName, mode);
+            }
+
+            return true;
+        }
+
+        ::LogVideoMode("Device rejected mode for", deviceName, mode);
+    }
+
+    error("MODE", "Device '%s' has no mode the encoder can take%s.", deviceName.c_str(),
+          constraints.width || constraints.height || constraints.fps.numerator ? " at the requested size and frame rate" : "");
+
+    return false;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "device.h"
+
+// Relative cost of getting a frame in the format into the encoder, lower is cheaper. Unknown formats can't be encoded at all.
+uint32_t GetConversionCost(IDevice::VideoFormat videoFormat);
+
+// Limits the modes SelectVideoMode() picks from
+struct VideoModeConstraints
+{
+    // Pins the frame size or rate, zero leaves it to the ranking
+    uint32_t width = 0;
+    uint32_t height = 0;
+    Ratio fps;
+
+    // Modes below this frame rate rank after all others whatever their size, e.g. the 2 FPS full sensor mode of a web cam
+    Ratio minimumFps = {25, 1};
+};
+
+// Sorts the modes from best to worst. Modes which reach the minimum frame rate go first: the largest frame size, then the cheapest
+// conversion, then the highest frame rate. Slower modes follow by frame rate, then frame size, then conversion.
+// Compressed modes which are faster than every uncompressed one of their size go first among those.
+// Modes in formats the encoder can't take or which don't match the pinned size or rate are removed.
+std::vector<IDevice::VideoMode> RankVideoModes(std::vector<IDevice::VideoMode> modes, const VideoModeConstraints& constraints = {});
+
+// Remembers the mode that was picked for each device in a JSON file, so that a restart doesn't need to probe the device again
+class VideoModeCache
+{
+  public:
+    explicit VideoModeCache(const std::string& path);
+
+    std::optional<IDevice::VideoMode> get(const std::string& deviceName) const;
+
+    // Stores the mode and writes the cache file
+    void set(const std::string& deviceName, const IDevice::VideoMode& mode);
+
+  private:
+    void save() const;
+
+    std::string m_path;
+    std::unordered_map<std::string, IDevice::VideoMode> m_modes;
+};
+
+// Switches the device to its best mode. A cached mode which satisfies the constraints is tried first, all modes are only probed
+// if there is none or the device rejects it. The cache is optional.
+bool SelectVideoMode(IDevice& device, VideoModeCache* cache, const VideoModeConstraints& constraints = {});